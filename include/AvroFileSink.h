@@ -0,0 +1,104 @@
+#ifndef AVROFILESINK_H
+#define AVROFILESINK_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "json.hpp"
+#include "ResultSink.h"
+#include "avro/DataFile.hh"
+#include "avro/Generic.hh"
+#include "avro/ValidSchema.hh"
+
+// Result channel archiving the results in rolling Avro container files.
+//
+// write() only appends the result to the block being filled, under a short
+// lock; the block is handed to a background writer thread when it is full
+// (or after flush_ms) and a new block is filled meanwhile (double buffering),
+// so encoding, compression and disk writes never block the egress thread.
+// If the writer falls behind and max_pending results are already waiting,
+// new results are dropped and counted instead of blocking.
+//
+// Every record is {"timestamp": unix time in microseconds, "priority":
+// 0/1, "payload": the result as sent on a socket}. Files are written as
+// <path>/<prefix>-<YYYYmmdd-HHMMSS>-<n>.avro.part and renamed to .avro when
+// they are rolled (after roll_size_mb or roll_interval_s) or closed, so
+// readers only see complete files.
+//
+// Configuration: "result_socket_type": "file", the result_lp_socket and
+// result_hp_socket of the manager are the directories of the files, and an
+// optional "result_file" section of the manager:
+//   "result_file": {"block_size_kb": 64, "codec": "deflate", "roll_size_mb": 256,
+//                   "roll_interval_s": 3600, "flush_ms": 1000, "max_pending": 100000}
+// or an entry of the "result_sinks" array of a manager, with the same keys:
+//   {"type": "file", "lp_socket": "archive/lp", "hp_socket": "none", "codec": "deflate"}
+class AvroFileSink : public ResultSink {
+
+    struct Record {
+        int64_t timestamp;
+        int priority;
+        std::string payload;
+    };
+
+    std::string path;
+    std::string prefix;
+    size_t block_size;
+    avro::Codec codec;
+    uint64_t roll_size;
+    int64_t roll_interval_ns;
+    int64_t flush_ns;
+    size_t max_pending;
+    avro::ValidSchema schema;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<Record> filling;  // Block being filled by write
+    size_t filling_bytes;
+    std::vector<Record> writing;  // Block being written by the writer thread
+    bool stop_event;
+    std::thread thread;
+
+    // Owned by the writer thread
+    std::unique_ptr<avro::DataFileWriter<avro::GenericDatum>> writer;
+    std::string filename;
+    int64_t file_opened_ns;
+    int file_count;
+
+    std::atomic<uint64_t> written_count;
+    std::atomic<uint64_t> dropped_count;
+    std::atomic<uint64_t> files_count;
+
+    // Opens a new file
+    void open_file();
+
+    // Closes the writer without throwing. Returns false if the file could not be completed
+    bool close_writer();
+
+    // Closes the current file and makes it visible
+    void close_file();
+
+    // Encodes the records of a block and writes them to the current file, rolling it if needed
+    void write_block(std::vector<Record>& block);
+
+    void run();
+
+public:
+    AvroFileSink(const std::string& path, const std::string& prefix, const nlohmann::json& configuration = nlohmann::json());
+    ~AvroFileSink();
+
+    // Appends a result, never blocking on the disk. Returns false if it was dropped
+    bool write(const std::string& payload, int priority) override;
+
+    // Writes the pending results and closes the current file
+    void stop() override;
+
+    // Sink statistics for monitoring
+    nlohmann::json get_stats() override;
+};
+
+#endif // AVROFILESINK_H
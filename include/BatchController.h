@@ -0,0 +1,61 @@
+#ifndef BATCHCONTROLLER_H
+#define BATCHCONTROLLER_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include "json.hpp"
+
+// Feedback controller of the batch sizes of a WorkerManager.
+//
+// Workers report, for every dequeued batch, the time its oldest message
+// spent in the manager (from reception by the listener to the results being
+// queued) and the backlog left in the queue. Every control interval, for
+// each priority class, the batch size is halved if the worst dwell time of
+// the interval exceeded the latency target, and grown by a quarter if the
+// dwell time was well within the target while messages were waiting. The
+// same size drives the worker dequeue batches, the egress of results and
+// the ingest of the listeners.
+class BatchController {
+
+    struct PriorityClass {
+        int64_t latency_target_ns = 0;
+        std::atomic<int> batch_size{1};
+        std::atomic<int64_t> window_max_dwell_ns{0};
+        std::atomic<uint64_t> window_max_backlog{0};
+        std::atomic<uint64_t> window_samples{0};
+        std::atomic<int64_t> last_max_dwell_ns{0};  // Of the last completed interval, for monitoring
+    };
+
+    PriorityClass classes[2];  // 0 = low priority, 1 = high priority
+    int min_batch_size;
+    int max_batch_size;
+    int64_t interval_ns;
+    std::atomic<int64_t> last_update_ns;
+    std::mutex update_mutex;
+    std::atomic<uint64_t> increases;
+    std::atomic<uint64_t> decreases;
+
+    // Applies the control law at the end of an interval
+    void update(int64_t now);
+
+public:
+    // Constructor to initialize the controller from the "adaptive_batching" section
+    BatchController(const nlohmann::json& configuration, int initial_batch_size);
+
+    // Returns the current batch size of a priority class
+    int get_batch_size(int priority) const { return classes[priority ? 1 : 0].batch_size.load(std::memory_order_relaxed); }
+
+    int get_max_batch_size() const { return max_batch_size; }
+
+    // Reports the dwell time of a processed batch and the messages still queued
+    void record(int priority, int64_t dwell_ns, size_t backlog);
+
+    // Controller state for monitoring
+    nlohmann::json get_stats() const;
+
+    // Monotonic time in nanoseconds, used to timestamp received messages
+    static int64_t now_ns();
+};
+
+#endif // BATCHCONTROLLER_H
@@ -0,0 +1,129 @@
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "json.hpp"
+
+struct BufferCache;
+
+// Notified when the last handle of a tracked buffer is released, i.e. when
+// every manager the message was queued to has processed (or shed) it
+class DeliveryTracker {
+
+public:
+    virtual ~DeliveryTracker() {}
+
+    // Called by the thread releasing the last handle
+    virtual void complete(uint64_t token) = 0;
+};
+
+// Header of a pooled buffer, followed by its data
+struct alignas(64) BufferSlab {
+    BufferCache* origin;  // Cache the buffer returns to (nullptr for oversized buffers)
+    BufferSlab* next;  // Free list link
+    std::atomic<uint32_t> refs;
+    uint32_t size_class;
+    size_t capacity;
+    size_t size;
+    int64_t timestamp_ns;  // Reception time of the message (BatchController::now_ns)
+    int64_t deadline_ns;  // Deadline attached by the producer, same clock (0 = none)
+    DeliveryTracker* tracker;  // Notified when the buffer is released (nullptr = none)
+    uint64_t token;  // Passed to the tracker
+
+    char* data() { return reinterpret_cast<char*>(this + 1); }
+};
+
+// Handle to a pooled buffer. Copies share the buffer (reference counted), so
+// a received message can be queued to several managers without copying it;
+// the buffer must not be modified once shared. The last handle released
+// returns the buffer to the cache of the thread that allocated it
+class PooledBuffer {
+
+    BufferSlab* slab;
+
+public:
+    PooledBuffer() : slab(nullptr) {}
+    explicit PooledBuffer(BufferSlab* slab) : slab(slab) {}
+    PooledBuffer(const PooledBuffer& other) : slab(other.slab) {
+        if (slab) {
+            slab->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    PooledBuffer(PooledBuffer&& other) noexcept : slab(other.slab) { other.slab = nullptr; }
+    PooledBuffer& operator=(const PooledBuffer& other) {
+        PooledBuffer copy(other);
+        std::swap(slab, copy.slab);
+        return *this;
+    }
+    PooledBuffer& operator=(PooledBuffer&& other) noexcept {
+        std::swap(slab, other.slab);
+        return *this;
+    }
+    ~PooledBuffer() { reset(); }
+
+    // Releases the buffer
+    void reset();
+
+    char* data() { return slab->data(); }
+    const char* data() const { return slab->data(); }
+    size_t size() const { return slab ? slab->size : 0; }
+    size_t capacity() const { return slab ? slab->capacity : 0; }
+    void resize(size_t size) { slab->size = size; }  // size <= capacity()
+    int64_t get_timestamp() const { return slab ? slab->timestamp_ns : 0; }
+    void set_timestamp(int64_t timestamp_ns) { slab->timestamp_ns = timestamp_ns; }
+    int64_t get_deadline() const { return slab ? slab->deadline_ns : 0; }
+    void set_deadline(int64_t deadline_ns) { slab->deadline_ns = deadline_ns; }
+    void set_tracker(DeliveryTracker* tracker, uint64_t token) { slab->tracker = tracker; slab->token = token; }
+    bool empty() const { return size() == 0; }
+    explicit operator bool() const { return slab != nullptr; }
+
+    std::string_view view() const { return slab ? std::string_view(slab->data(), slab->size) : std::string_view(); }
+    std::string to_string() const { return std::string(view()); }
+};
+
+// Size-classed pool of message buffers with a cache per thread.
+//
+// A thread allocates from its own cache without synchronization. A buffer
+// released by the allocating thread goes back to the local free list; a
+// buffer released by another thread (a worker processing a message received
+// by a listener) is pushed lock-free on the remote free list of its origin
+// cache, which the owner takes back in one exchange when its local list is
+// empty. Free lists are refilled with slabs of several buffers, so after
+// warm-up ingest does no malloc/free. Pooled memory is kept for the process
+// lifetime and is bounded by the high-water mark of buffers in flight.
+// With huge pages enabled (see HugePages) the slabs of each thread cache are
+// carved from 2 MB huge page arenas.
+// Requests larger than the biggest class are served from the heap.
+class BufferPool {
+
+public:
+    static const int NUM_CLASSES = 8;  // 256 B, 1 KiB, ... 4 MiB
+
+    // Returns a buffer of at least the given size, with size() set to it
+    static PooledBuffer allocate(size_t size);
+
+    // Returns a buffer holding a copy of the given bytes
+    static PooledBuffer copy(const void* data, size_t size);
+
+    // Fills the cache of the calling thread with count buffers of the given
+    // size, touching their memory, so the first messages do not page fault
+    static void reserve(size_t size, size_t count);
+
+    // Returns the capacity of a size class
+    static size_t class_capacity(int size_class) { return static_cast<size_t>(256) << (2 * size_class); }
+
+    // Pool statistics for monitoring
+    static nlohmann::json get_stats();
+
+private:
+    friend class PooledBuffer;
+
+    // Returns a buffer to its origin cache
+    static void release(BufferSlab* slab);
+};
+
+#endif // BUFFERPOOL_H
@@ -0,0 +1,90 @@
+#ifndef CHECKPOINTMANAGER_H
+#define CHECKPOINTMANAGER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "json.hpp"
+#include "WorkerLogger.h"
+
+class WorkerBase;
+
+// Periodically writes the state of the stateful workers of a manager to disk
+// and restores it at startup, so that a restart does not lose windowed state.
+//
+// Workers publish immutable (copy-on-write) snapshots of their state with
+// WorkerBase::publish_state(); the checkpoint thread only grabs the current
+// snapshot pointers, so processing never pauses. A snapshot is a JSON object
+// keyed by the state's own key (e.g. the monitoring point name), never by
+// worker: the snapshots of all the workers of the manager are merged key by
+// key (WorkerBase::merge_state) and written to one file, only when a state
+// version changed since the last checkpoint. The workers of a manager share
+// its queues, so a key may have partial state in several workers; at restart
+// the whole merged state is restored into the first registered worker and
+// the others start empty, so it survives a change of num_workers.
+//
+// Checkpointing is opt-in for each worker type: a stateful worker must call
+// publish_state() when its state changes, override restore() to rebuild its
+// state from the snapshot and merge_state() to combine the partial states of
+// a key. Worker1 checkpoints its per-name totals with "batch_result":
+// "aggregate"; if no registered worker has published a state at the first
+// checkpoint, a warning is logged.
+//
+// Configuration (optional "checkpoint" section of a manager configuration):
+//   "checkpoint": {"path": "/tmp/checkpoints", "interval": 10}
+class CheckpointManager {
+
+    std::string path;  // Directory of the checkpoint files
+    std::string prefix;  // File prefix (manager fullname)
+    int interval;  // Seconds between two checkpoints
+    WorkerLogger* logger;
+    std::string globalname;
+
+    std::vector<WorkerBase*> workers;  // Registered workers
+    std::vector<uint64_t> written_versions;  // Last state version written for each worker
+    std::mutex workers_mutex;
+
+    std::thread thread;
+    std::atomic<bool> stop_event;
+    std::mutex wait_mutex;
+    std::condition_variable wait_cv;
+    std::atomic<uint64_t> checkpoints_written;
+    bool warned_stateless;  // Warned that no worker publishes its state
+
+    // Returns the checkpoint file name of the manager
+    std::string get_filename() const;
+
+    // Merges the snapshots of the workers and writes them if a state changed
+    bool write_states();
+
+public:
+    // Constructor to initialize the CheckpointManager from the "checkpoint" configuration section
+    CheckpointManager(const nlohmann::json& configuration, const std::string& prefix, WorkerLogger* logger, const std::string& globalname);
+
+    // Destructor to stop the thread and write the last checkpoint
+    ~CheckpointManager();
+
+    // Registers a worker. The first one restores the last checkpoint, if any
+    void add_worker(WorkerBase* worker);
+
+    // Restores the last checkpoint into a worker. Returns true if a checkpoint was found
+    bool restore(WorkerBase* worker);
+
+    // Writes the merged snapshots if a worker state changed
+    void checkpoint();
+
+    void start();
+    void stop();
+    void run();
+
+    uint64_t get_checkpoints_written() const { return checkpoints_written; }
+    int get_interval() const { return interval; }
+};
+
+#endif // CHECKPOINTMANAGER_H
@@ -0,0 +1,130 @@
+#ifndef COLUMNARBATCH_H
+#define COLUMNARBATCH_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "json.hpp"
+#include "StringInterner.h"
+#include "JsonView.h"
+
+// One AvroMonitoringPoint record, as appended to a ColumnarBatch.
+// The strings are views on the decoded message: they are interned by append
+struct ColumnarRow {
+    int64_t timestamp = 0;
+    bool has_source_timestamp = false;
+    int64_t source_timestamp = 0;
+    std::string_view assembly;
+    std::string_view name;
+    std::string_view serial_number;
+    std::string_view units;
+    std::string_view env_id;
+    bool archive_suppress = false;
+    bool eng_gui = false;
+    bool op_gui = false;
+    bool has_value = false;  // false if the data array is empty or its first item is not numeric
+    double value = 0.0;
+};
+
+// Micro-batch of monitoring points in columnar (structure of arrays) layout.
+// The batch is built from the decoded records when a worker dequeues them, so
+// that operators run over contiguous columns (see ColumnarOps) instead of one
+// record object at a time. The string fields are stored as StringInterner
+// ids; validity bitmaps mark the rows with a numeric value and with a source
+// timestamp. Records are rebuilt only at egress (to_json).
+// clear() keeps the allocated capacity, so a batch reused by a worker does not
+// allocate in steady state.
+class ColumnarBatch {
+
+    std::vector<int64_t> timestamps;
+    std::vector<int64_t> source_timestamps;
+    std::vector<uint32_t> name_ids;
+    std::vector<uint32_t> assembly_ids;
+    std::vector<uint32_t> serial_number_ids;
+    std::vector<uint32_t> units_ids;
+    std::vector<uint32_t> env_ids;
+    std::vector<uint8_t> flags;  // archive_suppress | eng_gui << 1 | op_gui << 2
+    std::vector<double> values;
+    std::vector<uint64_t> value_validity;  // bit i set if values[i] is valid
+    std::vector<uint64_t> source_timestamp_validity;  // bit i set if source_timestamps[i] is valid
+
+    StringInterner& interner;
+
+    // Sets bit row of a validity bitmap
+    static void set_bit(std::vector<uint64_t>& bitmap, size_t row, bool value);
+
+public:
+    ColumnarBatch();
+
+    // Reserves memory for the given number of rows
+    void reserve(size_t rows);
+
+    // Removes all the rows, keeping the allocated memory
+    void clear();
+
+    // Appends one record
+    void append(const ColumnarRow& row);
+
+    // Appends one record in the JSON representation of AvroMonitoringPoint
+    void append_json(const nlohmann::json& record);
+
+    // Same, reading only the fields of AvroMonitoringPoint from an on-demand view
+    void append_json(const JsonValue& record);
+
+    // Appends one record decoded from the Avro binary encoding of
+    // AvroMonitoringPoint, without intermediate objects. Returns false if the
+    // message is truncated or malformed
+    bool append_avro(const char* data, size_t size);
+
+    // Returns the string of an interned id
+    const std::string& get_string(uint32_t id) const { return interner.get_string(id); }
+
+    // Rebuilds the record of a row (egress)
+    nlohmann::json to_json(size_t row) const;
+
+    // Rebuilds all the records as a JSON array (egress)
+    nlohmann::json to_json() const;
+
+    size_t size() const { return timestamps.size(); }
+    bool empty() const { return timestamps.empty(); }
+
+    bool is_valid(size_t row) const { return (value_validity[row >> 6] >> (row & 63)) & 1; }
+    bool has_source_timestamp(size_t row) const { return (source_timestamp_validity[row >> 6] >> (row & 63)) & 1; }
+
+    // Column accessors
+    const std::vector<int64_t>& get_timestamps() const { return timestamps; }
+    const std::vector<int64_t>& get_source_timestamps() const { return source_timestamps; }
+    const std::vector<uint32_t>& get_name_ids() const { return name_ids; }
+    const std::vector<uint32_t>& get_assembly_ids() const { return assembly_ids; }
+    const std::vector<uint32_t>& get_serial_number_ids() const { return serial_number_ids; }
+    const std::vector<uint32_t>& get_units_ids() const { return units_ids; }
+    const std::vector<uint32_t>& get_env_ids() const { return env_ids; }
+    const std::vector<uint8_t>& get_flags() const { return flags; }
+    const std::vector<double>& get_values() const { return values; }
+    const std::vector<uint64_t>& get_value_validity() const { return value_validity; }
+};
+
+// Vectorizable operators over the columns of a batch. The loops work on 64
+// rows per validity word and are branch-free in the inner loop, so that the
+// compiler can use SIMD instructions.
+namespace ColumnarOps {
+
+    // Number of rows with a valid value
+    size_t count_valid(const ColumnarBatch& batch);
+
+    // Sum of the valid values
+    double sum(const ColumnarBatch& batch);
+
+    // Mean of the valid values (0 if there are none)
+    double mean(const ColumnarBatch& batch);
+
+    // Minimum and maximum of the valid values. Returns false if there are none
+    bool min_max(const ColumnarBatch& batch, double& min, double& max);
+
+    // Sum and count of the valid values grouped by name: group k has the
+    // interned name id names[k], groups in order of first row in the batch
+    void group_by_name(const ColumnarBatch& batch, std::vector<uint32_t>& names, std::vector<double>& sums, std::vector<uint32_t>& counts);
+}
+
+#endif // COLUMNARBATCH_H
@@ -0,0 +1,47 @@
+#ifndef CONSISTENTHASHRING_H
+#define CONSISTENTHASHRING_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Consistent hash ring mapping keys to shard ids.
+// Every shard is placed on the ring with a number of virtual nodes so that
+// the keys are spread evenly and adding/removing a shard only moves ~1/N keys.
+// The placement depends only on the shard ids and the number of virtual nodes,
+// so independent processes built with the same parameters agree on the owner
+// of each key.
+class ConsistentHashRing {
+
+    int virtual_nodes;  // Number of points placed on the ring for each shard
+    std::vector<std::pair<uint64_t, int>> ring;  // Sorted ring points (hash, shard id)
+
+    // Rebuilds the sorted ring after a change of membership
+    void sort_ring();
+
+public:
+    // Constructor to initialize the ring with shards 0..num_shards-1
+    ConsistentHashRing(int num_shards = 0, int virtual_nodes = 128);
+
+    // Adds a shard to the ring
+    void add_shard(int shard_id);
+
+    // Removes a shard from the ring
+    void remove_shard(int shard_id);
+
+    // Returns the shard owning the given key
+    int get_shard(const char* key, size_t size) const;
+    int get_shard(const std::string& key) const;
+
+    // Returns the shard owning the given (already computed) key hash
+    int get_shard_for_hash(uint64_t hash) const;
+
+    // Returns the number of distinct shards on the ring
+    int get_num_shards() const;
+
+    // Stable 64-bit hash used for ring placement and key lookup
+    static uint64_t hash(const char* data, size_t size);
+};
+
+#endif // CONSISTENTHASHRING_H
@@ -0,0 +1,92 @@
+#ifndef HEDGECONTROLLER_H
+#define HEDGECONTROLLER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "json.hpp"
+#include "BufferPool.h"
+#include "SloMonitor.h"
+
+// Hedged execution of high priority stragglers, for idempotent workers.
+//
+// A worker thread processing an HP message publishes it in its slot. A
+// worker thread with nothing to do scans the slots: if an HP message has
+// been processed for longer than the hedging threshold (the p95 of the HP
+// processing times, refreshed every update_every executions) and no other
+// worker is hedging it, it processes the message too. The first of the two
+// executions to complete emits its result, the other one is discarded.
+// Hedges are limited to max_hedge_rate of the HP executions, so a general
+// slowdown does not double the load. Only processData of single messages
+// is hedged (not micro-batches), and the worker must be idempotent: the
+// message is processed twice.
+//
+// Configuration (optional "hedging" section of a manager configuration):
+//   "hedging": {"percentile": 95, "min_samples": 100, "update_every": 256, "max_hedge_rate": 0.05}
+class HedgeController {
+
+public:
+    // One HP message being processed, shared by its primary and hedge executions
+    struct Execution {
+        PooledBuffer message;
+        int64_t start_ns = 0;
+        std::atomic<bool> hedged{false};
+        std::atomic<bool> completed{false};
+    };
+
+    // Constructor to initialize the controller from the "hedging" section, for num_slots worker threads
+    HedgeController(const nlohmann::json& configuration, int num_slots);
+
+    // Publishes the HP message processed by a worker thread
+    std::shared_ptr<Execution> begin(int slot, const PooledBuffer& message);
+
+    // Completes an execution. Returns true if its result must be emitted (first to complete).
+    // The primary execution clears its slot and records its processing time
+    bool complete(int slot, Execution& execution, bool hedge);
+
+    // Drops the message of a finished execution (after its result is emitted), so the
+    // reused record does not hold the buffer, nor delay its ack, until the slot is reused
+    void release(Execution& execution, bool hedge);
+
+    // Returns a straggler to hedge for an idle worker thread (nullptr if none)
+    std::shared_ptr<Execution> take_straggler(int self_slot);
+
+    // Hedging state for monitoring
+    nlohmann::json get_stats() const;
+
+private:
+    struct Slot {
+        std::atomic<int64_t> start_ns{0};  // 0 = no HP message being processed
+        std::mutex mutex;  // Protects execution and records
+        std::shared_ptr<Execution> execution;
+        // Records reused by the executions of the slot: a record is free when only
+        // this vector holds it (no hedge still running on it), so begin does not allocate
+        std::vector<std::shared_ptr<Execution>> records;
+    };
+
+    std::vector<Slot> slots;
+    std::atomic<int> used_slots;  // Highest slot used + 1
+
+    double percentile;
+    uint64_t min_samples;
+    uint64_t update_every;
+    double max_hedge_rate;
+
+    LatencyHistogram durations;  // HP processing times of the primary executions
+    std::mutex update_mutex;  // One threshold update at a time
+    std::vector<uint64_t> counts;
+    std::vector<uint64_t> last_counts;
+    std::atomic<int64_t> threshold_ns;  // 0 = not enough samples yet
+
+    std::atomic<uint64_t> executions;
+    std::atomic<uint64_t> hedges;
+    std::atomic<uint64_t> hedge_wins;
+    std::atomic<uint64_t> discarded;
+
+    // Recomputes the threshold from the processing times since the last update
+    void update_threshold();
+};
+
+#endif // HEDGECONTROLLER_H
@@ -0,0 +1,87 @@
+#ifndef HUGEPAGES_H
+#define HUGEPAGES_H
+
+#include <cstddef>
+#include <new>
+#include <string>
+#include "json.hpp"
+
+// Allocation of large regions (queues, buffer pool arenas) backed by 2 MB
+// huge pages, to reduce TLB misses when they are accessed at random.
+//
+// Modes:
+//   - "explicit": mmap with MAP_HUGETLB from the pool reserved in
+//     /proc/sys/vm/nr_hugepages, falling back to transparent huge pages;
+//   - "transparent": 2 MB aligned mmap with madvise(MADV_HUGEPAGE), so
+//     the kernel backs the region with huge pages when it can;
+//   - "off" (default): regular allocations.
+// When huge pages cannot be obtained the caller falls back to a regular
+// allocation. The bytes obtained with each mode are counted per region name
+// and reported to monitoring.
+//
+// Configuration (optional "huge_pages" section of the process configuration,
+// applied before any region is allocated):
+//   "huge_pages": {"mode": "transparent"}
+class HugePages {
+
+public:
+    static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    // Sets the mode from the "huge_pages" configuration section
+    static void configure(const nlohmann::json& configuration);
+
+    static bool is_enabled();
+
+    // Allocates at least bytes (rounded up to huge pages, the rounded size is
+    // returned in allocated) backed by huge pages. Returns nullptr if huge
+    // pages are disabled or not available: the caller must then use a
+    // regular allocation
+    static void* allocate(size_t bytes, const char* region, size_t& allocated);
+
+    // Releases a region returned by allocate. Returns false if the memory
+    // does not come from allocate
+    static bool deallocate(void* memory);
+
+    // Huge page usage by region for monitoring
+    static nlohmann::json get_stats();
+};
+
+// Standard allocator for containers that may grow past a huge page (e.g. the
+// ring of a MessageQueue): allocations of at least HUGE_PAGE_SIZE bytes are
+// backed by huge pages when enabled, smaller ones use operator new
+template <class T>
+class HugePageAllocator {
+
+public:
+    using value_type = T;
+
+    const char* region;
+
+    explicit HugePageAllocator(const char* region = "default") : region(region) {}
+    template <class U>
+    HugePageAllocator(const HugePageAllocator<U>& other) : region(other.region) {}
+
+    T* allocate(size_t n) {
+        size_t bytes = n * sizeof(T);
+        if (bytes >= HugePages::HUGE_PAGE_SIZE) {
+            size_t allocated;
+            if (void* memory = HugePages::allocate(bytes, region, allocated)) {
+                return static_cast<T*>(memory);
+            }
+        }
+        return static_cast<T*>(::operator new(bytes));
+    }
+
+    void deallocate(T* memory, size_t n) {
+        if (n * sizeof(T) < HugePages::HUGE_PAGE_SIZE || !HugePages::deallocate(memory)) {
+            ::operator delete(memory);
+        }
+    }
+
+    template <class U>
+    bool operator==(const HugePageAllocator<U>&) const { return true; }
+    template <class U>
+    bool operator!=(const HugePageAllocator<U>&) const { return false; }
+};
+
+#endif // HUGEPAGES_H
@@ -0,0 +1,107 @@
+#ifndef JSONVIEW_H
+#define JSONVIEW_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "json.hpp"
+
+class JsonDocument;
+
+// Lazy view on one value of a JsonDocument. Nothing is decoded until a typed
+// getter is called, and only the requested value is decoded: looking up a
+// field skips the other values of the object in O(1) each through the
+// structural index. A default-constructed (or missing) value is not valid and
+// all its getters fail. Views are valid as long as the document and its text.
+class JsonValue {
+
+    const JsonDocument* document;
+    uint32_t index;  // Index of the first character of the value in the structural index
+
+public:
+    enum Type { INVALID, OBJECT, ARRAY, STRING, NUMBER, BOOLEAN, NULLVALUE };
+
+    JsonValue() : document(nullptr), index(0) {}
+    JsonValue(const JsonDocument* document, uint32_t index) : document(document), index(index) {}
+
+    bool valid() const { return document != nullptr; }
+    Type type() const;
+
+    // Field of an object (keys are compared as written in the text, without
+    // unescaping). Returns an invalid value if missing or not an object
+    JsonValue operator[](std::string_view key) const;
+
+    // Item of an array. Returns an invalid value if out of range or not an array
+    JsonValue at(size_t item) const;
+
+    // Number of items of an array or fields of an object
+    size_t size() const;
+
+    // Typed getters: return false if the value has another type or is malformed.
+    // Strings without escapes are returned as views on the text; otherwise
+    // they are unescaped into scratch and the view refers to it
+    bool get_string(std::string_view& value, std::string& scratch) const;
+    bool get_int64(int64_t& value) const;
+    bool get_double(double& value) const;
+    bool get_bool(bool& value) const;
+    bool is_null() const { return raw() == "null"; }
+
+    // Text of the value, as in the document
+    std::string_view raw() const;
+
+    // Compatibility fallback: full nlohmann DOM of the value
+    nlohmann::json to_json() const;
+};
+
+// JSON document parsed on demand. parse() validates the text (balanced
+// objects and arrays, keys, separators, terminated strings with no control
+// characters, valid escapes with paired surrogates and well-formed UTF-8,
+// literals and numbers) and builds an index of
+// the positions of its structural characters and values, scanning 64 bytes
+// at a time with SIMD compares (SSE2, with a scalar fallback on other
+// targets). Values are decoded only when they are read through JsonValue.
+//
+// The text is not copied: it must outlive the document and its values. A
+// document can be reused for the next message without allocating once its
+// index has grown to the size of the largest message.
+class JsonDocument {
+
+    friend class JsonValue;
+
+    std::string_view text;
+    // Positions in the text of the structural characters and value starts.
+    // The vectors only grow, count is the size of the index
+    std::vector<uint32_t> positions;
+    uint32_t count = 0;
+    std::vector<uint32_t> matching;  // For each '{' or '[' index, the index of its closing character
+    std::vector<uint32_t> open;  // Indexes of the open objects and arrays during validation
+    std::string error;
+
+    // Builds the structural index. Returns false for unterminated strings or control characters
+    bool index_structure();
+
+    // Checks the grammar and matches the brackets. Returns false if malformed
+    bool validate();
+
+    // Checks the string or scalar starting at index. Returns false if malformed
+    bool check_value(uint32_t index);
+
+    // Index following the value starting at index
+    uint32_t skip(uint32_t index) const;
+
+    char at_index(uint32_t index) const { return text[positions[index]]; }
+
+public:
+    JsonDocument() {}
+
+    // Indexes and validates a JSON text. Returns false if it is not valid (see get_error)
+    bool parse(std::string_view data);
+
+    // Root value (invalid if the last parse failed)
+    JsonValue root() const;
+
+    const std::string& get_error() const { return error; }
+};
+
+#endif // JSONVIEW_H
@@ -0,0 +1,101 @@
+#ifndef MESSAGEQUEUE_H
+#define MESSAGEQUEUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <vector>
+#include "BufferPool.h"
+#include "HugePages.h"
+
+// Thread-safe queue of pooled message buffers between the listeners and the
+// workers of a manager.
+//
+// By default the queue is FIFO, stored in a ring that only grows, so pushing
+// and popping do not allocate in steady state. With deadline scheduling
+// enabled, messages are dequeued earliest deadline first (EDF): the deadline
+// is the one attached by the producer or, if none, the reception time plus
+// the configured budget; messages without any deadline follow, in FIFO
+// order. Messages dequeued after their deadline are counted as expired and,
+// if configured, dropped instead of being returned.
+// Once the ring or the heap grow past 2 MB they are backed by huge pages,
+// if enabled (see HugePages).
+class MessageQueue {
+
+    struct Entry {
+        int64_t deadline_ns;
+        uint64_t seq;  // Arrival order, to break ties
+        PooledBuffer buffer;
+    };
+
+    // Min-heap order on (deadline, seq)
+    struct Later {
+        bool operator()(const Entry& a, const Entry& b) const {
+            return a.deadline_ns != b.deadline_ns ? a.deadline_ns > b.deadline_ns : a.seq > b.seq;
+        }
+    };
+
+    static const int64_t NO_DEADLINE = std::numeric_limits<int64_t>::max();
+
+    mutable std::mutex mutex;
+    std::vector<PooledBuffer, HugePageAllocator<PooledBuffer>> ring;
+    size_t head;
+    std::atomic<size_t> count;
+
+    bool deadline_scheduling;
+    int64_t budget_ns;  // Default deadline after reception (0 = none)
+    bool drop_expired;
+    std::vector<Entry, HugePageAllocator<Entry>> heap;
+    uint64_t next_seq;
+    std::atomic<uint64_t> expired_count;
+    std::atomic<uint64_t> dropped_count;
+
+    // Doubles the ring capacity. Requires the lock
+    void grow();
+
+    // Appends a message. Requires the lock
+    void push_locked(const PooledBuffer& buffer);
+
+    // Removes the next message. Requires the lock
+    bool pop_locked(PooledBuffer& buffer, int64_t now);
+
+public:
+    explicit MessageQueue(size_t initial_capacity = 1024);
+
+    // Enables earliest deadline first ordering. Call before the queue is used
+    void set_deadline_scheduling(int64_t budget_ns, bool drop_expired);
+    bool is_deadline_scheduling() const { return deadline_scheduling; }
+
+    // Sizes the queue for capacity messages, so it does not grow below that
+    void reserve(size_t capacity);
+
+    // Appends a message
+    void push(PooledBuffer buffer);
+
+    // Appends several messages at once (shared with the caller, which keeps its handles)
+    void push_batch(const std::vector<PooledBuffer>& buffers);
+
+    // Removes the next message. Returns false if the queue is empty
+    bool pop(PooledBuffer& buffer);
+
+    // Removes up to max_count messages, appending them to out. Returns the number removed
+    size_t pop_batch(std::vector<PooledBuffer>& out, size_t max_count);
+
+    // Removes up to count messages without delivering them: the oldest ones or,
+    // with EDF, those with the latest deadlines. Returns the number removed
+    size_t drop_oldest(size_t count);
+
+    // Removes all the messages
+    void clear();
+
+    size_t size() const { return count.load(std::memory_order_relaxed); }
+    bool empty() const { return size() == 0; }
+
+    // Messages dequeued after their deadline (including the dropped ones)
+    uint64_t get_expired_count() const { return expired_count.load(std::memory_order_relaxed); }
+    // Expired messages dropped without processing
+    uint64_t get_dropped_count() const { return dropped_count.load(std::memory_order_relaxed); }
+};
+
+#endif // MESSAGEQUEUE_H
@@ -5,6 +5,7 @@
 #include <string>
 #include <unordered_map>
 #include <mutex>
+#include <atomic>
 #include <ctime>
 #include <sys/types.h>
 #include <unistd.h>
@@ -14,36 +15,67 @@
 
 class WorkerManager;
 
+// Monitoring state of a manager. The state is computed by refresh() into
+// the back one of two preallocated snapshots, which is then published by
+// swapping the index of the current one. Readers (the periodic sender,
+// getstatus) only copy the published snapshot: they never take a lock, so
+// they never block each other, a refresh or the workers. A refresh waits
+// only for the readers still copying the back snapshot, if any.
 class MonitoringPoint {
 
+    struct Snapshot {
+        nlohmann::json data;  // Monitoring data
+        std::string serialized;  // data.dump(), as sent on the monitoring socket
+    };
+
     WorkerManager* manager;  // Pointer to the WorkerManager
     pid_t processOS;  // Process ID of the current process
-    nlohmann::json data;  // JSON object to store data
+    Snapshot snapshots[2];  // Published and back snapshots
+    std::atomic<int> current;  // Index of the published snapshot
+    std::atomic<int> readers[2];  // Readers copying each snapshot
+    std::mutex refresh_mutex;  // One refresh at a time
+    std::mutex pending_mutex;  // Protects pending
+    nlohmann::json pending;  // Fields set by update/set_status, applied by the next refresh
     std::unordered_map<int, double> processing_rates;  // Map of processing rates
     std::unordered_map<int, int> processing_tot_events;  // Map of total processing events
     std::unordered_map<int, int> worker_status;  // Map of worker statuses
-    std::mutex data_mutex;  // Mutex for thread-safe access to data
 
     // Monitors and updates system resources (CPU, memory)
-    void resource_monitor();
+    void resource_monitor(nlohmann::json& data);
 
     // Placeholder function to get CPU usage
     double get_cpu_usage();
 
+    // Computes the monitoring data into a snapshot
+    void compute(nlohmann::json& data);
+
+    // Pins the published snapshot for reading. Returns its index
+    int acquire();
+
+    // Releases a snapshot pinned by acquire
+    void release(int index);
+
 public:
     // Constructor to initialize the MonitoringPoint with a WorkerManager pointer
     MonitoringPoint(WorkerManager* manager);
 
-    // Updates the data map with a new key-value pair
+    // Updates the data map with a new key-value pair (published by the next refresh)
     void update(const std::string& key, const nlohmann::json& value);
 
-    // Retrieves the current data including system resource monitoring
+    // Computes and publishes a new snapshot. Returns false if another refresh
+    // was already running (its snapshot is published instead)
+    bool refresh();
+
+    // Returns a copy of the published monitoring data
     nlohmann::json get_data();
 
-    // Sets the status in the data map
+    // Returns the published monitoring data, serialized
+    std::string get_serialized();
+
+    // Sets the status in the data map (published by the next refresh)
     void set_status(const std::string& new_status);
 
-    // Gets the current status from the data map
+    // Gets the published status
     std::string get_status();
 
 };
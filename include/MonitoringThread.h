@@ -9,16 +9,19 @@
 #include "json.hpp"
 #include <zmq.hpp>
 #include <MonitoringPoint.h>
+#include "TimerService.h"
 
 class MonitoringPoint; // Forward declaration
 
 
+// Sends the monitoring data of a manager once a second, driven by the
+// shared TimerService (the name is kept from when it had its own thread)
 class MonitoringThread {  
 
-    std::thread thread;  // The monitoring thread
-    std::atomic<bool> stop_event;  // Atomic flag to stop the thread
+    TimerService::TimerId timer;  // Monitoring tick (0 = not started)
     zmq::socket_t& socket_monitoring;  // Reference to the ZMQ socket for sending data
     MonitoringPoint& monitoringpoint;  // Reference to the MonitoringPoint
+    std::atomic<uint64_t> skipped_ticks;  // Ticks not sent because the socket was full
   
 public:
     // Constructor to initialize the MonitoringThread with a socket and MonitoringPoint reference
@@ -29,11 +32,15 @@ public:
 
     void start();
     void stop();
+
+    // Refreshes and sends the monitoring data (one tick)
     void run();
 
 
     // Sends monitoring data to a specific process target name
     void sendto(const std::string& processtargetname);
+
+    uint64_t get_skipped_ticks() const { return skipped_ticks; }
 };
 
 #endif // MONITORINGTHREAD_H
@@ -0,0 +1,90 @@
+#ifndef OVERLOADGOVERNOR_H
+#define OVERLOADGOVERNOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "json.hpp"
+#include "WorkerLogger.h"
+#include "MessageQueue.h"
+#include "TimerService.h"
+
+class WorkerManager;
+
+// Detects sustained overload of a manager and sheds low priority load.
+//
+// Every interval the governor samples the input queue lengths and the
+// utilization of the worker threads (busy time / elapsed time). An interval
+// is saturated when the workers are busy above the utilization threshold
+// while the queues grow or stay above the high watermark; after
+// "sustain_intervals" saturated intervals in a row the manager enters
+// shedding, and it leaves it after as many intervals with the queues below
+// half the high watermark. While shedding, according to the policy:
+//   - "sample_lp": only one LP message every lp_sample_n is queued;
+//   - "drop_oldest_lp": the LP queue is cut to max_lp_queue dropping the oldest messages
+//     (with deadline scheduling, those with the latest deadlines).
+// HP messages are never shed. Transitions are reported with send_alarm.
+//
+// Configuration (optional "load_shedding" section of a manager configuration):
+//   "load_shedding": {"interval_ms": 500, "sustain_intervals": 6, "utilization_threshold": 0.9,
+//                     "queue_high_watermark": 1000, "lp_sample_n": 10, "max_lp_queue": 10000,
+//                     "policy": ["sample_lp", "drop_oldest_lp"]}
+class OverloadGovernor {
+
+    WorkerManager* manager;
+    WorkerLogger* logger;
+    std::string fullname;
+    std::string globalname;
+
+    int interval_ms;
+    int sustain_intervals;
+    double utilization_threshold;
+    size_t queue_high_watermark;
+    uint64_t lp_sample_n;
+    size_t max_lp_queue;
+    bool sample_lp;
+    bool drop_oldest_lp;
+
+    std::atomic<bool> shedding;
+    int saturated_intervals;
+    int recovered_intervals;
+    size_t last_queue_size;
+    int64_t last_busy_ns;
+    int64_t last_check_ns;
+    std::atomic<double> utilization;
+    std::atomic<uint64_t> lp_seen;
+    std::atomic<uint64_t> lp_sampled_out;
+    std::atomic<uint64_t> lp_dropped;
+    std::atomic<uint64_t> shedding_episodes;
+
+    TimerService::TimerId timer;  // Periodic check (0 = not started)
+
+    // Sums the busy time of the worker threads
+    int64_t get_busy_ns(int& num_workers) const;
+
+public:
+    static const int ALARM_CODE_SHEDDING_START = 100;
+    static const int ALARM_CODE_SHEDDING_END = 101;
+
+    // Constructor to initialize the governor from the "load_shedding" configuration section
+    OverloadGovernor(const nlohmann::json& configuration, WorkerManager* manager, WorkerLogger* logger, const std::string& fullname, const std::string& globalname);
+    ~OverloadGovernor();
+
+    // Queues received messages, applying the LP shedding policy
+    void enqueue(int priority, MessageQueue& queue, const std::vector<PooledBuffer>& received);
+
+    // Evaluates the saturation of the last interval and applies the policy
+    void check();
+
+    // Starts and stops the periodic checks on the timer service
+    void start();
+    void stop();
+
+    bool is_shedding() const { return shedding; }
+
+    // Governor state for monitoring
+    nlohmann::json get_stats() const;
+};
+
+#endif // OVERLOADGOVERNOR_H
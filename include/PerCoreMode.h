@@ -0,0 +1,117 @@
+#ifndef PERCOREMODE_H
+#define PERCOREMODE_H
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <zmq.hpp>
+#include "json.hpp"
+#include "WorkerLogger.h"
+
+// Thread-per-core shared-nothing mode, for the highest-rate pipelines.
+//
+// At launch the process forks one complete pipeline shard per core, pinned
+// to its core before any thread is created (so all the threads of the shard
+// inherit the affinity): each shard is a separate Supervisor with its own
+// ingest sockets, queues, workers, result channels, timer service and
+// logs, and shares no memory with the others. The Supervisor singletons
+// make a process the unit of isolation, rather than a thread. The launching
+// process only forwards SIGTERM/SIGINT to the shards and waits for them.
+//
+// The input is sharded by the socket layer: the sockets bound by a shard
+// (pushpull data sockets, pubsub result sockets, ack sockets) get the TCP
+// port + core * port_stride (ipc paths get a "-core<i>" suffix), so a
+// sender connecting its PUSH socket to the endpoints of all the shards has
+// its messages load-balanced across cores by ZeroMQ. With pubsub data
+// sockets every shard subscribes to the stream and keeps the messages
+// whose key hashes to its core (see ShardRouter), so the messages with the
+// same key stay on the same core. As for the sharding, a key requires
+// dataflow_type "string"; with binary or filename messages leave it empty
+// and whole messages are hashed (balanced, no key affinity). Managers, workers and sockets are named
+// "<processname>-core<i>"; commands addressed to the process name reach
+// all the shards, those addressed to a shard name only that shard.
+//
+// A CrossShardChannel connects the shards for rare coordination messages.
+// The reliable channels ("reliable_input" and the manager "reliable"
+// section) are rejected in this mode: their go-back-N sequence numbers and
+// acks assume one stream per endpoint, not traffic split across shards.
+//
+// Configuration (optional "per_core" section of the process configuration):
+//   "per_core": {"num_cores": 4, "first_core": 0, "port_stride": 1, "key": "name",
+//                "channel": "ipc:///tmp/rtadp-RTADP1"}
+// num_cores 0 = one shard per online core.
+class PerCoreMode {
+
+public:
+    // Forks and pins one pipeline shard per core if the process configuration
+    // has a "per_core" section, and returns the core index in each shard.
+    // The launching process waits for the shards and returns -1. Returns 0
+    // without forking if the mode is disabled
+    static int launch(const std::string& config_file, const std::string& name);
+
+    static bool is_enabled();
+    static int get_core_id();
+    static int get_num_cores();
+
+    // Name of the shard of a process ("<name>-core<i>", name if disabled)
+    static std::string shard_name(const std::string& name);
+
+    // Endpoint bound by a core for an endpoint of the configuration
+    static std::string core_endpoint(const std::string& endpoint, int core_id);
+
+    // Endpoint bound by this shard (endpoint if disabled)
+    static std::string shard_endpoint(const std::string& endpoint);
+};
+
+// Lightweight channel between the shards of the per-core mode, for rare
+// coordination messages (not for the data path). Each shard binds a PULL
+// inbox and connects a PUSH socket to the inbox of each other shard;
+// messages are delivered to the handler in the receiving thread of the
+// channel, with the index of the sending core.
+class CrossShardChannel {
+
+public:
+    using Handler = std::function<void(int from_core, const std::string& message)>;
+
+    CrossShardChannel(zmq::context_t& context, const std::string& endpoint, WorkerLogger* logger, const std::string& globalname);
+    ~CrossShardChannel();
+
+    // Sets the handler of the received messages (before start)
+    void set_handler(Handler handler);
+
+    void start();
+    void stop();
+
+    // Sends a message to the shard of a core. Safe from any thread. Never
+    // blocks: the message is dropped (and counted) if the shard is not receiving
+    void send(int core_id, const std::string& message);
+
+    // Sends a message to all the other shards
+    void broadcast(const std::string& message);
+
+    // Channel state for monitoring
+    nlohmann::json get_stats() const;
+
+private:
+    int core_id;
+    int num_cores;
+    WorkerLogger* logger;
+    std::string globalname;
+    zmq::socket_t inbox;
+    std::vector<zmq::socket_t> peers;  // By core (unconnected for this core)
+    std::mutex send_mutex;  // The peer sockets are not thread-safe
+    Handler handler;
+    std::thread thread;
+    std::atomic<bool> _stop_event;
+    std::atomic<uint64_t> sent_count;
+    std::atomic<uint64_t> dropped_count;  // Not sent: the peer queue was full (HWM) or the peer not connected
+    std::atomic<uint64_t> received_count;
+
+    // Receives the messages of the other shards
+    void run();
+};
+
+#endif // PERCOREMODE_H
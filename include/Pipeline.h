@@ -0,0 +1,77 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "json.hpp"
+
+// DAG of the managers of one Supervisor, connected in memory.
+//
+// A manager with an "inputs" list receives the results of the listed
+// managers (by name) in its input queues, with the same priority, instead
+// of the data sockets; "source" in the list (or no "inputs" at all) stands
+// for the data sockets of the Supervisor. Results of a manager with
+// downstream managers are forwarded to them, and also sent to its result
+// sockets if configured.
+//
+// Adjacent stages are fused when the upstream has only that output, the
+// downstream only that input, both are declared "stateless", have the same
+// "num_workers", the upstream has no result sockets and the downstream no
+// "batch_size" > 1: the worker thread of the head of a fused chain calls the
+// workers of all the stages in sequence, with no queue or thread handoff.
+// Each result object is passed to WorkerBase::processFused of the next stage:
+// by default it is still serialized and passed to processData, so a stage
+// gets the same input fused or not; a worker overriding processFused takes
+// the object with no copy. A stage not fused receives the result serialized
+// as a string, as from a socket.
+//
+// Configuration (in the entries of the "manager" array):
+//   {"name": "Calib", "stateless": true, "num_workers": 4, ...},
+//   {"name": "Filter", "inputs": ["Calib"], "stateless": true, "num_workers": 4, ...},
+//   {"name": "Stats", "inputs": ["Filter"], "num_workers": 1, ...}
+class Pipeline {
+
+    bool enabled;
+    std::vector<std::string> names;
+    std::map<std::string, int> indexes;
+    std::vector<int> num_workers;
+    std::vector<bool> sources;
+    std::vector<std::vector<int>> inputs;
+    std::vector<std::vector<int>> outputs;
+    std::vector<int> heads;  // Head of the fused chain of each stage (itself if not fused)
+    std::vector<std::vector<int>> chains;  // Stages fused after each head, in order
+    std::vector<int> order;  // Topological order
+
+    // Returns true if the edge from upstream to downstream can be fused
+    bool can_fuse(const nlohmann::json& managers, int upstream, int downstream) const;
+
+public:
+    // Constructor to build the DAG from the "manager" configuration array.
+    // Throws std::invalid_argument for unknown inputs or cycles
+    Pipeline(const nlohmann::json& managers = nlohmann::json());
+
+    // True if at least one manager declares inputs
+    bool is_enabled() const { return enabled; }
+
+    int size() const { return static_cast<int>(names.size()); }
+    const std::string& get_name(int index) const { return names[index]; }
+    int get_num_workers(int index) const { return num_workers[index]; }
+
+    // True if the manager receives the data sockets of the Supervisor
+    bool is_source(int index) const { return !enabled || sources[index]; }
+
+    const std::vector<int>& get_inputs(int index) const { return inputs[index]; }
+    const std::vector<int>& get_outputs(int index) const { return outputs[index]; }
+
+    // True if the stage runs inside the worker threads of another stage
+    bool is_fused(int index) const { return enabled && heads[index] != index; }
+
+    // Stages fused after a head, in order (empty if none)
+    const std::vector<int>& get_fused_stages(int index) const { return chains[index]; }
+
+    // Text description of the DAG for logging, e.g. "Calib+Filter -> Stats"
+    std::string describe() const;
+};
+
+#endif // PIPELINE_H
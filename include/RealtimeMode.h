@@ -0,0 +1,86 @@
+#ifndef REALTIMEMODE_H
+#define REALTIMEMODE_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <string>
+#include "json.hpp"
+#include "WorkerLogger.h"
+
+class MessageQueue;
+
+// Opt-in real-time mode for latency-critical deployments.
+//
+// At startup the process memory is locked with mlockall (current and future
+// mappings, so thread stacks and pooled buffers are resident as soon as they
+// are allocated), the stack of each latency-critical thread is prefaulted,
+// the buffer cache of the listeners is filled in advance and the input
+// queues are sized to their expected capacity, so no page fault or
+// allocation happens on the data path in steady state. Each thread entering
+// the mode gets a real-time priority according to its role:
+//   hp_listener > worker > result > lp_listener
+// Worker threads serve both queues (HP first), so they share one priority;
+// the service threads (timer service, checkpoint) keep the normal
+// scheduler. Polling threads (workers, result sender) sleep idle_sleep_us
+// when idle, so they do not starve the lower priorities. Page faults
+// observed by a thread while processing are counted, logged and reported
+// to monitoring.
+//
+// Without CAP_SYS_NICE / CAP_IPC_LOCK (or rtprio/memlock limits) the
+// corresponding step is skipped with a warning.
+//
+// Configuration (optional "realtime" section of the process configuration):
+//   "realtime": {"enabled": true, "policy": "fifo", "lock_memory": true,
+//                "priorities": {"hp_listener": 80, "worker": 70, "result": 60, "lp_listener": 50},
+//                "prefault_stack_kb": 512, "prefault_buffers": 1024, "prefault_buffer_size": 4096,
+//                "queue_capacity": 65536, "idle_sleep_us": 50}
+class RealtimeMode {
+
+    bool enabled;
+    int policy;  // SCHED_FIFO or SCHED_RR
+    bool lock_memory_enabled;
+    std::map<std::string, int> priorities;
+    size_t prefault_stack_bytes;
+    size_t prefault_buffers;
+    size_t prefault_buffer_size;
+    size_t queue_capacity;
+    int idle_sleep_us;
+    WorkerLogger* logger;
+    std::string globalname;
+
+    std::atomic<bool> memory_locked;
+    std::atomic<int> realtime_threads;
+    std::atomic<int> failed_threads;
+    std::atomic<uint64_t> minor_faults;
+    std::atomic<uint64_t> major_faults;
+    std::atomic<uint64_t> faulting_intervals;
+
+public:
+    // Constructor to initialize the mode from the "realtime" configuration section
+    RealtimeMode(const nlohmann::json& configuration, WorkerLogger* logger, const std::string& globalname);
+
+    bool is_enabled() const { return enabled; }
+
+    // Locks the process memory and prefaults the stack of the calling thread
+    void lock_memory();
+
+    // Applies the real-time priority of a role to the calling thread and
+    // prefaults its stack (and its buffer cache for the listeners)
+    void enter_thread(const std::string& role, const std::string& threadname);
+
+    // Sizes a queue to the configured capacity, so it does not grow while processing
+    void prefault_queue(MessageQueue& queue);
+
+    // Called by a polling thread with nothing to do: a real-time thread
+    // spinning would starve the lower priorities on the same core
+    void idle() const;
+
+    // Counts the page faults of the calling thread since the previous call
+    void check_faults(const std::string& threadname);
+
+    // Real-time mode state for monitoring
+    nlohmann::json get_stats() const;
+};
+
+#endif // REALTIMEMODE_H
@@ -0,0 +1,179 @@
+#ifndef RELIABLECHANNEL_H
+#define RELIABLECHANNEL_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <zmq.hpp>
+#include "json.hpp"
+#include "BufferPool.h"
+#include "ReplayBuffer.h"
+#include "WorkerLogger.h"
+
+// At-least-once delivery between two pipeline stages.
+//
+// Every result is sent as a two-frame message: a header "epoch:seq:base" and
+// the payload, where seq is the sequence number of the message on its channel
+// (0 = low priority, 1 = high priority), epoch identifies the sender instance
+// and base is the last sequence number acknowledged by the receiver when the
+// message was sent. The sender keeps the unacknowledged messages in a
+// ReplayBuffer; the receiver sends batched cumulative acks on a dedicated
+// socket and asks for a replay (go-back-N) when it detects a gap, when it
+// (re)starts or when the sender restarted. A message is acknowledged only
+// once it has been processed: the receiver tracks the pooled buffers it was
+// copied into and acks up to the last sequence number whose buffers, and
+// those of all the messages before it, have been released by the managers.
+// Messages still queued or in processing at a restart are thus replayed.
+// Messages shed by the overload governor or dropped as expired count as
+// processed (the configured policy drops them), and so do the results
+// already handed to the result queues or to in-memory downstream stages. The sender also retransmits when
+// no ack progress is seen for ack_timeout_ms (e.g. messages dropped by HWM).
+// Replays are incremental: at most replay_batch messages per channel are
+// re-sent at each service() call, so a slow consumer does not stall the
+// emission of the other results. Duplicates are discarded by the receiver.
+
+// Upstream side, owned by a WorkerManager and used by the Supervisor result thread.
+// Configuration (optional "reliable" section of a manager configuration):
+//   "reliable": {"ack_socket": "tcp://127.0.0.1:5565", "replay_buffer_bytes": 67108864,
+//                "spill_path": "/tmp/", "ack_timeout_ms": 1000, "replay_batch": 1000,
+//                "overflow_policy": "block"}
+// overflow_policy applies when the spill file cannot be written: "block"
+// holds back the results of the manager until acks free the buffer,
+// "drop_oldest" drops the oldest unacknowledged results (see ReplayBuffer).
+class ReliableSender {
+
+    struct Stream {
+        uint64_t next_seq = 1;
+        uint64_t acked = 0;
+        bool replay_pending = false;
+        uint64_t replay_next = 0;  // Next sequence number to replay (0 = no replay in progress)
+        std::chrono::steady_clock::time_point last_progress;
+        std::unique_ptr<ReplayBuffer> buffer;
+    };
+
+    std::string globalname;
+    WorkerLogger* logger;
+    uint64_t epoch;
+    int ack_timeout_ms;
+    size_t replay_batch;
+    zmq::socket_t* socket_ack;
+    Stream streams[2];
+
+    std::atomic<uint64_t> sent_count;
+    std::atomic<uint64_t> retransmitted_count;
+    std::atomic<uint64_t> replay_errors;  // Replays stopped by an unreadable spilled message
+    std::atomic<uint64_t> ack_count;
+    std::atomic<uint64_t> unacked_count[2];
+    std::atomic<uint64_t> spilled_count[2];
+    std::atomic<uint64_t> dropped_count[2];
+
+    // Sends one sequenced message
+    bool send_frame(zmq::socket_t* socket, int channel, uint64_t seq, const std::string& payload);
+
+    // Handles a received ack
+    void process_ack(const std::string& ack);
+
+    // Starts a go-back-N replay of the unacknowledged messages of a channel
+    void start_replay(int channel);
+
+    // Re-sends the next replay_batch unacknowledged messages of a channel
+    void replay(zmq::socket_t* socket, int channel);
+
+    // Updates the buffer counters of a channel for monitoring
+    void update_counts(int channel);
+
+public:
+    // Constructor to initialize the sender and bind the ack socket
+    ReliableSender(zmq::context_t& context, const nlohmann::json& configuration, const std::string& fullname, WorkerLogger* logger, const std::string& globalname);
+
+    ~ReliableSender();
+
+    // Sends a result on the given channel and keeps it until acknowledged
+    bool send(zmq::socket_t* socket, int channel, const std::string& payload);
+
+    // True if the results must be held back: the replay buffer is full and cannot spill (block policy)
+    bool is_blocked() const { return streams[0].buffer->is_full() || streams[1].buffer->is_full(); }
+
+    // Processes the pending acks, replay requests and retransmission timeouts.
+    // Must be called periodically by the thread that owns the result sockets
+    void service(zmq::socket_t* socket_lp, zmq::socket_t* socket_hp);
+
+    uint64_t get_sent_count() const { return sent_count; }
+    uint64_t get_retransmitted_count() const { return retransmitted_count; }
+    uint64_t get_replay_errors() const { return replay_errors; }
+    uint64_t get_ack_count() const { return ack_count; }
+    uint64_t get_unacked_count(int channel) const { return unacked_count[channel]; }
+    uint64_t get_spilled_count(int channel) const { return spilled_count[channel]; }
+    uint64_t get_dropped_count(int channel) const { return dropped_count[channel]; }
+};
+
+// Downstream side, one per data channel, used by the Supervisor listener thread of that channel.
+// The buffers it tracks are released by the worker threads; it must outlive them.
+// Configuration (optional "reliable_input" section of the process configuration):
+//   "reliable_input": {"ack_socket": "tcp://127.0.0.1:5565", "ack_batch": 100, "ack_interval_ms": 50}
+class ReliableReceiver : public DeliveryTracker {
+
+    // A delivered message not processed yet
+    struct Pending {
+        uint64_t seq;
+        int handles;  // Tracked buffers not released yet, plus the hold of the listener
+    };
+
+    int channel;
+    zmq::socket_t* socket_ack;
+    int ack_batch;
+    int ack_interval_ms;
+    bool started;
+    uint64_t epoch;
+    uint64_t last;  // Last sequence number delivered in order
+    uint64_t acked;  // Last sequence number acknowledged
+    uint64_t next_token;
+    std::map<uint64_t, Pending> pending;  // By token, in delivery order
+    std::mutex pending_mutex;  // Buffers are released by the worker threads
+    std::chrono::steady_clock::time_point last_ack_time;
+    std::chrono::steady_clock::time_point last_resume_time;
+
+    std::atomic<uint64_t> delivered_count;
+    std::atomic<uint64_t> duplicate_count;
+    std::atomic<uint64_t> gap_count;
+
+    // Sends a cumulative ack (or a replay request) to the sender
+    void send_ack(bool resume);
+
+    // Last sequence number processed, with all the ones before it
+    uint64_t processed();
+
+public:
+    // Constructor to initialize the receiver and connect the ack socket
+    ReliableReceiver(zmq::context_t& context, const nlohmann::json& configuration, int channel);
+
+    ~ReliableReceiver();
+
+    // Checks the header of a received message. Returns true if the payload
+    // must be delivered; token is then non-zero for a sequenced message, which
+    // stays unacknowledged until complete(token) releases the listener hold
+    // and all the buffers attached with track() are released
+    bool accept(const zmq::message_t& header, uint64_t& token);
+
+    // Attaches a buffer holding (part of) a delivered message
+    void track(uint64_t token, PooledBuffer& buffer);
+
+    // Releases a hold on a delivered message (the listener hold or a buffer)
+    void complete(uint64_t token) override;
+
+    // Sends the batched ack if enough messages were processed or time has passed
+    void flush();
+
+    // Receive timeout to set on the data socket, so that pending acks are flushed when idle
+    int get_receive_timeout() const { return ack_interval_ms; }
+
+    uint64_t get_delivered_count() const { return delivered_count; }
+    uint64_t get_duplicate_count() const { return duplicate_count; }
+    uint64_t get_gap_count() const { return gap_count; }
+};
+
+#endif // RELIABLECHANNEL_H
@@ -0,0 +1,79 @@
+#ifndef REPLAYBUFFER_H
+#define REPLAYBUFFER_H
+
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <utility>
+
+// Buffer of the sent but not yet acknowledged messages of a reliable stream.
+// The most recent messages are kept in memory up to max_memory_bytes; when the
+// budget is exceeded the oldest ones overflow to an append-only spill file, so
+// the memory stays bounded while a downstream stage is down.
+// Spilled messages are always older than the ones in memory.
+// If the spill file cannot be opened or written, the overflow policy applies:
+// DROP_OLDEST drops the oldest messages beyond the memory budget (they will
+// not be replayed), BLOCK keeps them and reports the buffer full, so the
+// sender stops sending until acks free memory.
+class ReplayBuffer {
+
+public:
+    enum OverflowPolicy { DROP_OLDEST, BLOCK };
+
+private:
+    size_t max_memory_bytes;
+    std::string spill_filename;
+    OverflowPolicy policy;
+
+    std::deque<std::pair<uint64_t, std::string>> memory;  // (sequence number, payload)
+    size_t memory_bytes;
+
+    std::fstream spill;  // Spill file, opened at the first overflow
+    std::deque<std::pair<uint64_t, std::streamoff>> spill_index;  // (sequence number, file offset)
+    std::streamoff spill_end;
+    uint64_t spilled_total;
+    bool spill_failed;  // The spill file is not usable until the buffer empties
+    uint64_t dropped_total;
+
+    // Moves the oldest in-memory messages to the spill file
+    void overflow();
+
+    // Applies the overflow policy when the spill file is not usable
+    void overflow_in_memory();
+
+    // Reads a spilled message
+    bool read_spilled(std::streamoff offset, std::string& payload);
+
+public:
+    // Constructor to initialize the buffer with a memory budget, a spill file name and an overflow policy
+    ReplayBuffer(size_t max_memory_bytes, const std::string& spill_filename, OverflowPolicy policy = BLOCK);
+
+    ~ReplayBuffer();
+
+    // Appends a sent message
+    void append(uint64_t seq, const std::string& payload);
+
+    // Removes all the messages with sequence number <= acked
+    void trim(uint64_t acked);
+
+    // Calls send for up to max_count buffered messages with sequence number >= from, in order.
+    // Returns the sequence number to continue from, or 0 if all the messages were sent.
+    // Throws std::runtime_error if a spilled message cannot be read: the replay stops there
+    uint64_t replay(uint64_t from, size_t max_count, const std::function<void(uint64_t, const std::string&)>& send);
+
+    // Removes all the messages
+    void clear();
+
+    size_t size() const { return memory.size() + spill_index.size(); }
+    size_t get_memory_bytes() const { return memory_bytes; }
+    size_t get_spilled_size() const { return spill_index.size(); }
+    uint64_t get_spilled_total() const { return spilled_total; }
+    uint64_t get_dropped_total() const { return dropped_total; }
+
+    // True if the BLOCK policy holds back new messages (spill file not usable and memory budget used)
+    bool is_full() const { return policy == BLOCK && spill_failed && memory_bytes >= max_memory_bytes; }
+};
+
+#endif // REPLAYBUFFER_H
@@ -0,0 +1,92 @@
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "json.hpp"
+
+// Content-addressed cache of the results of processData, for deterministic
+// workers receiving repeated payloads (e.g. unchanged status values).
+//
+// Results are keyed by a 128-bit hash of the payload and the priority; the
+// payload itself is not stored, so a false hit needs a 128-bit collision.
+// The cache is split in shards by key, each with its own lock: lookups take
+// it shared and only set the reference bit of the entry, inserts take it
+// exclusive and evict with the CLOCK algorithm (entries referenced since the
+// last pass of the hand get a second chance). Each shard is bounded both in
+// entries and in bytes (the size of the serialized result plus an overhead).
+// Only single messages are cached, not micro-batches, and empty results
+// (nothing emitted, e.g. a message dropped by the worker) are not cached.
+// The cache is cleared when the workers are reconfigured.
+//
+// Configuration (optional "result_cache" section of a manager configuration):
+//   "result_cache": {"max_entries": 65536, "max_mb": 64, "shards": 16}
+class ResultCache {
+
+public:
+    struct Key {
+        uint64_t low;
+        uint64_t high;
+        bool operator==(const Key& other) const { return low == other.low && high == other.high; }
+    };
+
+    // Constructor to initialize the cache from the "result_cache" section
+    explicit ResultCache(const nlohmann::json& configuration);
+
+    // 128-bit hash of a payload and its priority, 16 bytes per step
+    static Key key_of(std::string_view payload, int priority);
+
+    // Copies the cached result of a key. Returns false on a miss
+    bool lookup(const Key& key, nlohmann::json& result);
+
+    // Caches the result of a key, evicting entries if the shard is full
+    void insert(const Key& key, const nlohmann::json& result);
+
+    // Removes all the entries (the results depend on the worker configuration)
+    void clear();
+
+    // Cache statistics for monitoring
+    nlohmann::json get_stats() const;
+
+private:
+    struct KeyHash {
+        size_t operator()(const Key& key) const { return static_cast<size_t>(key.low); }
+    };
+
+    struct Entry {
+        Key key{0, 0};
+        nlohmann::json result;
+        size_t bytes = 0;  // 0 = free
+        std::atomic<bool> referenced{false};
+    };
+
+    struct Shard {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<Key, size_t, KeyHash> index;  // Key -> entry
+        std::unique_ptr<Entry[]> entries;
+        size_t used = 0;  // Entries ever filled (the first used ones)
+        size_t hand = 0;  // CLOCK hand
+        size_t bytes = 0;
+    };
+
+    size_t num_shards;
+    size_t entries_per_shard;
+    size_t bytes_per_shard;
+    std::unique_ptr<Shard[]> shards;
+
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+    std::atomic<uint64_t> evictions;
+
+    Shard& shard_of(const Key& key) { return shards[key.high % num_shards]; }
+
+    // Frees the entry under the CLOCK hand of a shard, giving referenced entries a second chance
+    size_t evict(Shard& shard);
+};
+
+#endif // RESULTCACHE_H
@@ -0,0 +1,84 @@
+#ifndef RESULTSINK_H
+#define RESULTSINK_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <zmq.hpp>
+#include "json.hpp"
+
+// Destination of the results of a result channel. A channel can fan out
+// the same results to several sinks (next pipeline stage, archive, live
+// dashboard, ...): write() must never wait on the destination, each sink
+// buffers the results and delivers them from its own thread, so a slow sink
+// only fills (and drops from) its own buffer.
+class ResultSink {
+
+public:
+    virtual ~ResultSink() {}
+
+    // Queues a result for delivery. Returns false if it was dropped
+    virtual bool write(const std::string& payload, int priority) = 0;
+
+    // Delivers the results still buffered and stops the sink
+    virtual void stop() = 0;
+
+    // Sink statistics for monitoring
+    virtual nlohmann::json get_stats() = 0;
+};
+
+// Sink sending the results to a ZeroMQ socket ("pushpull" connects a PUSH
+// socket, "pubsub" binds a PUB socket) from its own thread, with a bounded
+// buffer of capacity results, drained batch_size results at a time.
+//
+// Drop policies when the buffer is full:
+//   - "drop_newest" (default): the new result is dropped;
+//   - "drop_oldest": the oldest buffered result is dropped (live dashboards);
+//   - "block": write waits for space, back-pressuring the egress thread
+//     (only for sinks that must not lose results).
+// The socket is never written with a blocking send: a result the socket
+// cannot take (high water mark reached) is dropped, except with "block",
+// where the sink thread waits for the socket until the sink is stopped.
+//
+// Configuration (entries of the "result_sinks" array of a manager):
+//   {"type": "pubsub", "lp_socket": "tcp://*:5601", "hp_socket": "tcp://*:5602",
+//    "capacity": 10000, "batch_size": 64, "drop_policy": "drop_oldest"}
+class SocketSink : public ResultSink {
+
+    std::string endpoint;
+    std::string type;
+    zmq::socket_t socket;
+    size_t capacity;
+    size_t batch_size;
+    enum DropPolicy { DROP_NEWEST, DROP_OLDEST, BLOCK } drop_policy;
+
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    std::deque<std::string> buffer;
+    std::atomic<bool> stop_event;  // Written under the mutex, read without it while sending
+    std::thread thread;
+
+    std::atomic<uint64_t> sent_count;
+    std::atomic<uint64_t> dropped_count;
+
+    void run();
+
+    // Sends a result without blocking on the socket, applying the drop policy. Returns false if dropped
+    bool send(const std::string& payload);
+
+public:
+    SocketSink(zmq::context_t& context, const std::string& type, const std::string& endpoint, const nlohmann::json& configuration = nlohmann::json());
+    ~SocketSink();
+
+    bool write(const std::string& payload, int priority) override;
+    void stop() override;
+    nlohmann::json get_stats() override;
+};
+
+#endif // RESULTSINK_H
@@ -0,0 +1,97 @@
+#ifndef SCHEMAREGISTRY_H
+#define SCHEMAREGISTRY_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include "json.hpp"
+#include "avro/ValidSchema.hh"
+#include "avro/Decoder.hh"
+
+// Process-wide registry of Avro writer schemas by fingerprint, backed by a
+// directory of schema files (<fingerprint>.avsc, the fingerprint in 16 hex
+// digits), so no registry service is needed. All the .avsc files of the
+// directory are loaded at startup; a fingerprint not yet known is looked up
+// in the directory when a message first refers to it, so a producer can add
+// its new schema file while the pipeline runs. A fingerprint not found is
+// remembered for negative_ttl_ms, so the messages of an unknown writer do
+// not read the directory each.
+//
+// Fingerprints are the CRC-64-AVRO (Rabin) of the Parsing Canonical Form,
+// as in the Avro single-object encoding: messages starting with the marker
+// C3 01 followed by the 8-byte little-endian fingerprint of their writer
+// schema. Messages without the marker are decoded with the reader schema.
+//
+// Configuration (optional "schema_registry" section of the process configuration):
+//   "schema_registry": {"path": "schemas", "negative_ttl_ms": 1000}
+class SchemaRegistry {
+
+    std::shared_mutex mutex;
+    std::unordered_map<uint64_t, std::shared_ptr<const avro::ValidSchema>> schemas;
+    std::unordered_map<uint64_t, std::chrono::steady_clock::time_point> unknown;  // Fingerprints not found, until their expiry
+    std::string path;
+    std::chrono::milliseconds negative_ttl;
+    std::atomic<uint64_t> lookups;
+    std::atomic<uint64_t> misses;  // Unknown fingerprints
+
+    // Compiles and adds a schema. Returns its fingerprint
+    uint64_t add(const std::string& schema_json);
+
+public:
+    SchemaRegistry();
+
+    // Returns the process-wide instance
+    static SchemaRegistry& get_instance();
+
+    // Sets the directory from the "schema_registry" configuration section and loads its schemas
+    void configure(const nlohmann::json& configuration);
+
+    // Adds a schema and writes its file in the directory. Returns its fingerprint.
+    // Throws avro::Exception if the schema is not valid
+    uint64_t register_schema(const std::string& schema_json);
+
+    // Returns the writer schema of a fingerprint (nullptr if unknown)
+    std::shared_ptr<const avro::ValidSchema> lookup(uint64_t fingerprint);
+
+    // Parsing Canonical Form of a schema (Avro specification)
+    static std::string canonical_form(const nlohmann::json& schema);
+
+    // CRC-64-AVRO fingerprint of the Parsing Canonical Form of a schema
+    static uint64_t fingerprint(const std::string& schema_json);
+
+    // Reads the single-object encoding header. Returns false if the message
+    // has none; otherwise advances data past it
+    static bool read_header(const uint8_t*& data, size_t& size, uint64_t& fingerprint);
+
+    // Registry statistics for monitoring
+    nlohmann::json get_stats();
+};
+
+// Cache of compiled writer-to-reader resolving decoders for one reader
+// schema. Compiling a resolver is expensive, so it is done once per writer
+// fingerprint and the decoder is reused for every message of that writer.
+// Not thread-safe: each worker owns its cache.
+class SchemaResolverCache {
+
+    avro::ValidSchema reader;
+    uint64_t reader_fingerprint;
+    avro::DecoderPtr binary;  // Messages written with the reader schema
+    std::unordered_map<uint64_t, avro::ResolvingDecoderPtr> resolvers;  // nullptr for incompatible writers
+
+public:
+    explicit SchemaResolverCache(const std::string& reader_schema_json);
+
+    const avro::ValidSchema& get_reader() const { return reader; }
+    uint64_t get_reader_fingerprint() const { return reader_fingerprint; }
+
+    // Returns the decoder of a message, skipping its single-object header if
+    // any; resolving is false if the message is written with the reader
+    // schema. nullptr if the writer schema is unknown or cannot be resolved
+    avro::Decoder* get_decoder(const uint8_t*& data, size_t& size, bool& resolving);
+};
+
+#endif // SCHEMAREGISTRY_H
@@ -0,0 +1,65 @@
+#ifndef SHARDROUTER_H
+#define SHARDROUTER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "json.hpp"
+#include "ConsistentHashRing.h"
+
+// Decides which Supervisor instance of a sharded pipeline owns a message.
+// N instances of the same pipeline receive the same input stream and each one
+// keeps only the messages whose key hashes to its own shard on the ring, so all
+// the messages with the same key (e.g. the same monitoring point "name") are
+// always processed by the same instance and stateful managers stay correct.
+//
+// Configuration (optional "sharding" section of the process configuration):
+//   "sharding": {"num_shards": 2, "shard_id": 0, "key": "name", "virtual_nodes": 128,
+//                "missing_key": "payload"}
+// With an empty key the whole payload is hashed (balanced, no key affinity).
+// A key is only accepted with dataflow_type "string": binary Avro payloads
+// and filenames carry no JSON key, so the Supervisor rejects the
+// configuration. JSON messages without the key are counted, logged once, and
+// routed by "missing_key": "payload" hashes the whole payload (balanced, but
+// messages with the same key may go to different shards), "first_shard"
+// sends them all to shard 0 (key affinity kept, no balancing). Every shard
+// is a separate process entry in the configuration file (with its own
+// result sockets and logs) sharing the same pubsub data sockets.
+class ShardRouter {
+
+    bool enabled;
+    int shard_id;
+    int num_shards;
+    std::string key;
+    std::string key_pattern;  // "\"key\"" searched in the payload
+    bool missing_key_to_first_shard;
+    ConsistentHashRing ring;
+    std::atomic<uint64_t> accepted_count;
+    std::atomic<uint64_t> skipped_count;
+    mutable std::atomic<uint64_t> unkeyed_count;  // Messages without the key
+
+    // Extracts the value of the configured key from a JSON-encoded payload
+    bool extract_key(const char* data, size_t size, const char*& key_begin, size_t& key_size) const;
+
+public:
+    // Constructor to initialize the router from the "sharding" configuration section
+    ShardRouter(const nlohmann::json& configuration = nlohmann::json());
+
+    // Returns the shard owning the message
+    int route(const char* data, size_t size) const;
+
+    // Returns true if the message must be processed by this instance
+    bool owns(const char* data, size_t size);
+    bool owns(const std::string& data);
+
+    bool is_enabled() const { return enabled; }
+    int get_shard_id() const { return shard_id; }
+    int get_num_shards() const { return num_shards; }
+    std::string get_key() const { return key; }
+    uint64_t get_accepted_count() const { return accepted_count; }
+    uint64_t get_skipped_count() const { return skipped_count; }
+    uint64_t get_unkeyed_count() const { return unkeyed_count; }
+    bool is_missing_key_to_first_shard() const { return missing_key_to_first_shard; }
+};
+
+#endif // SHARDROUTER_H
@@ -0,0 +1,90 @@
+#ifndef SHAREDEXECUTOR_H
+#define SHAREDEXECUTOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "json.hpp"
+#include "WorkerLogger.h"
+
+class WorkerManager;
+class WorkerThread;
+class MessageQueue;
+class RealtimeMode;
+
+// Process-wide pool of worker threads serving the queues of all the managers,
+// with weighted fair sharing.
+//
+// Each executor thread runs one shared worker thread per manager (with its
+// own worker, outside the token rings of the manager) and, at each step,
+// picks the manager to serve with start-time fair queuing: the virtual time
+// of a manager advances by the processing time it used divided by its
+// weight, and the manager with a backlog and the smallest virtual time is
+// served. A manager becoming busy again starts from the virtual time of the
+// system, so idle periods do not build up credit. The first executor
+// threads are reserved to the managers in turn, min_workers each: a
+// reserved thread serves its manager whenever it has a backlog, the others
+// only when it has none. The executor threads add to the worker threads of
+// each manager; managers in process mode and fused stages are not served.
+//
+// Configuration (optional "shared_executor" section of the process configuration):
+//   "shared_executor": {"num_workers": 4}
+// and (optional "executor" section of a manager configuration):
+//   "executor": {"weight": 1.0, "min_workers": 0}
+class SharedExecutor {
+
+    struct Member {
+        WorkerManager* manager;
+        std::shared_ptr<MessageQueue> low_priority_queue;
+        std::shared_ptr<MessageQueue> high_priority_queue;
+        double weight;
+        int min_workers;
+        std::vector<std::shared_ptr<WorkerThread>> threads;  // One per executor thread
+        std::atomic<int64_t> vtime{0};  // Virtual time, in weighted nanoseconds
+        std::atomic<uint64_t> steps{0};
+        std::atomic<int64_t> busy_ns{0};
+    };
+
+    int num_workers;
+    RealtimeMode* realtime;
+    WorkerLogger* logger;
+    std::string globalname;
+    std::vector<std::unique_ptr<Member>> members;
+    std::vector<int> reserved;  // Member served first by each executor thread (-1 = none)
+    std::atomic<int64_t> system_vtime;  // Start time of the last step
+    std::atomic<bool> _stop_event;
+    std::vector<std::thread> threads;
+
+    // Main loop of an executor thread
+    void run(int index);
+
+    // Member to serve by an executor thread (-1 if no manager has a backlog)
+    int pick(int index) const;
+
+    bool has_backlog(const Member& member, int index) const;
+
+    // Charges the processing time of a step to the virtual time of a member
+    void charge(Member& member, int64_t cost_ns);
+
+public:
+    // Constructor to initialize the executor from the "shared_executor" section
+    SharedExecutor(const nlohmann::json& configuration, RealtimeMode* realtime, WorkerLogger* logger, const std::string& globalname);
+
+    ~SharedExecutor();
+
+    int get_num_workers() const { return num_workers; }
+
+    // Adds a manager to the managers served (before start)
+    void add_manager(WorkerManager* manager);
+
+    void start();
+    void stop();
+
+    // Share of the executor of a manager, for its monitoring (null if not served)
+    nlohmann::json get_stats(const WorkerManager* manager) const;
+};
+
+#endif // SHAREDEXECUTOR_H
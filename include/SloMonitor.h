@@ -0,0 +1,153 @@
+#ifndef SLOMONITOR_H
+#define SLOMONITOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "json.hpp"
+#include "WorkerLogger.h"
+#include "TimerService.h"
+
+class WorkerManager;
+
+// Lock-free log-linear histogram of latencies in nanoseconds: 8 sub-buckets
+// per power of two (relative error below 12.5%), up to about 2^40 ns (18
+// minutes). record() is a relaxed atomic increment, safe from any thread.
+class LatencyHistogram {
+
+public:
+    static const int SUB_BUCKETS = 8;
+    static const int NUM_BUCKETS = 38 * SUB_BUCKETS + SUB_BUCKETS;
+
+    LatencyHistogram();
+
+    // Records a latency
+    void record(int64_t latency_ns);
+
+    // Copies the cumulative counts of the buckets
+    void snapshot(std::vector<uint64_t>& counts) const;
+
+    // Bucket of a latency
+    static int bucket_of(int64_t latency_ns);
+
+    // Upper bound of the latencies of a bucket
+    static int64_t bucket_upper_ns(int bucket);
+
+    // Latency of a percentile (0-100) of counts, as the upper bound of its bucket (0 if empty)
+    static int64_t percentile_ns(const std::vector<uint64_t>& counts, double percentile);
+
+private:
+    std::atomic<uint64_t> buckets[NUM_BUCKETS];
+};
+
+// Latency service level objectives of a manager, checked with multi-window
+// burn rates.
+//
+// The latency of every message (from reception by the manager to its results
+// being queued) is recorded in one histogram per priority. An objective
+// "p<percentile> < threshold_ms" allows an error budget of (100 - percentile)%
+// of the messages above the threshold. Every interval the monitor counts the
+// messages above the threshold in the histogram (the bucket of the threshold
+// counts as within it) and computes, over each window, the burn rate: the
+// fraction of slow messages divided by the budget (1 = the budget is used up
+// exactly at the end of the window). A rule fires when both its long and
+// short window burn faster than its burn rate: the long window avoids paging
+// for short spikes, the short one stops the alarm soon after the recovery.
+// Firing and recovery are reported with send_alarm, naming the manager
+// (the pipeline stage) and the objective.
+//
+// Configuration (optional "slo" section of a manager configuration):
+//   "slo": {"interval_ms": 1000,
+//           "objectives": [{"priority": "hp", "percentile": 99, "threshold_ms": 5},
+//                          {"priority": "lp", "percentile": 95, "threshold_ms": 100}],
+//           "windows": [{"long_s": 3600, "short_s": 300, "burn_rate": 14.4, "level": 2},
+//                       {"long_s": 21600, "short_s": 1800, "burn_rate": 6, "level": 1}]}
+class SloMonitor {
+
+    struct Interval {
+        uint64_t total = 0;
+        uint64_t bad = 0;
+    };
+
+    struct Window {
+        int intervals;
+        uint64_t total = 0;
+        uint64_t bad = 0;
+    };
+
+    struct Rule {
+        int long_window;  // Index in window_intervals (and Objective::windows)
+        int short_window;
+        double burn_rate;
+        int level;
+    };
+
+    struct Objective {
+        int priority;
+        double percentile;
+        int64_t threshold_ns;
+        int threshold_bucket;
+        double budget;  // Allowed fraction of slow messages
+        std::string name;  // e.g. "hp p99 < 5 ms"
+        uint64_t last_total = 0;
+        uint64_t last_bad = 0;
+        std::vector<Interval> ring;  // Last intervals, for the longest window
+        std::vector<Window> windows;  // Running sums over each window length
+        std::vector<bool> firing;  // Per rule
+        std::vector<double> burn_rates;  // Per window, of the last interval
+    };
+
+    WorkerManager* manager;
+    WorkerLogger* logger;
+    std::string fullname;
+    std::string globalname;
+    int interval_ms;
+
+    LatencyHistogram histograms[2];  // 0 = low priority, 1 = high priority
+    std::vector<uint64_t> counts;  // Scratch for the histogram snapshots
+    std::vector<uint64_t> last_counts[2];  // Of the previous interval, for the current percentiles
+    std::vector<Objective> objectives;
+    std::vector<Rule> rules;
+    std::vector<int> window_intervals;  // Distinct window lengths, in intervals
+    size_t ring_head;
+    size_t ring_filled;
+    std::atomic<uint64_t> alarms;
+
+    mutable std::mutex mutex;  // Protects the objectives and stats between check and get_stats
+    int64_t current_p50_ns[2];
+    int64_t current_p99_ns[2];
+    int64_t current_p999_ns[2];
+
+    TimerService::TimerId timer;  // Periodic check (0 = not started)
+
+    // Index of a window length in window_intervals, adding it if needed
+    int add_window(int intervals);
+
+    // Fraction of slow messages of a window divided by the budget
+    static double burn_rate(const Window& window, double budget);
+
+public:
+    static const int ALARM_CODE_SLO_BURN = 110;
+    static const int ALARM_CODE_SLO_RECOVERED = 111;
+
+    // Constructor to initialize the monitor from the "slo" configuration section
+    SloMonitor(const nlohmann::json& configuration, WorkerManager* manager, WorkerLogger* logger, const std::string& fullname, const std::string& globalname);
+    ~SloMonitor();
+
+    // Records the latency of a message, from reception to results
+    void record(int priority, int64_t latency_ns) { histograms[priority ? 1 : 0].record(latency_ns); }
+
+    // Closes an interval: updates the burn rates and fires or clears the alarms
+    void check();
+
+    // Starts and stops the periodic checks on the timer service
+    void start();
+    void stop();
+
+    // Objectives, burn rates and current percentiles for monitoring
+    nlohmann::json get_stats() const;
+};
+
+#endif // SLOMONITOR_H
@@ -0,0 +1,67 @@
+#ifndef STRINGINTERNER_H
+#define STRINGINTERNER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Process-wide table mapping the repeated telemetry identifiers (assembly,
+// name, serial_number, units, env_id) to compact integer ids.
+//
+// The table is mostly read-only: after warm-up every lookup is a hit, done
+// under a shared lock, and the id -> string accessor is lock-free (entries
+// are never moved nor removed). The ids replace the strings in the columnar
+// batches and key the per-name aggregation (ColumnarOps::group_by_name).
+// Routing and sharding work on the raw messages, before they are decoded,
+// so they do not use the ids. Ids are only meaningful inside one process.
+class StringInterner {
+
+    struct Entry {
+        std::string str;
+        uint32_t next;  // Next id with the same hash (collision chain), or NONE
+    };
+
+    static const uint32_t NONE = 0xffffffff;
+    static const uint32_t CHUNK_BITS = 12;
+    static const uint32_t CHUNK_SIZE = 1u << CHUNK_BITS;
+    static const uint32_t MAX_CHUNKS = 4096;
+
+    mutable std::shared_mutex mutex;
+    std::unordered_map<uint64_t, uint32_t> index;  // hash -> first id with that hash
+    std::array<std::atomic<Entry*>, MAX_CHUNKS> chunks;  // Fixed-size chunks of entries
+    std::atomic<uint32_t> count;
+
+    Entry& entry(uint32_t id) const { return chunks[id >> CHUNK_BITS].load(std::memory_order_acquire)[id & (CHUNK_SIZE - 1)]; }
+
+    // Looks up a string with the given hash. Requires the lock
+    uint32_t lookup(std::string_view str, uint64_t hash) const;
+
+public:
+    StringInterner();
+    ~StringInterner();
+
+    StringInterner(const StringInterner&) = delete;
+    StringInterner& operator=(const StringInterner&) = delete;
+
+    // Returns the process-wide interner
+    static StringInterner& instance();
+
+    // Returns the id of a string, adding it if needed
+    uint32_t intern(std::string_view str);
+
+    // Returns true and the id if the string is already interned
+    bool find(std::string_view str, uint32_t& id) const;
+
+    // Returns the string of an id (lock-free)
+    const std::string& get_string(uint32_t id) const { return entry(id).str; }
+
+    // Returns the number of interned strings
+    uint32_t size() const { return count.load(std::memory_order_acquire); }
+};
+
+#endif // STRINGINTERNER_H
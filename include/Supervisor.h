@@ -2,6 +2,7 @@
 #define SUPERVISOR_H
 
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 #include <zmq.hpp>
@@ -16,6 +17,19 @@
 #include "WorkerLogger.h"
 #include "ConfigurationManager.h"
 #include "WorkerManager.h"
+#include "ShardRouter.h"
+#include "ReliableChannel.h"
+#include "BufferPool.h"
+#include "RealtimeMode.h"
+#include "HugePages.h"
+#include "TimerService.h"
+#include "Pipeline.h"
+#include "SharedExecutor.h"
+#include "PerCoreMode.h"
+#include "JsonView.h"
+#include "SchemaRegistry.h"
+#include "ResultSink.h"
+#include "AvroFileSink.h"
 
 using json = nlohmann::json;
 
@@ -25,8 +39,19 @@ class Supervisor {
     // Helper function to decode data
     json decode_data(zmq::message_t &data);
 
-    // Helper function to open file
-    std::pair<std::vector<json>, int> open_file(const std::string &filename);
+    // Helper function to read a file of JSON lines, validated on demand without building a DOM.
+    // The valid lines are returned as views on contents
+    int read_records(const std::string &filename, std::string &contents, std::vector<std::string_view> &records);
+
+    // Helper function to receive a data message and its optional deadline, checking its sequence number in reliable mode.
+    // A non-zero token must be released with receiver->complete once the buffers of the message are tracked
+    bool receive_data(zmq::socket_t *socket, ReliableReceiver *receiver, zmq::message_t &data, int64_t &deadline_ns, uint64_t &token, zmq::recv_flags flags = zmq::recv_flags::none);
+
+    // Helper function to receive up to an ingest batch of messages into pooled buffers
+    size_t receive_batch(zmq::socket_t *socket, ReliableReceiver *receiver, int priority, std::vector<PooledBuffer> &received);
+
+    // Helper function to send a result to the result file or socket of a channel, through the reliable sender if configured
+    void send_payload(WorkerManager *manager, int indexmanager, int channel, const std::string &payload);
 
     // Static pointer to the current instance
     static Supervisor* instance;
@@ -49,18 +74,27 @@ public:
     // Set up result channel for a given WorkerManager
     void setup_result_channel(WorkerManager *manager, int indexmanager);
 
+    // Creates a buffered result sink of a given type ("file", "pushpull" or "pubsub")
+    std::unique_ptr<ResultSink> create_result_sink(const std::string &type, const std::string &endpoint, const std::string &prefix, const json &configuration);
+
     // Start managers
     void start_managers();
 
     // Start workers
     void start_workers();
 
+    // Connect the managers of the pipeline DAG in memory, after start_managers
+    void connect_pipeline();
+
     // Start Supervisor operation
     virtual void start();
 
     // Static function to handle signals
     static void handle_signals(int signum);
 
+    // Handles a coordination message of another shard in per-core mode (to be reimplemented)
+    virtual void on_shard_message(int from_core, const std::string &message);
+
     // Listen for result data
     void listen_for_result();
 
@@ -153,6 +187,8 @@ public:
     zmq::socket_t *socket_monitoring;
     std::vector<zmq::socket_t*> socket_lp_result;
     std::vector<zmq::socket_t*> socket_hp_result;
+    std::vector<std::vector<std::unique_ptr<ResultSink>>> sink_lp_result;  // Buffered result sinks ("file" channel and "result_sinks")
+    std::vector<std::vector<std::unique_ptr<ResultSink>>> sink_hp_result;
     std::vector<std::string> getNameWorkers() const;
     WorkerLogger *logger;
     ConfigurationManager *config_manager;
@@ -168,6 +204,13 @@ public:
     std::string dataflowtype;
     std::string datasockettype;
     std::vector<WorkerManager*> manager_workers;
+    ShardRouter *shard_router;
+    ReliableReceiver *reliable_lp_receiver;
+    ReliableReceiver *reliable_hp_receiver;
+    RealtimeMode *realtime;
+    Pipeline *pipeline;
+    SharedExecutor *shared_executor;  // nullptr if the managers have only their own worker threads
+    CrossShardChannel *cross_shard;  // nullptr if not in per-core mode
     int processdata;
     bool stopdata;
     std::string status;
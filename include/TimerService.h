@@ -0,0 +1,116 @@
+#ifndef TIMERSERVICE_H
+#define TIMERSERVICE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "json.hpp"
+
+// Process-wide timer service: a single thread drives all the periodic and
+// one-shot timers of the process (worker rate computation, monitoring ticks,
+// overload checks, ...) instead of one sleeping thread per component, so the
+// number of threads and wakeups does not grow with the worker pool.
+//
+// Timers are kept in a hierarchical timing wheel: 256 slots of one tick for
+// the next 256 ticks, then three levels of 64 slots, each covering 64 times
+// the previous one; timers are moved down one level when their slot comes
+// up. Scheduling and cancelling are O(1). The thread sleeps until the next
+// non-empty slot (or the next cascade), with absolute deadlines, so periodic
+// timers do not drift. Callbacks run on the timer thread and must be short:
+// blocking work (e.g. disk writes) must stay on its own thread.
+//
+// Configuration (optional "timer_service" section of the process configuration):
+//   "timer_service": {"tick_ms": 1}
+class TimerService {
+
+public:
+    using Callback = std::function<void()>;
+    using TimerId = uint64_t;
+
+private:
+    static const int LEVEL0_BITS = 8;
+    static const int LEVEL_BITS = 6;
+    static const int NUM_LEVELS = 4;
+    static const uint64_t LEVEL0_SIZE = 1 << LEVEL0_BITS;
+    static const uint64_t LEVEL_SIZE = 1 << LEVEL_BITS;
+
+    struct Timer {
+        uint64_t expires;  // Tick
+        uint64_t period;  // Ticks, 0 for one-shot timers
+        Callback callback;
+    };
+
+    int64_t tick_ns;
+    int64_t start_ns;  // Time of tick 0 (steady clock)
+    uint64_t current_tick;  // Last tick processed
+
+    std::unordered_map<TimerId, Timer> timers;
+    // Slots of the wheel: ids of the timers expiring in the slot. Cancelled
+    // timers are removed from the map only and skipped when their slot is processed
+    std::vector<std::vector<TimerId>> wheel[NUM_LEVELS];
+    TimerId next_id;
+    TimerId running_id;  // Timer whose callback is running (0 = none)
+
+    std::thread thread;
+    std::thread::id thread_id;
+    bool stop_event;
+    std::mutex mutex;
+    std::condition_variable wakeup_cv;
+    std::condition_variable done_cv;  // Signalled when a callback returns
+
+    std::atomic<uint64_t> fired_count;
+    std::atomic<uint64_t> wakeup_count;
+    std::atomic<int64_t> max_lateness_ns;
+
+    // Inserts a timer id in the wheel slot of its expiry. Requires the lock
+    void insert(TimerId id, uint64_t expires);
+
+    // Moves the timers of a slot of an upper level down the wheel. Requires the lock
+    void cascade(int level, uint64_t index);
+
+    // Next tick to wake up at: the next non-empty slot of level 0 or the next cascade. Requires the lock
+    uint64_t next_wakeup_tick() const;
+
+    // Advances the wheel up to the given tick, running the expired callbacks
+    void advance(uint64_t tick, std::unique_lock<std::mutex>& lock);
+
+    // Adds a timer expiring after delay_ns, then every period_ns if not 0
+    TimerId add(int64_t delay_ns, int64_t period_ns, Callback callback);
+
+    void run();
+
+public:
+    TimerService();
+    ~TimerService();
+
+    // Returns the process-wide instance
+    static TimerService& get_instance();
+
+    // Sets the tick from the "timer_service" configuration section. Call before the first timer is scheduled
+    void configure(const nlohmann::json& configuration);
+
+    // Starts the timer thread (also started by the first timer scheduled)
+    void start();
+    void stop();
+
+    // Schedules a callback after delay_ns
+    TimerId schedule(int64_t delay_ns, Callback callback);
+
+    // Schedules a callback every period_ns, the first time after period_ns
+    TimerId schedule_periodic(int64_t period_ns, Callback callback);
+
+    // Cancels a timer. When it returns the callback is not running and will
+    // not run again (unless called from the callback itself). Returns false
+    // if the timer was not found (already fired or cancelled)
+    bool cancel(TimerId id);
+
+    // Timer service statistics for monitoring
+    nlohmann::json get_stats();
+};
+
+#endif // TIMERSERVICE_H
@@ -16,12 +16,37 @@
 #include <random>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include "Supervisor.h"
+#include "SchemaRegistry.h"
 
 class Worker1 : public WorkerBase {
 private:
-    avro::ValidSchema avro_schema; // Store schema
+    avro::ValidSchema avro_schema; // Store schema (reader schema)
+    std::unique_ptr<SchemaResolverCache> resolvers;  // Writer-to-reader resolvers of the evolved producer schemas
+    int aggregate_batches = -1;  // Manager "batch_result" is "aggregate" (-1 = not read yet)
+
+    // Running totals of a monitoring point name over the aggregated batches,
+    // checkpointed as {name: {"count", "sum"}}
+    struct NameTotals {
+        uint64_t count = 0;
+        double sum = 0;
+    };
+    std::unordered_map<std::string, NameTotals> totals;
+
+    // Publishes the running totals for checkpointing
+    void publish_totals();
+
+    // True if the micro-batches yield per-name aggregates instead of one result per record
+    bool is_aggregating();
+
+    // Decodes a message, resolving it from its writer schema if it has a
+    // single-object header. Returns false if the writer schema is unknown
+    bool decode_datum(const uint8_t* data, size_t size, avro::GenericDatum& datum);
+
+    // Appends a decoded AvroMonitoringPoint record to a columnar batch
+    static void append_record(const avro::GenericRecord& record, ColumnarBatch& batch);
 
     // Helper function to generate random duration between 0 and 100 milliseconds
     double random_duration();
@@ -36,6 +61,24 @@ public:
     // Override the process_data method
     //std::string process_data(const std::string& data);
     nlohmann::json processData(const nlohmann::json& data, int priority);
+
+    // Override to decode the Avro records straight into the columnar batch
+    bool decodeToBatch(std::string_view data, ColumnarBatch& batch);
+
+    // Override to process a batch with columnar operators. By default a batch
+    // yields the same results as processData, one {name, priority} per record,
+    // whatever the (adaptive) batch size. With "batch_result": "aggregate" in
+    // the manager configuration it yields instead one {name, count, mean,
+    // total_count, total_mean, priority} per monitoring point name found in
+    // the batch, the totals running over the batches of this worker (and the
+    // checkpoint restored at startup)
+    nlohmann::json processBatch(const ColumnarBatch& batch, int priority);
+
+    // Override to restore the running totals from a checkpoint
+    void restore(const nlohmann::json& state);
+
+    // Override to add up the running totals of a name kept by two workers
+    void merge_state(nlohmann::json& into, const nlohmann::json& from) const;
 };
 
 #endif // WORKER1_H
@@ -2,12 +2,18 @@
 #define WORKERBASE_H
 
 #include <string>
+#include <string_view>
 #include <iostream>
+#include <atomic>
+#include <memory>
 #include "json.hpp" 
 #include <zmq.hpp>     
 #include "spdlog/spdlog.h"
 #include "spdlog/sinks/basic_file_sink.h"
 #include "spdlog/fmt/fmt.h"
+#include "ColumnarBatch.h"
+#include "JsonView.h"
+#include "WorkerMetrics.h"
 
 
 class WorkerManager;
@@ -22,6 +28,44 @@ class WorkerBase {
     std::string workersname;
     std::string fullname;
 
+    // Last state snapshot published for checkpointing (copy-on-write)
+    std::shared_ptr<const nlohmann::json> checkpoint_state;
+    std::atomic<uint64_t> state_version;
+
+    JsonDocument document;  // Reused for every message parsed on demand
+    nlohmann::json fused_payload = nlohmann::json::string_t();  // Reused serialization of the fused input
+    WorkerMetrics metrics;  // Timers and counters of the worker, published in the monitoring of its manager
+
+protected:
+    // Parses a JSON message on demand: fields are decoded lazily when read
+    // through the returned view, valid until the next call and while data
+    // lives. Returns an invalid view if the message is not valid JSON (see
+    // get_parse_error). The nlohmann DOM stays available through to_json()
+    JsonValue parse_view(std::string_view data);
+    const std::string& get_parse_error() const { return document.get_error(); }
+
+    // Publishes a new immutable snapshot of the worker state, a JSON object
+    // keyed by state key (e.g. the monitoring point name). Stateful workers
+    // call it when their state changes; snapshots already taken by the
+    // checkpoint thread stay valid
+    void publish_state(nlohmann::json state);
+
+    // Timing hooks for the sub-steps of processData. Ids are registered once,
+    // e.g. in a static local, then used on every message:
+    //   static const int decode = timer_id("decode");
+    //   { auto timer = time_scope(decode); ... }
+    //   count(counter_id("malformed"));
+    // Results appear in the "worker_metrics" section of the manager monitoring.
+    // Built with RTADP_WORKER_METRICS=0 the hooks compile to nothing
+    static int timer_id(const std::string& name) { return WorkerMetrics::register_metric(name, true); }
+    static int counter_id(const std::string& name) { return WorkerMetrics::register_metric(name, false); }
+    ScopedTimer time_scope(int id) { return ScopedTimer(&metrics, id); }
+    void count(int id, uint64_t value = 1) {
+#if RTADP_WORKER_METRICS
+        metrics.add_count(id, value);
+#endif
+    }
+
 public:
     WorkerBase();
     virtual ~WorkerBase();
@@ -29,10 +73,45 @@ public:
     // Initialize the worker with manager, supervisor, and names
     void init(WorkerManager* manager, Supervisor* supervisor, const std::string& workersname, const std::string& fullname);
 
-    void config(const nlohmann::json& configuration);
+    virtual void config(const nlohmann::json& configuration);
 
     // virtual std::string process_data(const std::string& data);
-    nlohmann::json processData(const nlohmann::json& data, int priority);
+    virtual nlohmann::json processData(const nlohmann::json& data, int priority);
+
+    // Decodes one dequeued message into a columnar micro-batch (used when the
+    // manager "batch_size" is > 1). The data is a view on the pooled message
+    // buffer, valid only during the call. Returns false if the message is not
+    // a monitoring point, in which case it is processed with processData. A
+    // malformed record must not throw: it is counted, skipped and true is
+    // returned, so the rest of the batch is kept
+    virtual bool decodeToBatch(std::string_view data, ColumnarBatch& batch);
+
+    // Processes the result of the previous stage of a fused pipeline chain, in
+    // the same worker thread with no queue or handoff. The default passes the
+    // result serialized to processData, as over a socket or in-memory edge; a
+    // worker overriding it receives the result object itself, with no copy
+    virtual nlohmann::json processFused(const nlohmann::json& result, int priority);
+
+    // Processes a micro-batch of messages with the same priority. Returns a
+    // result or an array of results. The default calls processData for every record
+    virtual nlohmann::json processBatch(const ColumnarBatch& batch, int priority);
+
+    // Returns the last published state snapshot (nullptr for stateless workers)
+    virtual std::shared_ptr<const nlohmann::json> serialize() const;
+
+    // Restores the worker state from a checkpoint, called before processing starts
+    virtual void restore(const nlohmann::json& state);
+
+    // Merges into the checkpoint state of a key the state of the same key
+    // published by another worker. The default keeps the last one
+    virtual void merge_state(nlohmann::json& into, const nlohmann::json& from) const;
+
+    // Returns the version of the published state, incremented at each publish_state
+    uint64_t get_state_version() const;
+
+    const WorkerMetrics& get_metrics() const { return metrics; }
+
+    WorkerManager* get_manager() const { return manager; }
 
     Supervisor* get_supervisor() const{{
         return supervisor;
@@ -24,6 +24,14 @@
 #include "MonitoringThread.h"
 #include "Supervisor.h"
 #include "WorkerProcess.h"
+#include "CheckpointManager.h"
+#include "ReliableChannel.h"
+#include "MessageQueue.h"
+#include "BatchController.h"
+#include "OverloadGovernor.h"
+#include "SloMonitor.h"
+#include "HedgeController.h"
+#include "ResultCache.h"
 
 
 using json = nlohmann::json;
@@ -40,6 +48,7 @@ private:
     std::string status;
     std::string workersname;
     std::shared_ptr<json> config;
+    json manager_config;
     WorkerLogger* logger;
     std::string fullname;
     std::string globalname;
@@ -54,12 +63,39 @@ private:
     int pid;
     zmq::context_t&  context;
     zmq::socket_t* socket_monitoring;
-    std::shared_ptr<std::queue<std::string>> low_priority_queue;
-    std::shared_ptr<std::queue<std::string>> high_priority_queue;
+    std::shared_ptr<MessageQueue> low_priority_queue;
+    std::shared_ptr<MessageQueue> high_priority_queue;
     std::shared_ptr<std::queue<std::string>> result_lp_queue;
     std::shared_ptr<std::queue<std::string>> result_hp_queue;
     MonitoringPoint* monitoringpoint;
     MonitoringThread* monitoringthread;
+    std::unique_ptr<CheckpointManager> checkpoint_manager;
+    ReliableSender* reliable_sender;
+    BatchController* batch_controller;
+    int batch_size;
+    OverloadGovernor* overload_governor;
+    SloMonitor* slo_monitor;
+    HedgeController* hedge_controller;
+    ResultCache* result_cache;
+    bool source;  // Receives the data sockets of the Supervisor
+    bool fused;  // Runs inside the worker threads of the head of its fused chain
+    std::vector<WorkerManager*> fused_stages;  // Stages fused after this one
+    std::vector<WorkerManager*> downstream;  // Managers receiving the results in memory
+    bool result_output;  // Results sent by the result thread of the Supervisor (see has_result_output)
+    std::vector<std::shared_ptr<WorkerBase>> fused_workers;  // Workers run by the threads of the head
+    WorkerManager* result_ring;  // Manager whose worker threads emit the results of this one (the head of its fused chain, or this)
+    // Size-aware routing: messages of large_message_size bytes or more are
+    // queued to a dedicated sub-pool of worker threads (0 = disabled)
+    size_t large_message_size;
+    int large_num_workers;
+    std::shared_ptr<MessageQueue> large_lp_queue;
+    std::shared_ptr<MessageQueue> large_hp_queue;
+    std::vector<std::shared_ptr<WorkerBase>> large_workers;
+    std::vector<std::shared_ptr<WorkerThread>> large_worker_threads;
+    std::atomic<uint64_t> large_routed;
+    // Worker threads of this manager run by the shared executor of the Supervisor
+    std::vector<std::shared_ptr<WorkerBase>> shared_workers;
+    std::vector<std::shared_ptr<WorkerThread>> shared_worker_threads;
     std::vector<std::shared_ptr<WorkerThread>> workerprocesses;
     std::vector<std::shared_ptr<WorkerProcess>> worker_processes;
     std::thread worker_thread;  // Thread object for running the manager
@@ -68,6 +104,7 @@ private:
     int workersstatusinit;
     std::shared_ptr<std::mutex> tokenresultslock;
     std::shared_ptr<std::mutex> tokenreadinglock;
+    std::shared_ptr<std::mutex> workerthreadslock;  // Guards worker_threads against the service threads
     std::atomic<bool> continueall;
     std::atomic<int> processdata;
     std::atomic<bool> stopdata;
@@ -79,10 +116,14 @@ private:
  
     // Helper function to clean a single queue
     void clean_single_queue(std::shared_ptr<std::queue<std::string>>& queue, const std::string& queue_name);
+    void clean_single_queue(std::shared_ptr<MessageQueue>& queue, const std::string& queue_name);
  
     // Helper function to close a queue
     void close_queue(std::shared_ptr<std::queue<std::string>>& queue, const std::string& queue_name);
 
+    // Applies the "deadline_scheduling" configuration to a pair of input queues
+    void setup_deadline_scheduling(MessageQueue& lp_queue, MessageQueue& hp_queue);
+
 public:
     // Constructor
     WorkerManager(int manager_id, Supervisor* supervisor, const std::string& name = "None");
@@ -107,6 +148,15 @@ public:
  
     // Function to start worker threads (to be reimplemented)
     virtual void start_worker_threads(int num_threads);
+
+    // Adds a worker thread to the main pool
+    void add_worker_thread(std::shared_ptr<WorkerThread> thread);
+
+    // Starts the worker threads of the large message sub-pool, numbered from first_worker_id
+    void start_large_worker_threads(int first_worker_id);
+ 
+    // Creates a worker thread of this manager for a thread of the shared executor
+    std::shared_ptr<WorkerThread> create_shared_worker_thread();
  
     // Function to start worker processes (to be reimplemented)
     virtual void start_worker_processes(int num_processes);
@@ -128,6 +178,9 @@ public:
     // Function to configure workers
     void configworkers(const json& configuration);
 
+    // Function to register a worker for checkpointing (the first one restores the last checkpoint)
+    void register_worker(WorkerBase* worker);
+
     void setWorkerStatus(int worker_id, int status);
 
     void setProcessingRate(int worker_id, double rate);
@@ -138,15 +191,62 @@ public:
     Supervisor* getSupervisor() const;
 
     std::string getName() const;
-    std::shared_ptr<std::queue<std::string>> getLowPriorityQueue() const;
-    std::shared_ptr<std::queue<std::string>> getHighPriorityQueue() const;
+    const json& getManagerConfig() const { return manager_config; }
+    std::shared_ptr<MessageQueue> getLowPriorityQueue() const;
+    std::shared_ptr<MessageQueue> getHighPriorityQueue() const;
+    std::shared_ptr<MessageQueue> getLargeLowPriorityQueue() const { return large_lp_queue; }
+    std::shared_ptr<MessageQueue> getLargeHighPriorityQueue() const { return large_hp_queue; }
+    bool is_size_routing() const { return large_message_size > 0; }
     // std::shared_ptr<std::queue<json>> getResultLpQueue() const;
     // std::shared_ptr<std::queue<json>> getResultHpQueue() const;
     // std::shared_ptr<std::queue<json>> getLowPriorityQueue() const;
     // std::shared_ptr<std::queue<json>> getHighPriorityQueue() const;
     MonitoringPoint* getMonitoringPoint() const;
     MonitoringThread* getMonitoringThread() const;
-    std::thread monitoring_thread;
+    CheckpointManager* getCheckpointManager() const;
+    ReliableSender* getReliableSender() const;
+    BatchController* getBatchController() const;
+    OverloadGovernor* getOverloadGovernor() const;
+    SloMonitor* getSloMonitor() const;
+    HedgeController* getHedgeController() const;
+    ResultCache* getResultCache() const;
+
+    // Queues received messages, shedding LP load if the manager is overloaded;
+    // large messages go to the queues of the large message sub-pool
+    void enqueue(int priority, const std::vector<PooledBuffer>& received);
+
+    // Queues a result for the result sockets. Safe from any worker thread
+    void queue_result(int priority, const std::string& result);
+
+    // Size-aware routing state for monitoring
+    json get_size_routing_stats() const;
+
+    // Connects the manager in the pipeline DAG of the Supervisor
+    void set_pipeline(bool source, bool fused, const std::vector<WorkerManager*>& fused_stages, const std::vector<WorkerManager*>& downstream);
+    bool is_source() const { return source; }
+    bool is_fused() const { return fused; }
+    const std::vector<WorkerManager*>& getFusedStages() const { return fused_stages; }
+    bool has_downstream() const { return !downstream.empty(); }
+    // True if the results go to a result socket or file, or to "result_sinks"
+    bool has_result_output() const { return result_output; }
+
+    // Manager of the last stage fused after this one (this if none): it owns the results
+    WorkerManager* getOutputManager() { return fused_stages.empty() ? this : fused_stages.back(); }
+
+    // Forwards a result to the input queues of the downstream managers
+    void forward(int priority, const std::string& payload);
+
+    // Creates a worker of this manager (to be reimplemented)
+    virtual std::shared_ptr<WorkerBase> create_worker();
+
+    // Creates the worker of this stage run by the worker thread worker_id of the head of its fused chain
+    WorkerBase* create_fused_worker(int worker_id);
+    const std::vector<std::shared_ptr<WorkerBase>>& getFusedWorkers() const { return fused_workers; }
+
+    int get_manager_id() const { return manager_id; }
+
+    // Returns the current batch size of a priority class (adaptive if configured)
+    int get_batch_size(int priority) const;
     std::shared_ptr<std::queue<std::string>> getResultLpQueue() const;
     std::shared_ptr<std::queue<std::string>> getResultHpQueue() const;
  
@@ -194,7 +294,7 @@ public:
     // Getter for worker_status_shared
     std::vector<std::atomic<int>>& getWorkerStatusShared();
 
-    // Getter for worker_threads
+    // Getter for worker_threads (a copy taken under the lock)
     std::vector<std::shared_ptr<WorkerThread>> getWorkerThreads();
 
 
@@ -20,8 +20,12 @@ public:
     // Override to start worker processes
     void start_worker_processes(int num_processes);
 
+    // Override to create the workers of fused pipeline stages
+    std::shared_ptr<WorkerBase> create_worker();
+
 private:
     int manager_id;
+    std::vector<std::shared_ptr<Worker2>> processors;  // Keep the workers alive while the threads use them
 };
 
 #endif // WORKERMANAGER2_H
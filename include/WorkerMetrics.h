@@ -0,0 +1,122 @@
+#ifndef WORKERMETRICS_H
+#define WORKERMETRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "json.hpp"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Scoped timers and counters for worker authors are compiled in unless the
+// build defines RTADP_WORKER_METRICS=0, which turns them into empty inline
+// code (the metric names are still registered, once per call site).
+#ifndef RTADP_WORKER_METRICS
+#define RTADP_WORKER_METRICS 1
+#endif
+
+// Timestamp counter: rdtsc on x86 (a few cycles, no system call), the
+// steady clock in nanoseconds elsewhere. Ticks are converted to nanoseconds
+// only when the metrics are published.
+namespace tsc {
+
+inline uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Nanoseconds per tick, calibrated against the steady clock since the first call
+double ns_per_tick();
+
+}  // namespace tsc
+
+// Per-worker registry of the sub-step timers and counters of processData
+// (decode, compute, build result, ...). A worker is run by one thread, so
+// its slots have a single writer and are updated with relaxed loads and
+// stores, without atomic read-modify-write; the monitoring thread reads them
+// to publish the totals of the manager. Metric ids are process-wide and
+// shared by the workers of all the managers.
+class WorkerMetrics {
+
+public:
+    static const int MAX_METRICS = 64;
+
+    // Returns the id of a timer or counter, registering its name the first time.
+    // Ids past MAX_METRICS are not recorded
+    static int register_metric(const std::string& name, bool timer);
+
+    // Records the duration of a timed scope
+    void add_time(int id, uint64_t ticks) {
+        if (id >= MAX_METRICS) {
+            return;
+        }
+        Slot& slot = slots[id];
+        slot.count.store(slot.count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        slot.total.store(slot.total.load(std::memory_order_relaxed) + ticks, std::memory_order_relaxed);
+        if (ticks > slot.max.load(std::memory_order_relaxed)) {
+            slot.max.store(ticks, std::memory_order_relaxed);
+        }
+    }
+
+    // Adds to a counter
+    void add_count(int id, uint64_t value) {
+        if (id >= MAX_METRICS) {
+            return;
+        }
+        Slot& slot = slots[id];
+        slot.total.store(slot.total.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    // Sums the metrics of the workers of a manager, for monitoring:
+    // timers as {"count", "total_ms", "mean_us", "max_us"}, counters as their value
+    static nlohmann::json get_stats(const std::vector<const WorkerMetrics*>& metrics);
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> total{0};  // Ticks for timers, value for counters
+        std::atomic<uint64_t> max{0};
+    };
+
+    Slot slots[MAX_METRICS];
+};
+
+// RAII timer of a scope, recording its duration in a WorkerMetrics on exit.
+// The disabled specialization is empty and compiles to nothing.
+template <bool Enabled>
+class BasicScopedTimer;
+
+template <>
+class BasicScopedTimer<true> {
+
+    WorkerMetrics* metrics;
+    int id;
+    uint64_t start;
+
+public:
+    BasicScopedTimer(WorkerMetrics* metrics, int id) : metrics(metrics), id(id), start(tsc::now()) {}
+    ~BasicScopedTimer() { metrics->add_time(id, tsc::now() - start); }
+
+    BasicScopedTimer(const BasicScopedTimer&) = delete;
+    BasicScopedTimer& operator=(const BasicScopedTimer&) = delete;
+};
+
+template <>
+class BasicScopedTimer<false> {
+
+public:
+    BasicScopedTimer(WorkerMetrics*, int) {}
+
+    BasicScopedTimer(const BasicScopedTimer&) = delete;
+    BasicScopedTimer& operator=(const BasicScopedTimer&) = delete;
+};
+
+using ScopedTimer = BasicScopedTimer<RTADP_WORKER_METRICS != 0>;
+
+#endif // WORKERMETRICS_H
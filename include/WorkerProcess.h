@@ -12,8 +12,10 @@
 // #include <psutil.h> // Assuming you have a similar library for process management
 #include "WorkerManager.h" // Include the Manager class
 #include "WorkerBase.h" // Include the Worker class
+#include "MessageQueue.h"
 #include "json.hpp"  // Include nlohmann::json for configuration
 #include "WorkerLogger.h"
+#include "TimerService.h"
 
 class WorkerProcess {
 public:
@@ -34,8 +36,8 @@ private:
     std::shared_ptr<Supervisor> supervisor;
     std::shared_ptr<WorkerBase> worker;
 
-    std::shared_ptr<std::queue<std::string>> low_priority_queue;
-    std::shared_ptr<std::queue<std::string>> high_priority_queue;
+    std::shared_ptr<MessageQueue> low_priority_queue;
+    std::shared_ptr<MessageQueue> high_priority_queue;
 
     std::string name;
     std::string workersname;
@@ -56,7 +58,7 @@ private:
     int total_processed_data_count;
     double processing_rate;
 
-    std::unique_ptr<std::thread> timer_thread;
+    TimerService::TimerId timer;  // Rate computation timer (0 = not started)
 };
 
 #endif // WORKERPROCESS_H
@@ -19,6 +19,13 @@
 #include "WorkerBase.h"
 #include "WorkerLogger.h"
 #include "MonitoringPoint.h"
+#include "ColumnarBatch.h"
+#include "MessageQueue.h"
+#include "BatchController.h"
+#include "SloMonitor.h"
+#include "HedgeController.h"
+#include "ResultCache.h"
+#include "TimerService.h"
 
 using json = nlohmann::json;
 
@@ -28,13 +35,15 @@ class WorkerThread {
     WorkerManager* manager;
     Supervisor* supervisor;
     WorkerBase* worker;
+    bool large;  // Thread of the large message sub-pool of the manager
+    bool shared;  // Run by the threads of the shared executor, not by its own thread
     std::string name;
     std::string workersname;
     std::string fullname;
     std::string globalname;
     WorkerLogger* logger;
-    std::shared_ptr<std::queue<std::string>> low_priority_queue;
-    std::shared_ptr<std::queue<std::string>> high_priority_queue;
+    std::shared_ptr<MessageQueue> low_priority_queue;
+    std::shared_ptr<MessageQueue> high_priority_queue;
     MonitoringPoint* monitoringpoint;
 
     std::chrono::time_point<std::chrono::high_resolution_clock> start_time;
@@ -47,18 +56,43 @@ class WorkerThread {
     std::atomic<int> status;
     int tokenresult;
     int tokenreading;
-    std::unique_ptr<std::thread> timer;
+    TimerService::TimerId timer;  // Rate computation timer (0 = not started)
     // std::thread worker_thread; 
 
     std::unique_ptr<std::thread> internal_thread;
 
+    BatchController* batch_controller;  // nullptr if the batch size is fixed
+    SloMonitor* slo_monitor;  // nullptr if no latency SLO is declared
+    HedgeController* hedge_controller;  // nullptr if HP stragglers are not hedged
+    ResultCache* result_cache;  // nullptr if results are not cached
+    std::atomic<int64_t> busy_ns;  // Total time spent processing
+    std::vector<PooledBuffer> pending;  // Messages dequeued for the next batch
+    std::vector<int64_t> pending_received;  // Reception times of the messages of the batch
+    ColumnarBatch batch;  // Reused across batches
+    json payload = json::string_t();  // JSON string handed to processData, its buffer reused across messages
+    std::vector<WorkerBase*> fused_stages;  // Workers of the pipeline stages fused after this one
+    WorkerManager* output_manager;  // Manager of the last fused stage, owning the results
+
     void start_timer(int interval);
-    void workerop(int interval);
-    void process_data(const std::string& data, int priority);
+    void workerop();
+    void process_data(const PooledBuffer& data, int priority);
+    const json& payload_of(const PooledBuffer& data);
+    json process_message(const PooledBuffer& data, int priority);
+    void process_hedged(const PooledBuffer& data);
+    bool run_hedge();
+    void pass_token_reading();
+    void dequeue_batch(std::shared_ptr<MessageQueue>& queue, int batch_size);
+    void process_batch(int priority);
+    void record_dwell(int64_t received_ns, int priority);
+    void record_batch_dwell(int priority);
+    void push_result(const json& dataresult, int priority);
+    void emit_result(const json& dataresult, int priority);
 
 
 public:
-    WorkerThread(int worker_id, WorkerManager* manager, const std::string& name, WorkerBase* worker);
+    WorkerThread(int worker_id, WorkerManager* manager, const std::string& name, WorkerBase* worker, bool large = false, bool shared = false);
+
+    WorkerBase* getWorker() const { return worker; }
     ~WorkerThread();
 
     void stop();
@@ -66,6 +100,11 @@ public:
     void set_processdata(int processdata1);
     void run();
 
+    // Process the next HP message (or batch), else the next LP one. Returns false if both queues are empty
+    bool step();
+
+    bool is_processing() const { return processdata == 1; }
+
     int get_tokenresult() const;
     void set_tokenresult(int value);
     int get_tokenreading() const;
@@ -79,6 +118,9 @@ public:
 
     int getTotalProcessedDataCount() const;
 
+    // Total time spent processing data, in nanoseconds
+    int64_t getBusyTime() const { return busy_ns.load(std::memory_order_relaxed); }
+
     bool joinable() const;
     void join();
 
@@ -0,0 +1,207 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <spdlog/spdlog.h>
+#include "AvroFileSink.h"
+#include "avro/Compiler.hh"
+#include "BatchController.h"
+
+using json = nlohmann::json;
+
+namespace {
+
+const char* RESULT_SCHEMA = R"({
+    "type": "record",
+    "name": "PipelineResult",
+    "namespace": "rtadp",
+    "fields": [
+        {"name": "timestamp", "type": "long"},
+        {"name": "priority", "type": "int"},
+        {"name": "payload", "type": "string"}
+    ]
+})";
+
+int64_t wall_time_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace
+
+AvroFileSink::AvroFileSink(const std::string& path, const std::string& prefix, const json& configuration)
+    : path(path), prefix(prefix), filling_bytes(0), stop_event(false), file_opened_ns(0), file_count(0),
+      written_count(0), dropped_count(0), files_count(0) {
+    block_size = static_cast<size_t>(configuration.value("block_size_kb", 64)) * 1024;
+    roll_size = static_cast<uint64_t>(configuration.value("roll_size_mb", 256.0) * 1024 * 1024);
+    roll_interval_ns = static_cast<int64_t>(configuration.value("roll_interval_s", 3600.0) * 1e9);
+    flush_ns = static_cast<int64_t>(configuration.value("flush_ms", 1000.0) * 1e6);
+    max_pending = configuration.value("max_pending", 100000);
+
+    std::string codec_name = configuration.value("codec", std::string("deflate"));
+    if (codec_name == "null") {
+        codec = avro::NULL_CODEC;
+    } else if (codec_name == "deflate") {
+        codec = avro::DEFLATE_CODEC;
+#ifdef SNAPPY_CODEC_AVAILABLE
+    } else if (codec_name == "snappy") {
+        codec = avro::SNAPPY_CODEC;
+#endif
+    } else {
+        throw std::invalid_argument("Config file: result_file codec must be null, deflate or snappy (if available)");
+    }
+
+    schema = avro::compileJsonSchemaFromString(RESULT_SCHEMA);
+    std::filesystem::create_directories(path);
+    thread = std::thread(&AvroFileSink::run, this);
+}
+
+AvroFileSink::~AvroFileSink() {
+    stop();
+}
+
+// Appends a result, never blocking on the disk. Returns false if it was dropped
+bool AvroFileSink::write(const std::string& payload, int priority) {
+    bool full;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (filling.size() >= max_pending) {
+            dropped_count++;
+            return false;
+        }
+        filling.push_back(Record{wall_time_us(), priority, payload});
+        filling_bytes += payload.size();
+        full = filling_bytes >= block_size;
+    }
+    if (full) {
+        cv.notify_one();
+    }
+    return true;
+}
+
+// Writes the pending results and closes the current file
+void AvroFileSink::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop_event = true;
+    }
+    cv.notify_one();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+// Opens a new file
+void AvroFileSink::open_file() {
+    char date[32];
+    time_t now = time(nullptr);
+    struct tm utc;
+    gmtime_r(&now, &utc);
+    strftime(date, sizeof(date), "%Y%m%d-%H%M%S", &utc);
+    filename = path + "/" + prefix + "-" + date + "-" + std::to_string(file_count++) + ".avro";
+    writer = std::make_unique<avro::DataFileWriter<avro::GenericDatum>>((filename + ".part").c_str(), schema, block_size, codec);
+    file_opened_ns = BatchController::now_ns();
+    files_count++;
+}
+
+// Closes the writer without throwing: closing again from a catch block or from the
+// destructor of the writer would terminate. Returns false if the file could not be completed
+bool AvroFileSink::close_writer() {
+    bool closed = true;
+    try {
+        writer->close();
+    } catch (const std::exception& e) {
+        spdlog::error("Unable to close result file {}: {}", filename, e.what());
+        closed = false;
+    }
+    writer.reset();
+    return closed;
+}
+
+// Closes the current file and makes it visible
+void AvroFileSink::close_file() {
+    if (!writer) {
+        return;
+    }
+    if (!close_writer()) {
+        return;  // Left as .part: incomplete
+    }
+    if (std::rename((filename + ".part").c_str(), filename.c_str()) != 0) {
+        spdlog::error("Unable to rename result file {}.part", filename);
+    }
+}
+
+// Encodes the records of a block and writes them to the current file, rolling it if needed
+void AvroFileSink::write_block(std::vector<Record>& block) {
+    try {
+        if (!writer) {
+            open_file();
+        }
+        avro::GenericDatum datum(schema);
+        avro::GenericRecord& record = datum.value<avro::GenericRecord>();
+        for (auto& item : block) {
+            record.fieldAt(0).value<int64_t>() = item.timestamp;
+            record.fieldAt(1).value<int32_t>() = item.priority;
+            record.fieldAt(2).value<std::string>().swap(item.payload);
+            writer->write(datum);
+        }
+        writer->flush();  // Compresses and writes the block
+        written_count += block.size();
+
+        std::error_code ec;
+        if (std::filesystem::file_size(filename + ".part", ec) >= roll_size) {
+            close_file();
+        }
+    } catch (const std::exception& e) {
+        spdlog::error("Unable to write result file {}: {}", filename, e.what());
+        dropped_count += block.size();
+        if (writer) {
+            close_writer();  // The next block opens a new file
+        }
+    }
+}
+
+void AvroFileSink::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        cv.wait_for(lock, std::chrono::nanoseconds(flush_ns), [this] { return stop_event || filling_bytes >= block_size; });
+        bool stopping = stop_event;
+        writing.swap(filling);  // The next block is filled while this one is written
+        filling_bytes = 0;
+        lock.unlock();
+
+        if (!writing.empty()) {
+            write_block(writing);
+            writing.clear();
+        }
+        if (writer && (stopping || BatchController::now_ns() - file_opened_ns >= roll_interval_ns)) {
+            close_file();
+        }
+
+        lock.lock();
+        if (stopping && filling.empty()) {
+            break;
+        }
+    }
+}
+
+// Sink statistics for monitoring
+json AvroFileSink::get_stats() {
+    json stats;
+    stats["type"] = "file";
+    stats["path"] = path;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats["pending"] = filling.size();
+    }
+    stats["written"] = written_count.load();
+    stats["dropped"] = dropped_count.load();
+    stats["files"] = files_count.load();
+    return stats;
+}
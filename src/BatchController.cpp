@@ -0,0 +1,108 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+#include <algorithm>
+#include <chrono>
+#include "BatchController.h"
+
+using json = nlohmann::json;
+
+// Constructor to initialize the controller from the "adaptive_batching" section
+BatchController::BatchController(const json& configuration, int initial_batch_size)
+    : last_update_ns(now_ns()), increases(0), decreases(0) {
+    min_batch_size = std::max(1, configuration.value("min_batch_size", 1));
+    max_batch_size = std::max(min_batch_size, configuration.value("max_batch_size", 1024));
+    interval_ns = static_cast<int64_t>(configuration.value("interval_ms", 100)) * 1000000;
+
+    // Latency target per priority class, either one value or {"lp": ..., "hp": ...}
+    double target_lp_ms = 100.0;
+    double target_hp_ms = 10.0;
+    if (configuration.contains("latency_target_ms")) {
+        const json& target = configuration["latency_target_ms"];
+        if (target.is_number()) {
+            target_lp_ms = target_hp_ms = target.get<double>();
+        } else {
+            target_lp_ms = target.value("lp", target_lp_ms);
+            target_hp_ms = target.value("hp", target_hp_ms);
+        }
+    }
+    classes[0].latency_target_ns = static_cast<int64_t>(target_lp_ms * 1e6);
+    classes[1].latency_target_ns = static_cast<int64_t>(target_hp_ms * 1e6);
+
+    int initial = std::clamp(initial_batch_size, min_batch_size, max_batch_size);
+    classes[0].batch_size = initial;
+    classes[1].batch_size = initial;
+}
+
+int64_t BatchController::now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Reports the dwell time of a processed batch and the messages still queued
+void BatchController::record(int priority, int64_t dwell_ns, size_t backlog) {
+    PriorityClass& pc = classes[priority ? 1 : 0];
+    int64_t max_dwell = pc.window_max_dwell_ns.load(std::memory_order_relaxed);
+    while (dwell_ns > max_dwell && !pc.window_max_dwell_ns.compare_exchange_weak(max_dwell, dwell_ns, std::memory_order_relaxed)) {
+    }
+    uint64_t max_backlog = pc.window_max_backlog.load(std::memory_order_relaxed);
+    while (backlog > max_backlog && !pc.window_max_backlog.compare_exchange_weak(max_backlog, backlog, std::memory_order_relaxed)) {
+    }
+    pc.window_samples.fetch_add(1, std::memory_order_relaxed);
+
+    int64_t now = now_ns();
+    if (now - last_update_ns.load(std::memory_order_relaxed) >= interval_ns) {
+        std::unique_lock<std::mutex> lock(update_mutex, std::try_to_lock);
+        if (lock.owns_lock() && now - last_update_ns.load(std::memory_order_relaxed) >= interval_ns) {
+            update(now);
+        }
+    }
+}
+
+// Applies the control law at the end of an interval
+void BatchController::update(int64_t now) {
+    for (PriorityClass& pc : classes) {
+        uint64_t samples = pc.window_samples.exchange(0, std::memory_order_relaxed);
+        int64_t max_dwell = pc.window_max_dwell_ns.exchange(0, std::memory_order_relaxed);
+        uint64_t max_backlog = pc.window_max_backlog.exchange(0, std::memory_order_relaxed);
+        if (samples == 0) {
+            continue;  // No traffic: keep the size
+        }
+        pc.last_max_dwell_ns = max_dwell;
+
+        int size = pc.batch_size.load(std::memory_order_relaxed);
+        if (max_dwell > pc.latency_target_ns) {
+            // Over budget: multiplicative decrease
+            int smaller = std::max(min_batch_size, size / 2);
+            if (smaller != size) {
+                pc.batch_size = smaller;
+                decreases++;
+            }
+        } else if (max_dwell < pc.latency_target_ns * 7 / 10 && max_backlog >= static_cast<uint64_t>(size)) {
+            // Within budget and messages waiting: grow to amortize the per-batch costs
+            int larger = std::min(max_batch_size, size + std::max(1, size / 4));
+            if (larger != size) {
+                pc.batch_size = larger;
+                increases++;
+            }
+        }
+    }
+    last_update_ns = now;
+}
+
+// Controller state for monitoring
+json BatchController::get_stats() const {
+    json stats;
+    const char* names[2] = {"lp", "hp"};
+    for (int i = 0; i < 2; ++i) {
+        stats[names[i]]["batch_size"] = classes[i].batch_size.load();
+        stats[names[i]]["latency_target_ms"] = classes[i].latency_target_ns / 1e6;
+        stats[names[i]]["max_dwell_ms"] = classes[i].last_max_dwell_ns.load() / 1e6;
+    }
+    stats["increases"] = increases.load();
+    stats["decreases"] = decreases.load();
+    return stats;
+}
@@ -0,0 +1,259 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <vector>
+#include "BufferPool.h"
+#include "HugePages.h"
+
+using json = nlohmann::json;
+
+// Free lists of one thread
+struct BufferCache {
+    BufferSlab* local[BufferPool::NUM_CLASSES];  // Used by the owner thread only
+    std::atomic<BufferSlab*> remote[BufferPool::NUM_CLASSES];  // Released by other threads
+    std::atomic<bool> owned;
+    char* arena;  // Huge page region the slabs are carved from (huge pages enabled only)
+    size_t arena_left;
+
+    BufferCache() : owned(true), arena(nullptr), arena_left(0) {
+        for (int i = 0; i < BufferPool::NUM_CLASSES; ++i) {
+            local[i] = nullptr;
+            remote[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+};
+
+namespace {
+
+const size_t SLAB_BYTES = 256 * 1024;  // Memory allocated at once when a free list is empty
+
+// All the caches ever created. Caches of terminated threads are adopted by new
+// threads, because buffers still in flight return to them
+struct CacheRegistry {
+    std::mutex mutex;
+    std::vector<BufferCache*> caches;
+    std::atomic<uint64_t> reserved_buffers[BufferPool::NUM_CLASSES];
+    std::atomic<uint64_t> reserved_bytes{0};
+    std::atomic<uint64_t> oversized_count{0};
+
+    CacheRegistry() {
+        for (auto& count : reserved_buffers) {
+            count.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    BufferCache* acquire() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (BufferCache* cache : caches) {
+            bool expected = false;
+            if (cache->owned.compare_exchange_strong(expected, true)) {
+                return cache;
+            }
+        }
+        caches.push_back(new BufferCache());
+        return caches.back();
+    }
+};
+
+// Never destroyed: buffers may be released during static destruction
+CacheRegistry& registry() {
+    static CacheRegistry* instance = new CacheRegistry();
+    return *instance;
+}
+
+// Cache of the calling thread, given back to the registry when the thread exits
+struct ThreadCache {
+    BufferCache* cache = nullptr;
+
+    BufferCache* get() {
+        if (!cache) {
+            cache = registry().acquire();
+        }
+        return cache;
+    }
+
+    ~ThreadCache() {
+        if (cache) {
+            cache->owned.store(false, std::memory_order_release);
+        }
+    }
+};
+
+thread_local ThreadCache thread_cache;
+
+int size_class_of(size_t size) {
+    for (int c = 0; c < BufferPool::NUM_CLASSES; ++c) {
+        if (size <= BufferPool::class_capacity(c)) {
+            return c;
+        }
+    }
+    return -1;
+}
+
+// Returns the memory of a slab, carved from the huge page arena of the cache
+// when huge pages are enabled. Pooled memory is never released
+char* allocate_slab(BufferCache* cache, size_t bytes) {
+    if (HugePages::is_enabled()) {
+        if (cache->arena_left < bytes) {
+            size_t allocated;
+            char* arena = static_cast<char*>(HugePages::allocate(std::max(bytes, HugePages::HUGE_PAGE_SIZE), "buffer_pool", allocated));
+            if (arena) {
+                // The rest of the previous arena is left unused
+                cache->arena = arena;
+                cache->arena_left = allocated;
+            }
+        }
+        if (cache->arena_left >= bytes) {
+            char* memory = cache->arena;
+            cache->arena += bytes;
+            cache->arena_left -= bytes;
+            return memory;
+        }
+    }
+    return static_cast<char*>(::operator new(bytes, std::align_val_t(alignof(BufferSlab))));
+}
+
+// Allocates a slab of buffers of one class and links them in a free list
+BufferSlab* refill(BufferCache* cache, int size_class) {
+    size_t capacity = BufferPool::class_capacity(size_class);
+    size_t stride = sizeof(BufferSlab) + capacity;
+    size_t count = SLAB_BYTES / stride > 0 ? SLAB_BYTES / stride : 1;
+    char* memory = allocate_slab(cache, stride * count);
+
+    BufferSlab* head = nullptr;
+    for (size_t i = count; i-- > 0;) {
+        BufferSlab* slab = new (memory + i * stride) BufferSlab();
+        slab->origin = cache;
+        slab->size_class = size_class;
+        slab->capacity = capacity;
+        slab->next = head;
+        head = slab;
+    }
+    CacheRegistry& reg = registry();
+    reg.reserved_buffers[size_class].fetch_add(count, std::memory_order_relaxed);
+    reg.reserved_bytes.fetch_add(stride * count, std::memory_order_relaxed);
+    return head;
+}
+
+}
+
+// Returns a buffer of at least the given size, with size() set to it
+PooledBuffer BufferPool::allocate(size_t size) {
+    BufferSlab* slab;
+    int size_class = size_class_of(size);
+    if (size_class < 0) {
+        void* memory = ::operator new(sizeof(BufferSlab) + size, std::align_val_t(alignof(BufferSlab)));
+        slab = new (memory) BufferSlab();
+        slab->origin = nullptr;
+        slab->size_class = NUM_CLASSES;
+        slab->capacity = size;
+        registry().oversized_count.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        BufferCache* cache = thread_cache.get();
+        slab = cache->local[size_class];
+        if (!slab) {
+            slab = cache->remote[size_class].exchange(nullptr, std::memory_order_acquire);
+            if (!slab) {
+                slab = refill(cache, size_class);
+            }
+        }
+        cache->local[size_class] = slab->next;
+    }
+    slab->next = nullptr;
+    slab->refs.store(1, std::memory_order_relaxed);
+    slab->size = size;
+    slab->timestamp_ns = 0;
+    slab->deadline_ns = 0;
+    slab->tracker = nullptr;
+    return PooledBuffer(slab);
+}
+
+// Returns a buffer holding a copy of the given bytes
+PooledBuffer BufferPool::copy(const void* data, size_t size) {
+    PooledBuffer buffer = allocate(size);
+    if (size > 0) {
+        memcpy(buffer.data(), data, size);
+    }
+    return buffer;
+}
+
+// Fills the cache of the calling thread with count buffers of the given
+// size, touching their memory, so the first messages do not page fault
+void BufferPool::reserve(size_t size, size_t count) {
+    if (size_class_of(size) < 0) {
+        return;
+    }
+    std::vector<PooledBuffer> buffers;
+    buffers.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        PooledBuffer buffer = allocate(size);
+        memset(buffer.data(), 0, buffer.capacity());
+        buffers.push_back(std::move(buffer));
+    }
+    // Released to the local free list of this thread
+}
+
+// Returns a buffer to its origin cache
+void BufferPool::release(BufferSlab* slab) {
+    BufferCache* origin = slab->origin;
+    if (!origin) {
+        slab->~BufferSlab();
+        ::operator delete(static_cast<void*>(slab), std::align_val_t(alignof(BufferSlab)));
+        return;
+    }
+    if (origin == thread_cache.cache) {
+        slab->next = origin->local[slab->size_class];
+        origin->local[slab->size_class] = slab;
+        return;
+    }
+    // Released by another thread: lock-free push on the remote list of the origin.
+    // The owner only takes the whole list, so there is no ABA problem
+    std::atomic<BufferSlab*>& remote = origin->remote[slab->size_class];
+    BufferSlab* head = remote.load(std::memory_order_relaxed);
+    do {
+        slab->next = head;
+    } while (!remote.compare_exchange_weak(head, slab, std::memory_order_release, std::memory_order_relaxed));
+}
+
+// Pool statistics for monitoring
+json BufferPool::get_stats() {
+    CacheRegistry& reg = registry();
+    json stats;
+    json classes = json::array();
+    for (int c = 0; c < NUM_CLASSES; ++c) {
+        json entry;
+        entry["capacity"] = class_capacity(c);
+        entry["buffers"] = reg.reserved_buffers[c].load(std::memory_order_relaxed);
+        classes.push_back(entry);
+    }
+    stats["classes"] = classes;
+    stats["reserved_bytes"] = reg.reserved_bytes.load(std::memory_order_relaxed);
+    stats["oversized_allocations"] = reg.oversized_count.load(std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        stats["thread_caches"] = reg.caches.size();
+    }
+    return stats;
+}
+
+void PooledBuffer::reset() {
+    if (slab) {
+        if (slab->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            DeliveryTracker* tracker = slab->tracker;
+            uint64_t token = slab->token;
+            BufferPool::release(slab);
+            if (tracker) {
+                tracker->complete(token);
+            }
+        }
+        slab = nullptr;
+    }
+}
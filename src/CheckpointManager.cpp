@@ -0,0 +1,183 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+#include "CheckpointManager.h"
+#include "WorkerBase.h"
+
+// Constructor to initialize the CheckpointManager from the "checkpoint" configuration section
+CheckpointManager::CheckpointManager(const nlohmann::json& configuration, const std::string& prefix, WorkerLogger* logger, const std::string& globalname)
+    : prefix(prefix), logger(logger), globalname(globalname), stop_event(false), checkpoints_written(0), warned_stateless(false) {
+    path = configuration.value("path", std::string("/tmp/"));
+    interval = configuration.value("interval", 10);
+    if (interval < 1) {
+        interval = 1;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(path, ec);
+    if (ec) {
+        logger->error("Unable to create checkpoint directory " + path + ": " + ec.message(), globalname);
+    }
+    logger->system("Checkpoint every " + std::to_string(interval) + " s in " + path, globalname);
+}
+
+// Destructor to stop the thread and write the last checkpoint
+CheckpointManager::~CheckpointManager() {
+    stop();
+}
+
+std::string CheckpointManager::get_filename() const {
+    return path + "/" + prefix + ".ckpt";
+}
+
+// Registers a worker. The first one restores the last checkpoint, if any
+void CheckpointManager::add_worker(WorkerBase* worker) {
+    std::lock_guard<std::mutex> lock(workers_mutex);
+    if (workers.empty()) {
+        restore(worker);
+    }
+    workers.push_back(worker);
+    written_versions.push_back(worker->get_state_version());
+}
+
+// Restores the last checkpoint into a worker. Returns true if a checkpoint was found
+bool CheckpointManager::restore(WorkerBase* worker) {
+    std::string filename = get_filename();
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    try {
+        std::vector<uint8_t> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        nlohmann::json snapshot = nlohmann::json::from_msgpack(buffer);
+        worker->restore(snapshot["state"]);
+        logger->system("Restored checkpoint " + filename + " of " + std::to_string(snapshot["time"].get<double>())
+                       + " (" + std::to_string(snapshot["state"].size()) + " keys)", globalname);
+        return true;
+    } catch (const std::exception& e) {
+        logger->error("Unable to restore checkpoint " + filename + ": " + std::string(e.what()), globalname);
+    }
+    return false;
+}
+
+// Merges the snapshots of the workers and writes them if a state changed
+bool CheckpointManager::write_states() {
+    std::vector<uint64_t> versions;
+    bool changed = false;
+    for (size_t i = 0; i < workers.size(); i++) {
+        versions.push_back(workers[i]->get_state_version());
+        changed = changed || versions[i] != written_versions[i];
+    }
+    if (!changed) {
+        return false;
+    }
+
+    // Only the pointers are taken: the workers keep processing on new copies
+    nlohmann::json states = nlohmann::json::object();
+    for (WorkerBase* worker : workers) {
+        std::shared_ptr<const nlohmann::json> state = worker->serialize();
+        if (!state) {
+            continue;
+        }
+        if (!state->is_object()) {
+            throw std::runtime_error("worker state is not an object keyed by state key");
+        }
+        for (auto& [key, value] : state->items()) {
+            auto found = states.find(key);
+            if (found == states.end()) {
+                states[key] = value;
+            } else {
+                worker->merge_state(*found, value);
+            }
+        }
+    }
+
+    nlohmann::json snapshot;
+    snapshot["time"] = static_cast<double>(time(nullptr));
+    snapshot["state"] = std::move(states);
+    std::vector<uint8_t> buffer = nlohmann::json::to_msgpack(snapshot);
+
+    // Write to a temporary file and rename it, so a crash never leaves a truncated checkpoint
+    std::string filename = get_filename();
+    std::string tmpname = filename + ".tmp";
+    {
+        std::ofstream file(tmpname, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            logger->error("Unable to write checkpoint " + tmpname, globalname);
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+        if (!file) {
+            logger->error("Unable to write checkpoint " + tmpname, globalname);
+            return false;
+        }
+    }
+    if (std::rename(tmpname.c_str(), filename.c_str()) != 0) {
+        logger->error("Unable to rename checkpoint " + tmpname, globalname);
+        return false;
+    }
+
+    written_versions = versions;
+    checkpoints_written++;
+    return true;
+}
+
+// Writes the merged snapshots if a worker state changed
+void CheckpointManager::checkpoint() {
+    std::lock_guard<std::mutex> lock(workers_mutex);
+    try {
+        if (write_states()) {
+            logger->debug("Checkpoint written for " + std::to_string(workers.size()) + " workers", globalname);
+        }
+    } catch (const std::exception& e) {
+        logger->error("Checkpoint of " + prefix + " failed: " + std::string(e.what()), globalname);
+    }
+    if (!warned_stateless && !workers.empty()) {
+        warned_stateless = true;
+        bool stateful = false;
+        for (WorkerBase* worker : workers) {
+            stateful = stateful || worker->serialize() != nullptr;
+        }
+        if (!stateful) {
+            logger->warning("WARNING! Checkpointing enabled but no worker of " + prefix
+                            + " has published its state yet: stateful workers must implement WorkerBase::publish_state/restore", globalname);
+        }
+    }
+}
+
+void CheckpointManager::start() {
+    stop_event = false;
+    thread = std::thread(&CheckpointManager::run, this);
+}
+
+void CheckpointManager::stop() {
+    {
+        std::lock_guard<std::mutex> lock(wait_mutex);
+        stop_event = true;
+    }
+    wait_cv.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void CheckpointManager::run() {
+    while (!stop_event) {
+        std::unique_lock<std::mutex> lock(wait_mutex);
+        wait_cv.wait_for(lock, std::chrono::seconds(interval), [this] { return stop_event.load(); });
+        lock.unlock();
+        checkpoint();
+    }
+}
@@ -0,0 +1,336 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+#include "ColumnarBatch.h"
+
+using json = nlohmann::json;
+
+ColumnarBatch::ColumnarBatch() : interner(StringInterner::instance()) {
+}
+
+void ColumnarBatch::set_bit(std::vector<uint64_t>& bitmap, size_t row, bool value) {
+    if ((row >> 6) >= bitmap.size()) {
+        bitmap.push_back(0);
+    }
+    bitmap[row >> 6] |= static_cast<uint64_t>(value) << (row & 63);
+}
+
+// Reserves memory for the given number of rows
+void ColumnarBatch::reserve(size_t rows) {
+    timestamps.reserve(rows);
+    source_timestamps.reserve(rows);
+    name_ids.reserve(rows);
+    assembly_ids.reserve(rows);
+    serial_number_ids.reserve(rows);
+    units_ids.reserve(rows);
+    env_ids.reserve(rows);
+    flags.reserve(rows);
+    values.reserve(rows);
+    value_validity.reserve((rows + 63) / 64);
+    source_timestamp_validity.reserve((rows + 63) / 64);
+}
+
+// Removes all the rows, keeping the allocated memory
+void ColumnarBatch::clear() {
+    timestamps.clear();
+    source_timestamps.clear();
+    name_ids.clear();
+    assembly_ids.clear();
+    serial_number_ids.clear();
+    units_ids.clear();
+    env_ids.clear();
+    flags.clear();
+    values.clear();
+    value_validity.clear();
+    source_timestamp_validity.clear();
+}
+
+// Appends one record
+void ColumnarBatch::append(const ColumnarRow& row) {
+    size_t index = timestamps.size();
+    timestamps.push_back(row.timestamp);
+    source_timestamps.push_back(row.has_source_timestamp ? row.source_timestamp : 0);
+    name_ids.push_back(interner.intern(row.name));
+    assembly_ids.push_back(interner.intern(row.assembly));
+    serial_number_ids.push_back(interner.intern(row.serial_number));
+    units_ids.push_back(interner.intern(row.units));
+    env_ids.push_back(interner.intern(row.env_id));
+    flags.push_back(static_cast<uint8_t>(row.archive_suppress | (row.eng_gui << 1) | (row.op_gui << 2)));
+    // Invalid values are stored as 0 so that sums can ignore the bitmap
+    values.push_back(row.has_value ? row.value : 0.0);
+    set_bit(value_validity, index, row.has_value);
+    set_bit(source_timestamp_validity, index, row.has_source_timestamp);
+}
+
+// Appends one record in the JSON representation of AvroMonitoringPoint
+void ColumnarBatch::append_json(const json& record) {
+    // Views on the strings of the record, valid until append returns
+    auto string_field = [&record](const char* key) {
+        auto it = record.find(key);
+        return (it != record.end() && it->is_string()) ? std::string_view(it->get_ref<const std::string&>()) : std::string_view();
+    };
+
+    ColumnarRow row;
+    row.timestamp = record.value("timestamp", static_cast<int64_t>(0));
+    if (record.contains("source_timestamp") && record["source_timestamp"].is_number()) {
+        row.has_source_timestamp = true;
+        row.source_timestamp = record["source_timestamp"].get<int64_t>();
+    }
+    row.assembly = string_field("assembly");
+    row.name = string_field("name");
+    row.serial_number = string_field("serial_number");
+    row.units = string_field("units");
+    row.env_id = string_field("env_id");
+    row.archive_suppress = record.value("archive_suppress", false);
+    row.eng_gui = record.value("eng_gui", false);
+    row.op_gui = record.value("op_gui", false);
+    if (record.contains("data") && record["data"].is_array() && !record["data"].empty() && record["data"][0].is_number()) {
+        row.has_value = true;
+        row.value = record["data"][0].get<double>();
+    }
+    append(row);
+}
+
+// Same, reading only the fields of AvroMonitoringPoint from an on-demand view
+void ColumnarBatch::append_json(const JsonValue& record) {
+    // Escaped strings are unescaped here, so the views stay valid until append returns
+    std::string scratch[5];
+    auto string_field = [&record](const char* key, std::string& buffer) {
+        std::string_view value;
+        return record[key].get_string(value, buffer) ? value : std::string_view();
+    };
+    auto bool_field = [&record](const char* key) {
+        bool value = false;
+        record[key].get_bool(value);
+        return value;
+    };
+
+    ColumnarRow row;
+    record["timestamp"].get_int64(row.timestamp);
+    row.has_source_timestamp = record["source_timestamp"].get_int64(row.source_timestamp);
+    row.assembly = string_field("assembly", scratch[0]);
+    row.name = string_field("name", scratch[1]);
+    row.serial_number = string_field("serial_number", scratch[2]);
+    row.units = string_field("units", scratch[3]);
+    row.env_id = string_field("env_id", scratch[4]);
+    row.archive_suppress = bool_field("archive_suppress");
+    row.eng_gui = bool_field("eng_gui");
+    row.op_gui = bool_field("op_gui");
+    row.has_value = record["data"].at(0).get_double(row.value);
+    if (!row.has_value) {
+        row.value = 0.0;
+    }
+    append(row);
+}
+
+namespace {
+
+// Reader of the Avro binary encoding
+struct AvroReader {
+    const uint8_t* pos;
+    const uint8_t* end;
+    bool ok = true;
+
+    int64_t read_long() {
+        uint64_t value = 0;
+        int shift = 0;
+        while (pos < end && shift < 64) {
+            uint8_t byte = *pos++;
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+            }
+            shift += 7;
+        }
+        ok = false;
+        return 0;
+    }
+
+    std::string_view read_string() {
+        int64_t size = read_long();
+        if (!ok || size < 0 || size > end - pos) {
+            ok = false;
+            return std::string_view();
+        }
+        std::string_view str(reinterpret_cast<const char*>(pos), static_cast<size_t>(size));
+        pos += size;
+        return str;
+    }
+
+    bool read_bool() {
+        if (pos >= end) {
+            ok = false;
+            return false;
+        }
+        return *pos++ != 0;
+    }
+
+    double read_double() {
+        double value = 0.0;
+        if (end - pos < 8) {
+            ok = false;
+            return value;
+        }
+        memcpy(&value, pos, sizeof(value));  // little endian on the supported platforms
+        pos += 8;
+        return value;
+    }
+};
+
+}
+
+// Decodes the AvroMonitoringPoint fields in schema order:
+// assembly, name, serial_number, timestamp, source_timestamp (null|long), units,
+// archive_suppress, env_id, eng_gui, op_gui, data (array of double|int|long|string|boolean)
+bool ColumnarBatch::append_avro(const char* data, size_t size) {
+    AvroReader reader{reinterpret_cast<const uint8_t*>(data), reinterpret_cast<const uint8_t*>(data) + size};
+    ColumnarRow row;
+    row.assembly = reader.read_string();
+    row.name = reader.read_string();
+    row.serial_number = reader.read_string();
+    row.timestamp = reader.read_long();
+    if (reader.read_long() == 1) {
+        row.has_source_timestamp = true;
+        row.source_timestamp = reader.read_long();
+    }
+    row.units = reader.read_string();
+    row.archive_suppress = reader.read_bool();
+    row.env_id = reader.read_string();
+    row.eng_gui = reader.read_bool();
+    row.op_gui = reader.read_bool();
+
+    for (int64_t count = reader.read_long(); reader.ok && count != 0; count = reader.read_long()) {
+        if (count < 0) {
+            count = -count;
+            reader.read_long();  // block size in bytes
+        }
+        for (int64_t i = 0; i < count && reader.ok; ++i) {
+            int64_t branch = reader.read_long();
+            double value = 0.0;
+            bool numeric = true;
+            switch (branch) {
+                case 0: value = reader.read_double(); break;
+                case 1:
+                case 2: value = static_cast<double>(reader.read_long()); break;
+                case 3: reader.read_string(); numeric = false; break;
+                case 4: reader.read_bool(); numeric = false; break;
+                default: reader.ok = false; break;
+            }
+            if (i == 0 && numeric && !row.has_value && reader.ok) {
+                row.has_value = true;
+                row.value = value;
+            }
+        }
+    }
+    if (!reader.ok) {
+        return false;
+    }
+    append(row);
+    return true;
+}
+
+// Rebuilds the record of a row (egress)
+json ColumnarBatch::to_json(size_t row) const {
+    json record;
+    record["assembly"] = interner.get_string(assembly_ids[row]);
+    record["name"] = interner.get_string(name_ids[row]);
+    record["serial_number"] = interner.get_string(serial_number_ids[row]);
+    record["timestamp"] = timestamps[row];
+    record["source_timestamp"] = has_source_timestamp(row) ? json(source_timestamps[row]) : json(nullptr);
+    record["units"] = interner.get_string(units_ids[row]);
+    record["archive_suppress"] = static_cast<bool>(flags[row] & 1);
+    record["env_id"] = interner.get_string(env_ids[row]);
+    record["eng_gui"] = static_cast<bool>(flags[row] & 2);
+    record["op_gui"] = static_cast<bool>(flags[row] & 4);
+    record["data"] = is_valid(row) ? json::array({values[row]}) : json::array();
+    return record;
+}
+
+// Rebuilds all the records as a JSON array (egress)
+json ColumnarBatch::to_json() const {
+    json records = json::array();
+    for (size_t row = 0; row < size(); ++row) {
+        records.push_back(to_json(row));
+    }
+    return records;
+}
+
+namespace ColumnarOps {
+
+size_t count_valid(const ColumnarBatch& batch) {
+    size_t count = 0;
+    for (uint64_t word : batch.get_value_validity()) {
+        count += __builtin_popcountll(word);
+    }
+    return count;
+}
+
+// Invalid rows hold 0, so the sum is a plain reduction over the column
+double sum(const ColumnarBatch& batch) {
+    const double* values = batch.get_values().data();
+    size_t size = batch.size();
+    double total = 0.0;
+    for (size_t i = 0; i < size; ++i) {
+        total += values[i];
+    }
+    return total;
+}
+
+double mean(const ColumnarBatch& batch) {
+    size_t count = count_valid(batch);
+    return count > 0 ? sum(batch) / count : 0.0;
+}
+
+bool min_max(const ColumnarBatch& batch, double& min, double& max) {
+    const double* values = batch.get_values().data();
+    const uint64_t* validity = batch.get_value_validity().data();
+    size_t size = batch.size();
+    const double inf = std::numeric_limits<double>::infinity();
+    double lo = inf;
+    double hi = -inf;
+    for (size_t base = 0; base < size; base += 64) {
+        uint64_t word = validity[base >> 6];
+        size_t n = size - base < 64 ? size - base : 64;
+        for (size_t j = 0; j < n; ++j) {
+            bool valid = (word >> j) & 1;
+            double v = values[base + j];
+            lo = valid && v < lo ? v : lo;
+            hi = valid && v > hi ? v : hi;
+        }
+    }
+    min = lo;
+    max = hi;
+    return lo <= hi;
+}
+
+void group_by_name(const ColumnarBatch& batch, std::vector<uint32_t>& names, std::vector<double>& sums, std::vector<uint32_t>& counts) {
+    // Name ids are compacted to batch-local groups: the cost follows the batch, not the interner
+    thread_local std::unordered_map<uint32_t, uint32_t> group_of;
+    group_of.clear();
+    names.clear();
+    sums.clear();
+    counts.clear();
+    const double* values = batch.get_values().data();
+    const uint32_t* name_ids = batch.get_name_ids().data();
+    const uint64_t* validity = batch.get_value_validity().data();
+    size_t size = batch.size();
+    for (size_t i = 0; i < size; ++i) {
+        auto [it, added] = group_of.try_emplace(name_ids[i], static_cast<uint32_t>(names.size()));
+        if (added) {
+            names.push_back(name_ids[i]);
+            sums.push_back(0.0);
+            counts.push_back(0);
+        }
+        sums[it->second] += values[i];
+        counts[it->second] += (validity[i >> 6] >> (i & 63)) & 1;
+    }
+}
+
+}
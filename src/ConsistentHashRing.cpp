@@ -0,0 +1,82 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+#include <algorithm>
+#include <set>
+#include "ConsistentHashRing.h"
+
+// Constructor to initialize the ring with shards 0..num_shards-1
+ConsistentHashRing::ConsistentHashRing(int num_shards, int virtual_nodes)
+    : virtual_nodes(virtual_nodes > 0 ? virtual_nodes : 1) {
+    for (int i = 0; i < num_shards; ++i) {
+        add_shard(i);
+    }
+}
+
+// Adds a shard to the ring
+void ConsistentHashRing::add_shard(int shard_id) {
+    remove_shard(shard_id);
+    for (int v = 0; v < virtual_nodes; ++v) {
+        std::string point = "shard-" + std::to_string(shard_id) + "#" + std::to_string(v);
+        ring.emplace_back(hash(point.data(), point.size()), shard_id);
+    }
+    sort_ring();
+}
+
+// Removes a shard from the ring
+void ConsistentHashRing::remove_shard(int shard_id) {
+    ring.erase(std::remove_if(ring.begin(), ring.end(),
+                              [shard_id](const std::pair<uint64_t, int>& p) { return p.second == shard_id; }),
+               ring.end());
+}
+
+void ConsistentHashRing::sort_ring() {
+    std::sort(ring.begin(), ring.end());
+}
+
+int ConsistentHashRing::get_shard(const char* key, size_t size) const {
+    return get_shard_for_hash(hash(key, size));
+}
+
+int ConsistentHashRing::get_shard(const std::string& key) const {
+    return get_shard_for_hash(hash(key.data(), key.size()));
+}
+
+// The owner is the first ring point clockwise from the key hash
+int ConsistentHashRing::get_shard_for_hash(uint64_t h) const {
+    if (ring.empty()) {
+        return -1;
+    }
+    auto it = std::lower_bound(ring.begin(), ring.end(), std::make_pair(h, -1));
+    if (it == ring.end()) {
+        it = ring.begin();
+    }
+    return it->second;
+}
+
+int ConsistentHashRing::get_num_shards() const {
+    std::set<int> shards;
+    for (const auto& p : ring) {
+        shards.insert(p.second);
+    }
+    return static_cast<int>(shards.size());
+}
+
+// FNV-1a followed by a 64-bit finalizer to spread nearby keys over the ring
+uint64_t ConsistentHashRing::hash(const char* data, size_t size) {
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i) {
+        h ^= static_cast<unsigned char>(data[i]);
+        h *= 1099511628211ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb3f99e3b10e5ULL;
+    h ^= h >> 33;
+    return h;
+}
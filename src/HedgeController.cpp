@@ -0,0 +1,151 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+#include <algorithm>
+#include "HedgeController.h"
+#include "BatchController.h"
+
+using json = nlohmann::json;
+
+// Constructor to initialize the controller from the "hedging" section, for num_slots worker threads
+HedgeController::HedgeController(const json& configuration, int num_slots)
+    : slots(num_slots), used_slots(0), threshold_ns(0), executions(0), hedges(0), hedge_wins(0), discarded(0) {
+    percentile = configuration.value("percentile", 95.0);
+    min_samples = std::max<uint64_t>(1, configuration.value("min_samples", static_cast<uint64_t>(100)));
+    update_every = std::max<uint64_t>(min_samples, configuration.value("update_every", static_cast<uint64_t>(256)));
+    max_hedge_rate = configuration.value("max_hedge_rate", 0.05);
+    last_counts.assign(LatencyHistogram::NUM_BUCKETS, 0);
+}
+
+// Publishes the HP message processed by a worker thread
+std::shared_ptr<HedgeController::Execution> HedgeController::begin(int slot, const PooledBuffer& message) {
+    Slot& s = slots[slot];
+    std::shared_ptr<Execution> execution;
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        for (const auto& record : s.records) {
+            if (record.use_count() == 1) {
+                execution = record;  // Not published nor hedged any more
+                break;
+            }
+        }
+        if (!execution) {
+            s.records.push_back(std::make_shared<Execution>());  // Only while a hedge outlives its primary
+            execution = s.records.back();
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);  // After the release of the last hedge
+        execution->message = message;
+        execution->start_ns = BatchController::now_ns();
+        execution->hedged.store(false, std::memory_order_relaxed);
+        execution->completed.store(false, std::memory_order_relaxed);
+        s.execution = execution;
+    }
+    s.start_ns.store(execution->start_ns, std::memory_order_release);
+    int used = used_slots.load(std::memory_order_relaxed);
+    while (slot >= used && !used_slots.compare_exchange_weak(used, slot + 1)) {
+    }
+    return execution;
+}
+
+// Completes an execution. Returns true if its result must be emitted (first to complete).
+// The primary execution clears its slot and records its processing time
+bool HedgeController::complete(int slot, Execution& execution, bool hedge) {
+    bool first = !execution.completed.exchange(true, std::memory_order_acq_rel);
+    if (!hedge) {
+        Slot& s = slots[slot];
+        s.start_ns.store(0, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            s.execution.reset();
+        }
+        durations.record(BatchController::now_ns() - execution.start_ns);
+        if (executions.fetch_add(1, std::memory_order_relaxed) % update_every == update_every - 1) {
+            update_threshold();
+        }
+    }
+    if (first && hedge) {
+        hedge_wins++;
+    }
+    if (!first) {
+        discarded++;
+    }
+    return first;
+}
+
+// Drops the message of a finished execution: the hedge drops it, or the primary if no hedge took it
+void HedgeController::release(Execution& execution, bool hedge) {
+    if (hedge || !execution.hedged.exchange(true, std::memory_order_acq_rel)) {
+        execution.message.reset();
+    }
+}
+
+// Returns a straggler to hedge for an idle worker thread (nullptr if none)
+std::shared_ptr<HedgeController::Execution> HedgeController::take_straggler(int self_slot) {
+    int64_t threshold = threshold_ns.load(std::memory_order_relaxed);
+    if (threshold == 0) {
+        return nullptr;
+    }
+    int64_t now = 0;
+    int used = used_slots.load(std::memory_order_acquire);
+    for (int i = 0; i < used; i++) {
+        int64_t start = slots[i].start_ns.load(std::memory_order_acquire);
+        if (i == self_slot || start == 0) {
+            continue;
+        }
+        if (now == 0) {
+            now = BatchController::now_ns();
+        }
+        if (now - start < threshold) {
+            continue;
+        }
+        if (hedges.load(std::memory_order_relaxed) >= max_hedge_rate * executions.load(std::memory_order_relaxed)) {
+            return nullptr;  // Hedge budget used up
+        }
+        std::shared_ptr<Execution> execution;
+        {
+            std::lock_guard<std::mutex> lock(slots[i].mutex);
+            execution = slots[i].execution;
+        }
+        if (execution && !execution->completed.load(std::memory_order_acquire) && !execution->hedged.exchange(true)) {
+            hedges++;
+            return execution;
+        }
+    }
+    return nullptr;
+}
+
+// Recomputes the threshold from the processing times since the last update
+void HedgeController::update_threshold() {
+    std::unique_lock<std::mutex> lock(update_mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return;
+    }
+    durations.snapshot(counts);
+    uint64_t samples = 0;
+    for (int i = 0; i < LatencyHistogram::NUM_BUCKETS; i++) {
+        std::swap(counts[i], last_counts[i]);
+        counts[i] = last_counts[i] - counts[i];
+        samples += counts[i];
+    }
+    if (samples >= min_samples) {
+        threshold_ns.store(LatencyHistogram::percentile_ns(counts, percentile), std::memory_order_relaxed);
+    }
+}
+
+// Hedging state for monitoring
+json HedgeController::get_stats() const {
+    json stats;
+    uint64_t total = executions.load();
+    uint64_t hedged = hedges.load();
+    stats["threshold_ms"] = threshold_ns.load() / 1e6;
+    stats["executions"] = total;
+    stats["hedges"] = hedged;
+    stats["hedge_rate"] = total > 0 ? static_cast<double>(hedged) / total : 0.0;
+    stats["hedge_wins"] = hedge_wins.load();
+    stats["discarded"] = discarded.load();
+    return stats;
+}
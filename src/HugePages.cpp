@@ -0,0 +1,185 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <sys/mman.h>
+#include "HugePages.h"
+
+using json = nlohmann::json;
+
+namespace {
+
+enum Mode { MODE_OFF, MODE_TRANSPARENT, MODE_EXPLICIT };
+
+// Bytes currently mapped for a region
+struct RegionStats {
+    uint64_t explicit_bytes = 0;
+    uint64_t transparent_bytes = 0;
+    uint64_t fallback_count = 0;
+};
+
+struct Mapping {
+    size_t size;
+    RegionStats* region;
+    bool is_explicit;
+};
+
+// Never destroyed: regions may be released during static destruction
+struct HugePageRegistry {
+    std::atomic<int> mode{MODE_OFF};
+    bool transparent_available = false;
+    std::mutex mutex;
+    std::unordered_map<void*, Mapping> mappings;
+    std::map<std::string, RegionStats> regions;
+};
+
+HugePageRegistry& registry() {
+    static HugePageRegistry* instance = new HugePageRegistry();
+    return *instance;
+}
+
+size_t round_up(size_t bytes) {
+    return (bytes + HugePages::HUGE_PAGE_SIZE - 1) / HugePages::HUGE_PAGE_SIZE * HugePages::HUGE_PAGE_SIZE;
+}
+
+// Transparent huge pages can be used unless the kernel setting is "never"
+bool read_transparent_available() {
+    std::ifstream file("/sys/kernel/mm/transparent_hugepage/enabled");
+    std::string setting;
+    if (!std::getline(file, setting)) {
+        return false;
+    }
+    return setting.find("[never]") == std::string::npos;
+}
+
+// Maps size bytes aligned to a huge page and asks the kernel to back them with huge pages
+void* map_transparent(size_t size) {
+    size_t span = size + HugePages::HUGE_PAGE_SIZE;
+    void* memory = mmap(nullptr, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return nullptr;
+    }
+    // Trim the mapping to a huge page boundary
+    uintptr_t begin = reinterpret_cast<uintptr_t>(memory);
+    uintptr_t aligned = (begin + HugePages::HUGE_PAGE_SIZE - 1) & ~(static_cast<uintptr_t>(HugePages::HUGE_PAGE_SIZE) - 1);
+    if (aligned > begin) {
+        munmap(memory, aligned - begin);
+    }
+    size_t tail = begin + span - (aligned + size);
+    if (tail > 0) {
+        munmap(reinterpret_cast<void*>(aligned + size), tail);
+    }
+    madvise(reinterpret_cast<void*>(aligned), size, MADV_HUGEPAGE);
+    return reinterpret_cast<void*>(aligned);
+}
+
+const char* mode_name(int mode) {
+    return mode == MODE_EXPLICIT ? "explicit" : mode == MODE_TRANSPARENT ? "transparent" : "off";
+}
+
+}
+
+// Sets the mode from the "huge_pages" configuration section
+void HugePages::configure(const json& configuration) {
+    HugePageRegistry& reg = registry();
+    std::string mode = configuration.is_null() ? std::string("off") : configuration.value("mode", std::string("transparent"));
+    reg.transparent_available = read_transparent_available();
+    reg.mode = mode == "explicit" ? MODE_EXPLICIT : mode == "transparent" ? MODE_TRANSPARENT : MODE_OFF;
+}
+
+bool HugePages::is_enabled() {
+    return registry().mode.load(std::memory_order_relaxed) != MODE_OFF;
+}
+
+// Allocates at least bytes (rounded up to huge pages, the rounded size is
+// returned in allocated) backed by huge pages. Returns nullptr if huge
+// pages are disabled or not available: the caller must then use a
+// regular allocation
+void* HugePages::allocate(size_t bytes, const char* region, size_t& allocated) {
+    HugePageRegistry& reg = registry();
+    int mode = reg.mode.load(std::memory_order_relaxed);
+    if (mode == MODE_OFF) {
+        return nullptr;
+    }
+    allocated = round_up(bytes);
+
+    void* memory = nullptr;
+    bool is_explicit = false;
+    if (mode == MODE_EXPLICIT) {
+        memory = mmap(nullptr, allocated, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (memory == MAP_FAILED) {
+            memory = nullptr;  // No reserved huge pages left
+        } else {
+            is_explicit = true;
+        }
+    }
+    if (!memory && reg.transparent_available) {
+        memory = map_transparent(allocated);
+    }
+
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    RegionStats& stats = reg.regions[region];
+    if (!memory) {
+        stats.fallback_count++;
+        return nullptr;
+    }
+    if (is_explicit) {
+        stats.explicit_bytes += allocated;
+    } else {
+        stats.transparent_bytes += allocated;
+    }
+    reg.mappings[memory] = Mapping{allocated, &stats, is_explicit};
+    return memory;
+}
+
+// Releases a region returned by allocate. Returns false if the memory
+// does not come from allocate
+bool HugePages::deallocate(void* memory) {
+    HugePageRegistry& reg = registry();
+    size_t size;
+    {
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        auto it = reg.mappings.find(memory);
+        if (it == reg.mappings.end()) {
+            return false;
+        }
+        size = it->second.size;
+        if (it->second.is_explicit) {
+            it->second.region->explicit_bytes -= size;
+        } else {
+            it->second.region->transparent_bytes -= size;
+        }
+        reg.mappings.erase(it);
+    }
+    munmap(memory, size);
+    return true;
+}
+
+// Huge page usage by region for monitoring
+json HugePages::get_stats() {
+    HugePageRegistry& reg = registry();
+    json stats;
+    stats["mode"] = mode_name(reg.mode.load(std::memory_order_relaxed));
+    stats["transparent_available"] = reg.transparent_available;
+    json regions = json::object();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (const auto& [name, region] : reg.regions) {
+        json entry;
+        entry["explicit_bytes"] = region.explicit_bytes;
+        entry["transparent_bytes"] = region.transparent_bytes;
+        entry["fallbacks"] = region.fallback_count;
+        regions[name] = entry;
+    }
+    stats["regions"] = regions;
+    stats["mapped_regions"] = reg.mappings.size();
+    return stats;
+}
@@ -0,0 +1,639 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+#include <charconv>
+#include <cstring>
+#include <limits>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "JsonView.h"
+
+namespace {
+
+// Bitmasks of the character classes of a 64-byte block (bit i = byte i)
+struct BlockMasks {
+    uint64_t quote = 0;
+    uint64_t backslash = 0;
+    uint64_t op = 0;  // { } [ ] : ,
+    uint64_t whitespace = 0;
+    uint64_t control = 0;  // < 0x20
+};
+
+void classify(const uint8_t* block, BlockMasks& masks) {
+#if defined(__SSE2__)
+    for (int k = 0; k < 4; ++k) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * k));
+        // '[' and '{', ']' and '}' differ only by 0x20
+        __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        __m128i op = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(lower, _mm_set1_epi8('{')), _mm_cmpeq_epi8(lower, _mm_set1_epi8('}'))),
+                                  _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(':')), _mm_cmpeq_epi8(v, _mm_set1_epi8(','))));
+        __m128i whitespace = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+                                          _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+        __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(0x1f)), v);
+        int shift = 16 * k;
+        masks.quote |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('"'))))) << shift;
+        masks.backslash |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))))) << shift;
+        masks.op |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(op))) << shift;
+        masks.whitespace |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(whitespace))) << shift;
+        masks.control |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(control))) << shift;
+    }
+#else
+    for (int i = 0; i < 64; ++i) {
+        uint8_t c = block[i];
+        uint64_t bit = static_cast<uint64_t>(1) << i;
+        if (c == '"') masks.quote |= bit;
+        if (c == '\\') masks.backslash |= bit;
+        if (c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',') masks.op |= bit;
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r') masks.whitespace |= bit;
+        if (c < 0x20) masks.control |= bit;
+    }
+#endif
+}
+
+// Bit i set if an odd number of bits are set in [0, i]
+inline uint64_t prefix_xor(uint64_t bits) {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+// Characters escaped by a backslash. escape_carry is set if the previous
+// block ended with an escaping backslash, and updated for the next block
+inline uint64_t find_escaped(uint64_t backslash, uint64_t& escape_carry) {
+    if (backslash == 0 && escape_carry == 0) {
+        return 0;
+    }
+    uint64_t escaped = escape_carry;
+    backslash &= ~escape_carry;  // An escaped backslash does not escape
+    escape_carry = 0;
+    while (backslash) {
+        int i = __builtin_ctzll(backslash);
+        backslash &= backslash - 1;
+        if (i == 63) {
+            escape_carry = 1;
+        } else {
+            uint64_t next = static_cast<uint64_t>(1) << (i + 1);
+            escaped |= next;
+            backslash &= ~next;
+        }
+    }
+    return escaped;
+}
+
+inline bool is_whitespace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// Appends a code point to a string in UTF-8
+void append_utf8(std::string& out, uint32_t code) {
+    if (code < 0x80) {
+        out += static_cast<char>(code);
+    } else if (code < 0x800) {
+        out += static_cast<char>(0xc0 | (code >> 6));
+        out += static_cast<char>(0x80 | (code & 0x3f));
+    } else if (code < 0x10000) {
+        out += static_cast<char>(0xe0 | (code >> 12));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (code & 0x3f));
+    } else {
+        out += static_cast<char>(0xf0 | (code >> 18));
+        out += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (code & 0x3f));
+    }
+}
+
+bool read_hex4(std::string_view text, size_t pos, uint32_t& code) {
+    if (pos + 4 > text.size()) {
+        return false;
+    }
+    auto result = std::from_chars(text.data() + pos, text.data() + pos + 4, code, 16);
+    return result.ec == std::errc() && result.ptr == text.data() + pos + 4;
+}
+
+// Checks a number against the JSON grammar: -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+bool valid_number(std::string_view text) {
+    size_t i = 0;
+    size_t n = text.size();
+    auto digits = [&]() {
+        size_t begin = i;
+        while (i < n && text[i] >= '0' && text[i] <= '9') {
+            i++;
+        }
+        return i - begin;
+    };
+    if (i < n && text[i] == '-') {
+        i++;
+    }
+    if (i < n && text[i] == '0') {
+        i++;
+    } else if (digits() == 0) {
+        return false;
+    }
+    if (i < n && text[i] == '.') {
+        i++;
+        if (digits() == 0) {
+            return false;
+        }
+    }
+    if (i < n && (text[i] == 'e' || text[i] == 'E')) {
+        i++;
+        if (i < n && (text[i] == '+' || text[i] == '-')) {
+            i++;
+        }
+        if (digits() == 0) {
+            return false;
+        }
+    }
+    return i == n;
+}
+
+// Checks a literal or a number
+bool valid_scalar(std::string_view text) {
+    return text == "true" || text == "false" || text == "null" || valid_number(text);
+}
+
+// Checks the escape sequences of the content of a JSON string
+bool valid_escapes(std::string_view text) {
+    for (size_t i = text.find('\\'); i != std::string_view::npos; i = text.find('\\', i + 1)) {
+        if (++i >= text.size()) {
+            return false;
+        }
+        switch (text[i]) {
+            case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't':
+                break;
+            case 'u': {
+                uint32_t code;
+                if (!read_hex4(text, i + 1, code)) {
+                    return false;
+                }
+                i += 4;
+                if (code >= 0xdc00 && code < 0xe000) {
+                    return false;  // Low surrogate without its high surrogate
+                }
+                if (code >= 0xd800 && code < 0xdc00) {
+                    // A high surrogate must be followed by a low one
+                    uint32_t low;
+                    if (i + 2 >= text.size() || text[i + 1] != '\\' || text[i + 2] != 'u' || !read_hex4(text, i + 3, low) ||
+                        low < 0xdc00 || low >= 0xe000) {
+                        return false;
+                    }
+                    i += 6;
+                }
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+// Checks that the content of a JSON string is well-formed UTF-8 (RFC 3629: no
+// overlong forms, no encoded surrogates, nothing above U+10FFFF)
+bool valid_utf8(std::string_view text) {
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(text.data());
+    size_t size = text.size();
+    size_t i = 0;
+    while (i < size) {
+        // ASCII fast path, 8 bytes at a time
+        uint64_t word;
+        if (i + 8 <= size && (memcpy(&word, data + i, 8), (word & 0x8080808080808080ULL) == 0)) {
+            i += 8;
+            continue;
+        }
+        uint8_t c = data[i];
+        if (c < 0x80) {
+            i++;
+            continue;
+        }
+        size_t length;
+        uint8_t low = 0x80, high = 0xbf;  // Range of the second byte
+        if (c >= 0xc2 && c <= 0xdf) {
+            length = 2;
+        } else if (c >= 0xe0 && c <= 0xef) {
+            length = 3;
+            low = c == 0xe0 ? 0xa0 : low;
+            high = c == 0xed ? 0x9f : high;
+        } else if (c >= 0xf0 && c <= 0xf4) {
+            length = 4;
+            low = c == 0xf0 ? 0x90 : low;
+            high = c == 0xf4 ? 0x8f : high;
+        } else {
+            return false;
+        }
+        if (i + length > size || data[i + 1] < low || data[i + 1] > high) {
+            return false;
+        }
+        for (size_t k = 2; k < length; ++k) {
+            if (data[i + k] < 0x80 || data[i + k] > 0xbf) {
+                return false;
+            }
+        }
+        i += length;
+    }
+    return true;
+}
+
+// Unescapes the content of a JSON string
+bool unescape(std::string_view text, std::string& out) {
+    out.clear();
+    for (size_t i = 0; i < text.size(); ++i) {
+        char c = text[i];
+        if (c != '\\') {
+            out += c;
+            continue;
+        }
+        if (++i >= text.size()) {
+            return false;
+        }
+        switch (text[i]) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                uint32_t code;
+                if (!read_hex4(text, i + 1, code)) {
+                    return false;
+                }
+                i += 4;
+                if (code >= 0xd800 && code < 0xdc00) {
+                    // Surrogate pair
+                    uint32_t low;
+                    if (i + 2 >= text.size() || text[i + 1] != '\\' || text[i + 2] != 'u' || !read_hex4(text, i + 3, low) ||
+                        low < 0xdc00 || low >= 0xe000) {
+                        return false;
+                    }
+                    i += 6;
+                    code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                }
+                append_utf8(out, code);
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+// Indexes and validates a JSON text. Returns false if it is not valid (see get_error)
+bool JsonDocument::parse(std::string_view data) {
+    text = data;
+    count = 0;
+    error.clear();
+    if (data.size() >= std::numeric_limits<uint32_t>::max()) {
+        error = "document too large";
+        return false;
+    }
+    if (!index_structure() || !validate()) {
+        count = 0;
+        return false;
+    }
+    return true;
+}
+
+// Builds the structural index. Returns false for unterminated strings or control characters
+bool JsonDocument::index_structure() {
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(text.data());
+    size_t size = text.size();
+    uint64_t escape_carry = 0;
+    uint64_t in_string_carry = 0;  // All ones if the previous block ended inside a string
+    uint64_t scalar_carry = 0;  // 1 if the previous block ended inside a scalar
+    uint8_t tail[64];
+    // At most one structural per byte, plus the padding written by the unrolled loop below
+    if (positions.size() < size + 64) {
+        positions.resize(size + 64);
+    }
+    uint32_t* out = positions.data();
+
+    for (size_t offset = 0; offset < size; offset += 64) {
+        const uint8_t* block = data + offset;
+        if (size - offset < 64) {
+            // Last partial block, padded with spaces
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, block, size - offset);
+            block = tail;
+        }
+        BlockMasks masks;
+        classify(block, masks);
+
+        uint64_t escaped = find_escaped(masks.backslash, escape_carry);
+        uint64_t quote = masks.quote & ~escaped;
+        uint64_t in_string = prefix_xor(quote) ^ in_string_carry;  // Includes the opening quote
+        in_string_carry = static_cast<uint64_t>(static_cast<int64_t>(in_string) >> 63);
+
+        if ((masks.control & in_string) || (masks.control & ~masks.whitespace)) {
+            error = "control character at offset " + std::to_string(offset + __builtin_ctzll((masks.control & in_string) | (masks.control & ~masks.whitespace)));
+            return false;
+        }
+
+        uint64_t scalar = ~(masks.op | masks.whitespace | quote | in_string);
+        uint64_t scalar_start = scalar & ~((scalar << 1) | scalar_carry);
+        scalar_carry = scalar >> 63;
+
+        uint64_t structural = (masks.op & ~in_string) | (quote & in_string) | scalar_start;
+        // Unrolled by 4: the extra entries written are overwritten or beyond count
+        uint32_t base = static_cast<uint32_t>(offset);
+        int n = __builtin_popcountll(structural);
+        uint32_t* next = out + count;
+        for (int k = 0; k < n; k += 4) {
+            next[k] = base + __builtin_ctzll(structural);
+            structural &= structural - 1;
+            next[k + 1] = base + (structural ? __builtin_ctzll(structural) : 0);
+            structural &= structural - 1;
+            next[k + 2] = base + (structural ? __builtin_ctzll(structural) : 0);
+            structural &= structural - 1;
+            next[k + 3] = base + (structural ? __builtin_ctzll(structural) : 0);
+            structural &= structural - 1;
+        }
+        count += n;
+    }
+    if (in_string_carry) {
+        error = "unterminated string";
+        return false;
+    }
+    if (count == 0) {
+        error = "empty document";
+        return false;
+    }
+    return true;
+}
+
+// Checks the grammar and matches the brackets. Returns false if malformed
+bool JsonDocument::validate() {
+    enum Expect { VALUE, VALUE_OR_CLOSE, KEY, KEY_OR_CLOSE, COLON, COMMA_OR_CLOSE, END };
+    Expect expect = VALUE;
+    open.clear();
+    if (matching.size() < count) {
+        matching.resize(count);
+    }
+
+    for (uint32_t i = 0; i < count; ++i) {
+        char c = at_index(i);
+        bool value_done = false;
+        switch (expect) {
+            case VALUE:
+            case VALUE_OR_CLOSE:
+                if (c == '{') {
+                    open.push_back(i);
+                    expect = KEY_OR_CLOSE;
+                } else if (c == '[') {
+                    open.push_back(i);
+                    expect = VALUE_OR_CLOSE;
+                } else if (c == ']' && expect == VALUE_OR_CLOSE) {
+                    matching[open.back()] = i;
+                    open.pop_back();
+                    value_done = true;
+                } else if (c == ':' || c == ',' || c == '}' || c == ']') {
+                    error = std::string("unexpected '") + c + "' at offset " + std::to_string(positions[i]);
+                    return false;
+                } else if (!check_value(i)) {
+                    return false;
+                } else {
+                    value_done = true;  // String or scalar
+                }
+                break;
+            case KEY:
+            case KEY_OR_CLOSE:
+                if (c == '"') {
+                    if (!check_value(i)) {
+                        return false;
+                    }
+                    expect = COLON;
+                } else if (c == '}' && expect == KEY_OR_CLOSE) {
+                    matching[open.back()] = i;
+                    open.pop_back();
+                    value_done = true;
+                } else {
+                    error = "expected a key at offset " + std::to_string(positions[i]);
+                    return false;
+                }
+                break;
+            case COLON:
+                if (c != ':') {
+                    error = "expected ':' at offset " + std::to_string(positions[i]);
+                    return false;
+                }
+                expect = VALUE;
+                break;
+            case COMMA_OR_CLOSE:
+                if (c == ',') {
+                    expect = at_index(open.back()) == '{' ? KEY : VALUE;
+                } else if ((c == '}' || c == ']') && c == at_index(open.back()) + 2) {  // '{' + 2 == '}', '[' + 2 == ']'
+                    matching[open.back()] = i;
+                    open.pop_back();
+                    value_done = true;
+                } else {
+                    error = "expected ',' or a closing bracket at offset " + std::to_string(positions[i]);
+                    return false;
+                }
+                break;
+            case END:
+                error = "unexpected content after the document at offset " + std::to_string(positions[i]);
+                return false;
+        }
+        if (value_done) {
+            expect = open.empty() ? END : COMMA_OR_CLOSE;
+        }
+    }
+    if (expect != END) {
+        error = "unexpected end of document";
+        return false;
+    }
+    return true;
+}
+
+// Checks the string or scalar starting at index. Returns false if malformed
+bool JsonDocument::check_value(uint32_t index) {
+    std::string_view value = JsonValue(this, index).raw();
+    if (value[0] == '"') {
+        // Terminated by index_structure: the escapes and the encoding are left to check
+        std::string_view content = value.substr(1, value.size() - 2);
+        if (!valid_escapes(content)) {
+            error = "invalid escape in the string at offset " + std::to_string(positions[index]);
+            return false;
+        }
+        if (!valid_utf8(content)) {
+            error = "invalid UTF-8 in the string at offset " + std::to_string(positions[index]);
+            return false;
+        }
+    } else if (!valid_scalar(value)) {
+        error = "invalid literal or number at offset " + std::to_string(positions[index]);
+        return false;
+    }
+    return true;
+}
+
+// Index following the value starting at index
+uint32_t JsonDocument::skip(uint32_t index) const {
+    char c = at_index(index);
+    return (c == '{' || c == '[') ? matching[index] + 1 : index + 1;
+}
+
+// Root value (invalid if the last parse failed)
+JsonValue JsonDocument::root() const {
+    return count == 0 ? JsonValue() : JsonValue(this, 0);
+}
+
+JsonValue::Type JsonValue::type() const {
+    if (!document) {
+        return INVALID;
+    }
+    switch (document->at_index(index)) {
+        case '{': return OBJECT;
+        case '[': return ARRAY;
+        case '"': return STRING;
+        case 't':
+        case 'f': return BOOLEAN;
+        case 'n': return NULLVALUE;
+        default: return NUMBER;
+    }
+}
+
+// Field of an object. Returns an invalid value if missing or not an object
+JsonValue JsonValue::operator[](std::string_view key) const {
+    if (type() != OBJECT) {
+        return JsonValue();
+    }
+    uint32_t i = index + 1;
+    while (document->at_index(i) == '"') {
+        // Key between its quotes; the next structural is its ':'
+        std::string_view name = JsonValue(document, i).raw();
+        if (name.substr(1, name.size() - 2) == key) {
+            return JsonValue(document, i + 2);
+        }
+        uint32_t next = document->skip(i + 2);
+        if (document->at_index(next) != ',') {
+            break;
+        }
+        i = next + 1;
+    }
+    return JsonValue();
+}
+
+// Item of an array. Returns an invalid value if out of range or not an array
+JsonValue JsonValue::at(size_t item) const {
+    if (type() != ARRAY || document->at_index(index + 1) == ']') {
+        return JsonValue();
+    }
+    uint32_t i = index + 1;
+    for (size_t n = 0; n < item; ++n) {
+        uint32_t next = document->skip(i);
+        if (document->at_index(next) != ',') {
+            return JsonValue();
+        }
+        i = next + 1;
+    }
+    return JsonValue(document, i);
+}
+
+// Number of items of an array or fields of an object
+size_t JsonValue::size() const {
+    Type t = type();
+    if ((t != OBJECT && t != ARRAY) || document->matching[index] == index + 1) {
+        return 0;
+    }
+    size_t count = 1;
+    uint32_t i = index + 1;
+    while (true) {
+        uint32_t next = document->skip(t == OBJECT ? i + 2 : i);
+        if (document->at_index(next) != ',') {
+            return count;
+        }
+        i = next + 1;
+        count++;
+    }
+}
+
+// Text of the value, as in the document
+std::string_view JsonValue::raw() const {
+    if (!document) {
+        return std::string_view();
+    }
+    const auto& positions = document->positions;
+    uint32_t begin = positions[index];
+    char c = document->text[begin];
+    if (c == '{' || c == '[') {
+        return document->text.substr(begin, positions[document->matching[index]] + 1 - begin);
+    }
+    // Strings and scalars end before the next structural character
+    size_t end = index + 1 < document->count ? positions[index + 1] : document->text.size();
+    while (end > begin && is_whitespace(document->text[end - 1])) {
+        end--;
+    }
+    return document->text.substr(begin, end - begin);
+}
+
+bool JsonValue::get_string(std::string_view& value, std::string& scratch) const {
+    if (type() != STRING) {
+        return false;
+    }
+    std::string_view text = raw();
+    if (text.size() < 2 || text.back() != '"') {
+        return false;
+    }
+    text = text.substr(1, text.size() - 2);
+    if (text.find('\\') == std::string_view::npos) {
+        value = text;
+        return true;
+    }
+    if (!unescape(text, scratch)) {
+        return false;
+    }
+    value = scratch;
+    return true;
+}
+
+bool JsonValue::get_int64(int64_t& value) const {
+    if (type() != NUMBER) {
+        return false;
+    }
+    std::string_view text = raw();
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+bool JsonValue::get_double(double& value) const {
+    if (type() != NUMBER) {
+        return false;
+    }
+    std::string_view text = raw();
+    // from_chars also accepts "inf" and "nan", which are not JSON numbers
+    if (text.empty() || (text[0] != '-' && (text[0] < '0' || text[0] > '9'))) {
+        return false;
+    }
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+bool JsonValue::get_bool(bool& value) const {
+    std::string_view text = raw();
+    if (text == "true" || text == "false") {
+        value = text[0] == 't';
+        return true;
+    }
+    return false;
+}
+
+// Compatibility fallback: full nlohmann DOM of the value
+nlohmann::json JsonValue::to_json() const {
+    std::string_view text = raw();
+    return document ? nlohmann::json::parse(text.begin(), text.end()) : nlohmann::json();
+}
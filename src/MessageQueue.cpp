@@ -0,0 +1,183 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+#include <algorithm>
+#include "MessageQueue.h"
+#include "BatchController.h"
+
+MessageQueue::MessageQueue(size_t initial_capacity)
+    : ring(initial_capacity > 0 ? initial_capacity : 1, HugePageAllocator<PooledBuffer>("message_queue")), head(0), count(0),
+      deadline_scheduling(false), budget_ns(0), drop_expired(false),
+      heap(HugePageAllocator<Entry>("message_queue")), next_seq(0), expired_count(0), dropped_count(0) {
+}
+
+// Enables earliest deadline first ordering. Call before the queue is used
+void MessageQueue::set_deadline_scheduling(int64_t budget_ns, bool drop_expired) {
+    std::lock_guard<std::mutex> lock(mutex);
+    deadline_scheduling = true;
+    this->budget_ns = budget_ns;
+    this->drop_expired = drop_expired;
+    heap.reserve(ring.size());
+}
+
+// Doubles the ring capacity. Requires the lock
+void MessageQueue::grow() {
+    size_t n = count.load(std::memory_order_relaxed);
+    std::vector<PooledBuffer, HugePageAllocator<PooledBuffer>> larger(ring.size() * 2, ring.get_allocator());
+    for (size_t i = 0; i < n; ++i) {
+        larger[i] = std::move(ring[(head + i) % ring.size()]);
+    }
+    ring.swap(larger);
+    head = 0;
+}
+
+// Appends a message. Requires the lock
+void MessageQueue::push_locked(const PooledBuffer& buffer) {
+    size_t n = count.load(std::memory_order_relaxed);
+    if (deadline_scheduling) {
+        int64_t deadline_ns = buffer.get_deadline();
+        if (deadline_ns == 0) {
+            deadline_ns = budget_ns > 0 && buffer.get_timestamp() != 0 ? buffer.get_timestamp() + budget_ns : NO_DEADLINE;
+        }
+        heap.push_back(Entry{deadline_ns, next_seq++, buffer});
+        std::push_heap(heap.begin(), heap.end(), Later());
+    } else {
+        if (n == ring.size()) {
+            grow();
+        }
+        ring[(head + n) % ring.size()] = buffer;
+    }
+    count.store(n + 1, std::memory_order_relaxed);
+}
+
+// Removes the next message. Requires the lock
+bool MessageQueue::pop_locked(PooledBuffer& buffer, int64_t now) {
+    size_t n = count.load(std::memory_order_relaxed);
+    if (!deadline_scheduling) {
+        if (n == 0) {
+            return false;
+        }
+        buffer = std::move(ring[head]);
+        ring[head].reset();
+        head = (head + 1) % ring.size();
+        count.store(n - 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), Later());
+        Entry& entry = heap.back();
+        bool expired = entry.deadline_ns < now;
+        buffer = std::move(entry.buffer);
+        heap.pop_back();
+        count.store(--n, std::memory_order_relaxed);
+        if (!expired) {
+            return true;
+        }
+        expired_count.fetch_add(1, std::memory_order_relaxed);
+        if (!drop_expired) {
+            return true;
+        }
+        // Too late to be useful: free the worker for a message that can still be on time
+        dropped_count.fetch_add(1, std::memory_order_relaxed);
+        buffer.reset();
+    }
+    return false;
+}
+
+// Sizes the queue for capacity messages, so it does not grow below that
+void MessageQueue::reserve(size_t capacity) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (deadline_scheduling) {
+        heap.reserve(capacity);
+    } else {
+        while (ring.size() < capacity) {
+            grow();
+        }
+    }
+}
+
+// Appends a message
+void MessageQueue::push(PooledBuffer buffer) {
+    std::lock_guard<std::mutex> lock(mutex);
+    push_locked(buffer);
+}
+
+// Appends several messages at once (shared with the caller, which keeps its handles)
+void MessageQueue::push_batch(const std::vector<PooledBuffer>& buffers) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!deadline_scheduling) {
+        while (count.load(std::memory_order_relaxed) + buffers.size() > ring.size()) {
+            grow();
+        }
+    }
+    for (const auto& buffer : buffers) {
+        push_locked(buffer);
+    }
+}
+
+// Removes the next message. Returns false if the queue is empty
+bool MessageQueue::pop(PooledBuffer& buffer) {
+    int64_t now = deadline_scheduling ? BatchController::now_ns() : 0;
+    std::lock_guard<std::mutex> lock(mutex);
+    return pop_locked(buffer, now);
+}
+
+// Removes up to max_count messages, appending them to out. Returns the number removed
+size_t MessageQueue::pop_batch(std::vector<PooledBuffer>& out, size_t max_count) {
+    int64_t now = deadline_scheduling ? BatchController::now_ns() : 0;
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t taken = 0;
+    PooledBuffer buffer;
+    while (taken < max_count && pop_locked(buffer, now)) {
+        out.push_back(std::move(buffer));
+        taken++;
+    }
+    return taken;
+}
+
+// Removes up to count messages without delivering them: the oldest ones or,
+// with EDF, those with the latest deadlines. Returns the number removed
+size_t MessageQueue::drop_oldest(size_t count) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (deadline_scheduling) {
+        // The least urgent messages go first, so the earliest deadlines can still be met
+        size_t n = heap.size();
+        size_t dropped = std::min(count, n);
+        if (dropped == 0) {
+            return 0;
+        }
+        auto earlier = [](const Entry& a, const Entry& b) { return Later()(b, a); };
+        std::nth_element(heap.begin(), heap.begin() + (n - dropped), heap.end(), earlier);
+        heap.erase(heap.begin() + (n - dropped), heap.end());
+        std::make_heap(heap.begin(), heap.end(), Later());
+        this->count.store(n - dropped, std::memory_order_relaxed);
+        return dropped;
+    }
+    size_t dropped = 0;
+    PooledBuffer buffer;
+    while (dropped < count && pop_locked(buffer, 0)) {
+        buffer.reset();
+        dropped++;
+    }
+    return dropped;
+}
+
+// Removes all the messages
+void MessageQueue::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t n = count.load(std::memory_order_relaxed);
+    if (deadline_scheduling) {
+        heap.clear();
+    } else {
+        for (size_t i = 0; i < n; ++i) {
+            ring[(head + i) % ring.size()].reset();
+        }
+    }
+    head = 0;
+    count.store(0, std::memory_order_relaxed);
+}
@@ -14,39 +14,40 @@ using json = nlohmann::json;
 
 // Constructor to initialize the MonitoringThread with a socket and MonitoringPoint reference
 MonitoringThread::MonitoringThread(zmq::socket_t& socket_monitoring, MonitoringPoint& monitoringpoint)
-    : socket_monitoring(socket_monitoring), monitoringpoint(monitoringpoint), stop_event(false) {
+    : timer(0), socket_monitoring(socket_monitoring), monitoringpoint(monitoringpoint), skipped_ticks(0) {
     std::cout << "Monitoring-Thread started" << std::endl;
 }
 
-// Destructor to stop the thread and clean up resources
+// Destructor to stop the timer and clean up resources
 MonitoringThread::~MonitoringThread() {
     stop();
-    if (thread.joinable()) {
-        thread.join();
-    }
 }
 
-// Starts the monitoring thread
+// Starts the monitoring ticks, once a second
 void MonitoringThread::start() {
-    thread = std::thread(&MonitoringThread::run, this);
+    stop();
+    timer = TimerService::get_instance().schedule_periodic(1000000000LL, [this]() { run(); });
 }
 
 void MonitoringThread::stop() {
-    stop_event = true;
+    TimerService::get_instance().cancel(timer);
+    timer = 0;
 }
 
+// Refreshes and sends the monitoring data (one tick)
 void MonitoringThread::run() {
-    while (!stop_event) {
-        json monitoring_data = monitoringpoint.get_data();  // Get the current monitoring data
-        std::string monitoring_data_str = monitoring_data.dump();  // Convert JSON to string
-        zmq::message_t message(monitoring_data_str.begin(), monitoring_data_str.end());  // Create ZMQ message
-        socket_monitoring.send(message, zmq::send_flags::none);  // Send the message through the socket
-        std::this_thread::sleep_for(std::chrono::seconds(1));  // Sleep for 1 second
+    monitoringpoint.refresh();  // Publish a new snapshot
+    std::string monitoring_data_str = monitoringpoint.get_serialized();  // Already serialized by refresh
+    zmq::message_t message(monitoring_data_str.begin(), monitoring_data_str.end());  // Create ZMQ message
+    // Never block the shared timer thread: if the socket is full the tick is skipped, the next one carries a newer snapshot
+    if (!socket_monitoring.send(message, zmq::send_flags::dontwait)) {
+        skipped_ticks++;
     }
 }
 
 // Sends monitoring data to a specific process target name
 void MonitoringThread::sendto(const std::string& processtargetname) {
+    monitoringpoint.refresh();  // Skipped if the tick is refreshing: its snapshot is sent
     json monitoring_data = monitoringpoint.get_data();  // Get the current monitoring data
     monitoring_data["header"]["pidtarget"] = processtargetname;  // Set the target process name
     std::string monitoring_data_str = monitoring_data.dump();  // Convert JSON to string
@@ -7,10 +7,14 @@
 //
 #include "MonitoringPoint.h"
 #include "WorkerManager.h"
+#include "MonitoringThread.h"
+#include "SchemaRegistry.h"
+#include <thread>
 
 // Constructor to initialize the MonitoringPoint with a WorkerManager pointer
 MonitoringPoint::MonitoringPoint(WorkerManager* manager)
-    : manager(manager), processOS(getpid()) {
+    : manager(manager), processOS(getpid()), current(0) {
+    nlohmann::json data;
     data["header"]["type"] = 1;
     data["header"]["time"] = 0;  // Replace with actual timestamp if needed
     data["header"]["pidsource"] = manager->getFullname();
@@ -22,33 +26,98 @@ MonitoringPoint::MonitoringPoint(WorkerManager* manager)
     data["queue_lp_size"] = 0;  // Initial low priority queue size
     data["queue_hp_size"] = 0;  // Initial high priority queue size
 
+    for (int i = 0; i < 2; i++) {
+        snapshots[i].data = data;
+        snapshots[i].serialized = data.dump();
+        readers[i] = 0;
+    }
+
     std::cout << "MonitoringPoint initialised" << std::endl;
 }
 
-// Updates the data map with a new key-value pair
+// Updates the data map with a new key-value pair (published by the next refresh)
 void MonitoringPoint::update(const std::string& key, const nlohmann::json& value) {
-    std::lock_guard<std::mutex> lock(data_mutex);
-    data[key] = value;
+    std::lock_guard<std::mutex> lock(pending_mutex);
+    pending[key] = value;
+}
+
+// Pins the published snapshot for reading. Returns its index
+int MonitoringPoint::acquire() {
+    while (true) {
+        int index = current.load();
+        readers[index]++;
+        if (current.load() == index) {
+            return index;  // Still published: a refresh now writes the other one
+        }
+        readers[index]--;
+    }
+}
+
+// Releases a snapshot pinned by acquire
+void MonitoringPoint::release(int index) {
+    readers[index]--;
 }
 
-// Retrieves the current data including system resource monitoring
+// Computes and publishes a new snapshot. Returns false if another refresh
+// was already running (its snapshot is published instead)
+bool MonitoringPoint::refresh() {
+    std::unique_lock<std::mutex> lock(refresh_mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return false;
+    }
+    int back = 1 - current.load();
+    while (readers[back].load() != 0) {
+        std::this_thread::yield();  // A reader is still copying the snapshot published before the last refresh
+    }
+    Snapshot& snapshot = snapshots[back];
+    {
+        std::lock_guard<std::mutex> pending_lock(pending_mutex);
+        for (auto& item : pending.items()) {
+            snapshot.data[item.key()] = item.value();
+        }
+    }
+    compute(snapshot.data);
+    snapshot.serialized = snapshot.data.dump();
+    current.store(back);
+    return true;
+}
+
+// Returns a copy of the published monitoring data
 nlohmann::json MonitoringPoint::get_data() {
-    std::lock_guard<std::mutex> lock(data_mutex);
-    resource_monitor();  // Update resource monitoring data
+    int index = acquire();
+    nlohmann::json data = snapshots[index].data;
+    release(index);
+    return data;
+}
+
+// Returns the published monitoring data, serialized
+std::string MonitoringPoint::get_serialized() {
+    int index = acquire();
+    std::string serialized = snapshots[index].serialized;
+    release(index);
+    return serialized;
+}
+
+// Computes the monitoring data into a snapshot
+void MonitoringPoint::compute(nlohmann::json& data) {
+    resource_monitor(data);  // Update resource monitoring data
     data["header"]["time"] = std::time(0);  // Update timestamp
-    set_status(manager->getStatus());  // Update status
+    data["workermanagerstatus"] = manager->getStatus();  // Update status
     data["stopdatainput"] = manager->getStopData();  // Update stop data input
+    if (manager->getMonitoringThread()) {
+        data["monitoring_skipped"] = manager->getMonitoringThread()->get_skipped_ticks();  // Ticks dropped on a full socket
+    }
 
     // Update queue sizes
-    update("queue_lp_size", manager->getLowPriorityQueue()->size());
-    update("queue_hp_size", manager->getHighPriorityQueue()->size());
-    update("queue_lp_result_size", manager->getResultLpQueue()->size());
-    update("queue_hp_result_size", manager->getResultHpQueue()->size());
+    data["queue_lp_size"] = manager->getLowPriorityQueue()->size();
+    data["queue_hp_size"] = manager->getHighPriorityQueue()->size();
+    data["queue_lp_result_size"] = manager->getResultLpQueue()->size();
+    data["queue_hp_result_size"] = manager->getResultHpQueue()->size();
 
     // Update worker status
-    update("workersstatusinit", manager->getWorkersStatusInit());
-    update("workersstatus", manager->getWorkersStatus());
-    update("workersname", manager->getWorkersName());
+    data["workersstatusinit"] = manager->getWorkersStatusInit();
+    data["workersstatus"] = manager->getWorkersStatus();
+    data["workersname"] = manager->getWorkersName();
 
     if (manager->getProcessingType() == "thread") {
         for (const auto& worker : manager->getWorkerThreads()) {
@@ -59,27 +128,167 @@ nlohmann::json MonitoringPoint::get_data() {
         }
     }
 
+    // Update size-aware routing information
+    if (manager->is_size_routing()) {
+        data["size_routing"] = manager->get_size_routing_stats();
+    }
+
+    // Update worker timing hooks information
+    std::vector<const WorkerMetrics*> metrics;
+    for (const auto& worker : manager->getWorkerThreads()) {
+        metrics.push_back(&worker->getWorker()->get_metrics());
+    }
+    for (const auto& worker : manager->getFusedWorkers()) {
+        metrics.push_back(&worker->get_metrics());
+    }
+    nlohmann::json worker_metrics = WorkerMetrics::get_stats(metrics);
+    if (!worker_metrics.empty()) {
+        data["worker_metrics"] = std::move(worker_metrics);
+    }
+
+    // Update sharding information
+    ShardRouter* shard_router = manager->getSupervisor()->shard_router;
+    if (shard_router && shard_router->is_enabled()) {
+        data["sharding"]["shard_id"] = shard_router->get_shard_id();
+        data["sharding"]["num_shards"] = shard_router->get_num_shards();
+        data["sharding"]["accepted"] = shard_router->get_accepted_count();
+        data["sharding"]["skipped"] = shard_router->get_skipped_count();
+        data["sharding"]["unkeyed"] = shard_router->get_unkeyed_count();
+    }
+
+    // Update per-core mode information
+    if (PerCoreMode::is_enabled()) {
+        data["per_core"]["core_id"] = PerCoreMode::get_core_id();
+        data["per_core"]["num_cores"] = PerCoreMode::get_num_cores();
+        CrossShardChannel* cross_shard = manager->getSupervisor()->cross_shard;
+        if (cross_shard) {
+            data["per_core"]["channel"] = cross_shard->get_stats();
+        }
+    }
+
+    // Update checkpoint information
+    if (manager->getCheckpointManager()) {
+        data["checkpoints_written"] = manager->getCheckpointManager()->get_checkpoints_written();
+    }
+
+    // Update at-least-once delivery information
+    ReliableSender* reliable_sender = manager->getReliableSender();
+    if (reliable_sender) {
+        data["reliable"]["sent"] = reliable_sender->get_sent_count();
+        data["reliable"]["retransmitted"] = reliable_sender->get_retransmitted_count();
+        data["reliable"]["replay_errors"] = reliable_sender->get_replay_errors();
+        data["reliable"]["acks"] = reliable_sender->get_ack_count();
+        data["reliable"]["unacked_lp"] = reliable_sender->get_unacked_count(0);
+        data["reliable"]["unacked_hp"] = reliable_sender->get_unacked_count(1);
+        data["reliable"]["spilled_lp"] = reliable_sender->get_spilled_count(0);
+        data["reliable"]["spilled_hp"] = reliable_sender->get_spilled_count(1);
+        data["reliable"]["dropped_lp"] = reliable_sender->get_dropped_count(0);
+        data["reliable"]["dropped_hp"] = reliable_sender->get_dropped_count(1);
+    }
+    Supervisor* supervisor = manager->getSupervisor();
+    if (supervisor->reliable_lp_receiver && supervisor->reliable_hp_receiver) {
+        data["reliable_input"]["delivered"] = supervisor->reliable_lp_receiver->get_delivered_count() + supervisor->reliable_hp_receiver->get_delivered_count();
+        data["reliable_input"]["duplicates"] = supervisor->reliable_lp_receiver->get_duplicate_count() + supervisor->reliable_hp_receiver->get_duplicate_count();
+        data["reliable_input"]["gaps"] = supervisor->reliable_lp_receiver->get_gap_count() + supervisor->reliable_hp_receiver->get_gap_count();
+    }
+
+    // Update deadline scheduling information
+    if (manager->getHighPriorityQueue()->is_deadline_scheduling()) {
+        data["deadline"]["hp_expired"] = manager->getHighPriorityQueue()->get_expired_count();
+        data["deadline"]["hp_dropped"] = manager->getHighPriorityQueue()->get_dropped_count();
+        data["deadline"]["lp_expired"] = manager->getLowPriorityQueue()->get_expired_count();
+        data["deadline"]["lp_dropped"] = manager->getLowPriorityQueue()->get_dropped_count();
+    }
+
+    // Update load shedding information
+    if (manager->getOverloadGovernor()) {
+        data["load_shedding"] = manager->getOverloadGovernor()->get_stats();
+    }
+
+    // Update latency SLO information
+    if (manager->getSloMonitor()) {
+        data["slo"] = manager->getSloMonitor()->get_stats();
+    }
+
+    // Update hedged execution information
+    if (manager->getHedgeController()) {
+        data["hedging"] = manager->getHedgeController()->get_stats();
+    }
+
+    // Update result cache information
+    if (manager->getResultCache()) {
+        data["result_cache"] = manager->getResultCache()->get_stats();
+    }
+
+    // Update shared executor information
+    SharedExecutor* shared_executor = manager->getSupervisor()->shared_executor;
+    if (shared_executor) {
+        json executor_stats = shared_executor->get_stats(manager);
+        if (!executor_stats.is_null()) {
+            data["shared_executor"] = executor_stats;
+        }
+    }
+
+    // Update adaptive batching information
+    if (manager->getBatchController()) {
+        data["adaptive_batching"] = manager->getBatchController()->get_stats();
+    }
+
+    // Update real-time mode information
+    if (manager->getSupervisor()->realtime->is_enabled()) {
+        data["realtime"] = manager->getSupervisor()->realtime->get_stats();
+    }
+
+    // Update message buffer pool information
+    data["buffer_pool"] = BufferPool::get_stats();
+
+    // Update timer service information
+    data["timer_service"] = TimerService::get_instance().get_stats();
+
+    // Update result sink information
+    int indexmanager = manager->get_manager_id();
+    if (!supervisor->sink_lp_result[indexmanager].empty() || !supervisor->sink_hp_result[indexmanager].empty()) {
+        nlohmann::json sinks_lp = nlohmann::json::array();
+        nlohmann::json sinks_hp = nlohmann::json::array();
+        for (auto &sink : supervisor->sink_lp_result[indexmanager]) {
+            sinks_lp.push_back(sink->get_stats());
+        }
+        for (auto &sink : supervisor->sink_hp_result[indexmanager]) {
+            sinks_hp.push_back(sink->get_stats());
+        }
+        data["result_sinks"]["lp"] = std::move(sinks_lp);
+        data["result_sinks"]["hp"] = std::move(sinks_hp);
+    }
+
+    // Update Avro schema registry information
+    data["schema_registry"] = SchemaRegistry::get_instance().get_stats();
+
+    // Update huge page information
+    if (HugePages::is_enabled()) {
+        data["huge_pages"] = HugePages::get_stats();
+    }
+
     // Update data with worker processing information
     data["worker_rates"] = processing_rates;
     data["worker_tot_events"] = processing_tot_events;
     data["worker_status"] = worker_status;
-    return data;
 }
 
-// Sets the status in the data map
+// Sets the status in the data map (published by the next refresh)
 void MonitoringPoint::set_status(const std::string& new_status) {
-    std::lock_guard<std::mutex> lock(data_mutex);
-    data["workermanagerstatus"] = new_status;
+    update("workermanagerstatus", new_status);
 }
 
-// Gets the current status from the data map
+// Gets the published status
 std::string MonitoringPoint::get_status() {
-    std::lock_guard<std::mutex> lock(data_mutex);
-    return data["workermanagerstatus"].get<std::string>();
+    int index = acquire();
+    std::string status = snapshots[index].data["workermanagerstatus"].get<std::string>();
+    release(index);
+    return status;
 }
 
 // Monitors and updates system resources (CPU, memory)
-void MonitoringPoint::resource_monitor() {
+void MonitoringPoint::resource_monitor(nlohmann::json& data) {
     struct sysinfo memInfo;
     sysinfo(&memInfo);
 
@@ -0,0 +1,126 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+#include <algorithm>
+#include "OverloadGovernor.h"
+#include "WorkerManager.h"
+
+using json = nlohmann::json;
+
+// Constructor to initialize the governor from the "load_shedding" configuration section
+OverloadGovernor::OverloadGovernor(const json& configuration, WorkerManager* manager, WorkerLogger* logger, const std::string& fullname, const std::string& globalname)
+    : manager(manager), logger(logger), fullname(fullname), globalname(globalname),
+      shedding(false), saturated_intervals(0), recovered_intervals(0), last_queue_size(0), last_busy_ns(0), last_check_ns(0),
+      utilization(0.0), lp_seen(0), lp_sampled_out(0), lp_dropped(0), shedding_episodes(0), timer(0) {
+    interval_ms = std::max(10, configuration.value("interval_ms", 500));
+    sustain_intervals = std::max(1, configuration.value("sustain_intervals", 6));
+    utilization_threshold = configuration.value("utilization_threshold", 0.9);
+    queue_high_watermark = configuration.value("queue_high_watermark", static_cast<size_t>(1000));
+    lp_sample_n = std::max<uint64_t>(1, configuration.value("lp_sample_n", static_cast<uint64_t>(10)));
+    max_lp_queue = configuration.value("max_lp_queue", static_cast<size_t>(10000));
+
+    std::vector<std::string> policy = configuration.value("policy", std::vector<std::string>{"sample_lp", "drop_oldest_lp"});
+    sample_lp = std::find(policy.begin(), policy.end(), "sample_lp") != policy.end();
+    drop_oldest_lp = std::find(policy.begin(), policy.end(), "drop_oldest_lp") != policy.end();
+
+    logger->system(fmt::format("Load shedding: utilization {} high watermark {} sample 1/{} max LP queue {}",
+                               utilization_threshold, queue_high_watermark, lp_sample_n, max_lp_queue), globalname);
+}
+
+OverloadGovernor::~OverloadGovernor() {
+    stop();
+}
+
+// Queues received messages, applying the LP shedding policy
+void OverloadGovernor::enqueue(int priority, MessageQueue& queue, const std::vector<PooledBuffer>& received) {
+    if (priority != 0 || !shedding || !sample_lp) {
+        queue.push_batch(received);
+        return;
+    }
+    for (const auto& buffer : received) {
+        if (lp_seen.fetch_add(1, std::memory_order_relaxed) % lp_sample_n == 0) {
+            queue.push(buffer);
+        } else {
+            lp_sampled_out.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+// Sums the busy time of the worker threads
+int64_t OverloadGovernor::get_busy_ns(int& num_workers) const {
+    int64_t busy_ns = 0;
+    num_workers = 0;
+    for (const auto& worker : manager->getWorkerThreads()) {
+        busy_ns += worker->getBusyTime();
+        num_workers++;
+    }
+    return busy_ns;
+}
+
+// Evaluates the saturation of the last interval and applies the policy
+void OverloadGovernor::check() {
+    auto low_priority_queue = manager->getLowPriorityQueue();
+    auto high_priority_queue = manager->getHighPriorityQueue();
+    size_t queue_size = low_priority_queue->size() + high_priority_queue->size();
+
+    int num_workers = 0;
+    int64_t busy_ns = get_busy_ns(num_workers);
+    int64_t now = BatchController::now_ns();
+    if (last_check_ns != 0 && now > last_check_ns) {
+        // Without worker threads (process mode) only the queues are considered
+        utilization = num_workers > 0 ? static_cast<double>(busy_ns - last_busy_ns) / (static_cast<double>(now - last_check_ns) * num_workers) : 1.0;
+    }
+    bool growing = queue_size > last_queue_size;
+    last_busy_ns = busy_ns;
+    last_check_ns = now;
+    last_queue_size = queue_size;
+
+    bool saturated = utilization >= utilization_threshold &&
+                     ((growing && queue_size > queue_high_watermark / 2) || queue_size > queue_high_watermark);
+    bool recovered = queue_size < queue_high_watermark / 2 && !growing;
+    saturated_intervals = saturated ? saturated_intervals + 1 : 0;
+    recovered_intervals = recovered ? recovered_intervals + 1 : 0;
+
+    if (!shedding && saturated_intervals >= sustain_intervals) {
+        shedding = true;
+        shedding_episodes++;
+        std::string message = fmt::format("Overload: start shedding LP load (queues {}, utilization {:.2f})", queue_size, utilization.load());
+        logger->warning(message, globalname);
+        manager->getSupervisor()->send_alarm(2, message, fullname, ALARM_CODE_SHEDDING_START, "High");
+    } else if (shedding && recovered_intervals >= sustain_intervals) {
+        shedding = false;
+        std::string message = fmt::format("Overload ended: stop shedding (LP sampled out {}, LP dropped {})", lp_sampled_out.load(), lp_dropped.load());
+        logger->system(message, globalname);
+        manager->getSupervisor()->send_alarm(1, message, fullname, ALARM_CODE_SHEDDING_END, "Low");
+    }
+
+    if (shedding && drop_oldest_lp && low_priority_queue->size() > max_lp_queue) {
+        lp_dropped += low_priority_queue->drop_oldest(low_priority_queue->size() - max_lp_queue);
+    }
+}
+
+// Starts and stops the periodic checks on the timer service
+void OverloadGovernor::start() {
+    stop();
+    timer = TimerService::get_instance().schedule_periodic(static_cast<int64_t>(interval_ms) * 1000000, [this]() { check(); });
+}
+
+void OverloadGovernor::stop() {
+    TimerService::get_instance().cancel(timer);
+    timer = 0;
+}
+
+// Governor state for monitoring
+json OverloadGovernor::get_stats() const {
+    json stats;
+    stats["shedding"] = shedding.load();
+    stats["utilization"] = utilization.load();
+    stats["episodes"] = shedding_episodes.load();
+    stats["lp_sampled_out"] = lp_sampled_out.load();
+    stats["lp_dropped"] = lp_dropped.load();
+    return stats;
+}
@@ -0,0 +1,226 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <sched.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "PerCoreMode.h"
+#include "ConfigurationManager.h"
+
+using json = nlohmann::json;
+
+namespace {
+
+// Set once at launch, before any thread is created
+struct PerCoreState {
+    bool enabled = false;
+    int core_id = 0;
+    int num_cores = 1;
+    int port_stride = 1;
+    std::vector<pid_t> shards;  // In the launching process
+};
+
+PerCoreState state;
+
+// Forwards a termination signal of the launching process to the shards
+void forward_signal(int signum) {
+    for (pid_t pid : state.shards) {
+        kill(pid, signum);
+    }
+}
+
+// Pins the calling process (and the threads it will create) to a core
+void pin_to_core(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        std::cerr << "WARNING! Per-core mode: cannot pin to core " << cpu << ": " << std::strerror(errno) << std::endl;
+    }
+}
+
+}  // namespace
+
+// Forks and pins one pipeline shard per core if the process configuration
+// has a "per_core" section, and returns the core index in each shard
+int PerCoreMode::launch(const std::string& config_file, const std::string& name) {
+    ConfigurationManager config_manager(config_file);
+    json config = config_manager.get_configuration(name);
+    if (!config.contains("per_core")) {
+        return 0;
+    }
+    const json& configuration = config["per_core"];
+    int num_cores = configuration.value("num_cores", 0);
+    if (num_cores <= 0) {
+        num_cores = std::max(1, static_cast<int>(sysconf(_SC_NPROCESSORS_ONLN)));
+    }
+    int first_core = configuration.value("first_core", 0);
+    state.port_stride = configuration.value("port_stride", 1);
+    state.num_cores = num_cores;
+    state.enabled = true;
+
+    std::cout << "Per-core mode: " << num_cores << " shards from core " << first_core << std::endl;
+    for (int core = 0; core < num_cores; core++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            std::cerr << "ERROR: Per-core mode: fork failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        if (pid == 0) {
+            state.shards.clear();
+            state.core_id = core;
+            pin_to_core(first_core + core);
+            return core;
+        }
+        state.shards.push_back(pid);
+    }
+
+    signal(SIGTERM, forward_signal);
+    signal(SIGINT, forward_signal);
+    for (pid_t pid : state.shards) {
+        int status;
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+        }
+    }
+    std::cout << "Per-core mode: all shards terminated" << std::endl;
+    return -1;
+}
+
+bool PerCoreMode::is_enabled() {
+    return state.enabled;
+}
+
+int PerCoreMode::get_core_id() {
+    return state.core_id;
+}
+
+int PerCoreMode::get_num_cores() {
+    return state.num_cores;
+}
+
+// Name of the shard of a process ("<name>-core<i>", name if disabled)
+std::string PerCoreMode::shard_name(const std::string& name) {
+    return state.enabled ? name + "-core" + std::to_string(state.core_id) : name;
+}
+
+// Endpoint bound by a core for an endpoint of the configuration
+std::string PerCoreMode::core_endpoint(const std::string& endpoint, int core_id) {
+    if (endpoint.compare(0, 6, "tcp://") == 0) {
+        size_t colon = endpoint.rfind(':');
+        if (colon == std::string::npos || colon < 6 || endpoint.compare(colon + 1, std::string::npos, "*") == 0) {
+            return endpoint;  // Ephemeral port
+        }
+        int port = std::stoi(endpoint.substr(colon + 1));
+        return endpoint.substr(0, colon + 1) + std::to_string(port + core_id * state.port_stride);
+    }
+    if (endpoint.compare(0, 6, "ipc://") == 0) {
+        return endpoint + "-core" + std::to_string(core_id);
+    }
+    return endpoint;
+}
+
+// Endpoint bound by this shard (endpoint if disabled)
+std::string PerCoreMode::shard_endpoint(const std::string& endpoint) {
+    return state.enabled ? core_endpoint(endpoint, state.core_id) : endpoint;
+}
+
+CrossShardChannel::CrossShardChannel(zmq::context_t& context, const std::string& endpoint, WorkerLogger* logger, const std::string& globalname)
+    : core_id(PerCoreMode::get_core_id()), num_cores(PerCoreMode::get_num_cores()), logger(logger), globalname(globalname),
+      inbox(context, ZMQ_PULL), _stop_event(false), sent_count(0), dropped_count(0), received_count(0) {
+    inbox.bind(PerCoreMode::core_endpoint(endpoint, core_id));
+    inbox.set(zmq::sockopt::rcvtimeo, 100);
+    for (int core = 0; core < num_cores; core++) {
+        peers.emplace_back(context, ZMQ_PUSH);
+        if (core != core_id) {
+            peers.back().set(zmq::sockopt::linger, 0);
+            peers.back().connect(PerCoreMode::core_endpoint(endpoint, core));
+        }
+    }
+    logger->system("Cross-shard channel " + PerCoreMode::core_endpoint(endpoint, core_id), globalname);
+}
+
+CrossShardChannel::~CrossShardChannel() {
+    stop();
+}
+
+// Sets the handler of the received messages (before start)
+void CrossShardChannel::set_handler(Handler handler) {
+    this->handler = std::move(handler);
+}
+
+void CrossShardChannel::start() {
+    thread = std::thread(&CrossShardChannel::run, this);
+}
+
+void CrossShardChannel::stop() {
+    _stop_event = true;
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+// Sends a message to the shard of a core. Safe from any thread
+void CrossShardChannel::send(int core, const std::string& message) {
+    if (core < 0 || core >= num_cores || core == core_id) {
+        return;
+    }
+    std::string from = std::to_string(core_id);
+    std::lock_guard<std::mutex> lock(send_mutex);
+    // Never block: a dead or stalled shard must not stop the sending one. Once the
+    // first frame is queued, ZeroMQ accepts the rest of the multipart message
+    if (!peers[core].send(zmq::buffer(from), zmq::send_flags::sndmore | zmq::send_flags::dontwait)) {
+        if (dropped_count.fetch_add(1, std::memory_order_relaxed) == 0) {
+            logger->warning("WARNING! Cross-shard channel: core " + std::to_string(core) + " is not receiving, messages dropped", globalname);
+        }
+        return;
+    }
+    peers[core].send(zmq::buffer(message), zmq::send_flags::dontwait);
+    sent_count++;
+}
+
+// Sends a message to all the other shards
+void CrossShardChannel::broadcast(const std::string& message) {
+    for (int core = 0; core < num_cores; core++) {
+        send(core, message);
+    }
+}
+
+// Receives the messages of the other shards
+void CrossShardChannel::run() {
+    while (!_stop_event) {
+        zmq::message_t from;
+        zmq::message_t message;
+        try {
+            if (!inbox.recv(from, zmq::recv_flags::none)) {
+                continue;  // Timeout: check the stop flag
+            }
+            if (!from.more() || !inbox.recv(message, zmq::recv_flags::none)) {
+                continue;
+            }
+            received_count++;
+            if (handler) {
+                handler(std::stoi(from.to_string()), message.to_string());
+            }
+        } catch (const std::exception& e) {
+            spdlog::error("Exception caught in cross-shard channel: {}", e.what());
+        }
+    }
+}
+
+// Channel state for monitoring
+json CrossShardChannel::get_stats() const {
+    json stats;
+    stats["sent"] = sent_count.load();
+    stats["dropped"] = dropped_count.load();
+    stats["received"] = received_count.load();
+    return stats;
+}
@@ -0,0 +1,118 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+#include <stdexcept>
+#include "Pipeline.h"
+
+using json = nlohmann::json;
+
+// Constructor to build the DAG from the "manager" configuration array.
+// Throws std::invalid_argument for unknown inputs or cycles
+Pipeline::Pipeline(const json& managers) : enabled(false) {
+    if (!managers.is_array()) {
+        return;
+    }
+    for (const auto& manager : managers) {
+        if (manager.contains("inputs")) {
+            enabled = true;
+        }
+    }
+    int n = static_cast<int>(managers.size());
+    for (int i = 0; i < n; ++i) {
+        names.push_back(managers[i].value("name", std::to_string(i)));
+        if (!indexes.emplace(names[i], i).second) {
+            throw std::invalid_argument("Config file: duplicated manager name " + names[i]);
+        }
+        num_workers.push_back(managers[i].value("num_workers", 1));
+    }
+
+    inputs.resize(n);
+    outputs.resize(n);
+    sources.assign(n, false);
+    for (int i = 0; i < n; ++i) {
+        std::vector<std::string> input_names = managers[i].value("inputs", std::vector<std::string>{"source"});
+        for (const auto& input : input_names) {
+            if (input == "source") {
+                sources[i] = true;
+                continue;
+            }
+            auto it = indexes.find(input);
+            if (it == indexes.end()) {
+                throw std::invalid_argument("Config file: unknown input " + input + " of manager " + names[i]);
+            }
+            inputs[i].push_back(it->second);
+            outputs[it->second].push_back(i);
+        }
+    }
+
+    // Topological order (Kahn), rejecting cycles
+    std::vector<int> pending(n);
+    for (int i = 0; i < n; ++i) {
+        pending[i] = static_cast<int>(inputs[i].size());
+        if (pending[i] == 0) {
+            order.push_back(i);
+        }
+    }
+    for (size_t k = 0; k < order.size(); ++k) {
+        for (int next : outputs[order[k]]) {
+            if (--pending[next] == 0) {
+                order.push_back(next);
+            }
+        }
+    }
+    if (static_cast<int>(order.size()) != n) {
+        throw std::invalid_argument("Config file: the manager inputs contain a cycle");
+    }
+
+    // Fuse linear chains of stateless stages, following the topological order
+    heads.resize(n);
+    chains.resize(n);
+    for (int i : order) {
+        heads[i] = i;
+        if (inputs[i].size() == 1 && !sources[i]) {
+            int upstream = inputs[i][0];
+            if (outputs[upstream].size() == 1 && can_fuse(managers, upstream, i)) {
+                heads[i] = heads[upstream];
+                chains[heads[i]].push_back(i);
+            }
+        }
+    }
+}
+
+// Returns true if the edge from upstream to downstream can be fused
+bool Pipeline::can_fuse(const json& managers, int upstream, int downstream) const {
+    const json& up = managers[upstream];
+    const json& down = managers[downstream];
+    return up.value("stateless", false) && down.value("stateless", false) &&
+           num_workers[upstream] == num_workers[downstream] &&
+           up.value("result_lp_socket", std::string("none")) == "none" &&
+           up.value("result_hp_socket", std::string("none")) == "none" &&
+           down.value("batch_size", 1) <= 1 && !down.contains("adaptive_batching");
+}
+
+// Text description of the DAG for logging, e.g. "Calib+Filter -> Stats"
+std::string Pipeline::describe() const {
+    std::string text;
+    for (int i : order) {
+        if (heads[i] != i) {
+            continue;
+        }
+        if (!text.empty()) {
+            text += "; ";
+        }
+        text += names[i];
+        int tail = i;
+        for (int stage : chains[i]) {
+            text += "+" + names[stage];
+            tail = stage;
+        }
+        for (size_t k = 0; k < outputs[tail].size(); ++k) {
+            text += (k == 0 ? " -> " : ", ") + names[outputs[tail][k]];
+        }
+    }
+    return text;
+}
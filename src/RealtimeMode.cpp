@@ -0,0 +1,175 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+#include <algorithm>
+#include <alloca.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <thread>
+#include "RealtimeMode.h"
+#include "MessageQueue.h"
+#include "BufferPool.h"
+#include "BatchController.h"
+
+using json = nlohmann::json;
+
+namespace {
+
+// Page faults of the calling thread at the previous check
+struct ThreadFaults {
+    bool initialised = false;
+    long minor = 0;
+    long major = 0;
+    int64_t last_log_ns = 0;
+};
+
+thread_local ThreadFaults thread_faults;
+
+void read_thread_faults(long& minor, long& major) {
+    struct rusage usage;
+    getrusage(RUSAGE_THREAD, &usage);
+    minor = usage.ru_minflt;
+    major = usage.ru_majflt;
+}
+
+// Touches the next bytes of the stack, so later calls do not fault on it
+__attribute__((noinline)) void prefault_stack(size_t bytes) {
+    volatile char* stack = static_cast<volatile char*>(alloca(bytes));
+    for (size_t i = 0; i < bytes; i += 4096) {
+        stack[i] = 0;
+    }
+}
+
+}
+
+// Constructor to initialize the mode from the "realtime" configuration section
+RealtimeMode::RealtimeMode(const json& configuration, WorkerLogger* logger, const std::string& globalname)
+    : logger(logger), globalname(globalname), memory_locked(false), realtime_threads(0), failed_threads(0),
+      minor_faults(0), major_faults(0), faulting_intervals(0) {
+    enabled = !configuration.is_null() && configuration.value("enabled", true);
+    policy = configuration.value("policy", std::string("fifo")) == "rr" ? SCHED_RR : SCHED_FIFO;
+    lock_memory_enabled = configuration.value("lock_memory", true);
+    priorities = {{"hp_listener", 80}, {"worker", 70}, {"result", 60}, {"lp_listener", 50}};
+    if (configuration.contains("priorities")) {
+        for (auto& [role, priority] : configuration["priorities"].items()) {
+            priorities[role] = priority.get<int>();
+        }
+    }
+    prefault_stack_bytes = configuration.value("prefault_stack_kb", static_cast<size_t>(512)) * 1024;
+    prefault_buffers = configuration.value("prefault_buffers", static_cast<size_t>(1024));
+    prefault_buffer_size = configuration.value("prefault_buffer_size", static_cast<size_t>(4096));
+    queue_capacity = configuration.value("queue_capacity", static_cast<size_t>(65536));
+    idle_sleep_us = configuration.value("idle_sleep_us", 50);
+
+    if (enabled) {
+        logger->system(fmt::format("Real-time mode: policy {} lock memory {} queue capacity {}",
+                                   policy == SCHED_RR ? "rr" : "fifo", lock_memory_enabled, queue_capacity), globalname);
+    }
+}
+
+// Locks the process memory and prefaults the stack of the calling thread
+void RealtimeMode::lock_memory() {
+    if (!enabled || !lock_memory_enabled) {
+        return;
+    }
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        logger->warning(fmt::format("Real-time mode: mlockall failed: {}", strerror(errno)), globalname);
+        return;
+    }
+    memory_locked = true;
+    prefault_stack(prefault_stack_bytes);
+    logger->system("Real-time mode: process memory locked", globalname);
+}
+
+// Applies the real-time priority of a role to the calling thread and
+// prefaults its stack (and its buffer cache for the listeners)
+void RealtimeMode::enter_thread(const std::string& role, const std::string& threadname) {
+    if (!enabled) {
+        return;
+    }
+    auto it = priorities.find(role);
+    if (it != priorities.end()) {
+        struct sched_param param;
+        param.sched_priority = std::max(sched_get_priority_min(policy), std::min(it->second, sched_get_priority_max(policy)));
+        int error = pthread_setschedparam(pthread_self(), policy, &param);
+        if (error != 0) {
+            failed_threads++;
+            logger->warning(fmt::format("Real-time mode: cannot set priority {} for {}: {}", param.sched_priority, threadname, strerror(error)), globalname);
+        } else {
+            realtime_threads++;
+            logger->system(fmt::format("Real-time mode: {} ({}) priority {}", threadname, role, param.sched_priority), globalname);
+        }
+    }
+
+    prefault_stack(prefault_stack_bytes);
+    if (role == "hp_listener" || role == "lp_listener") {
+        // Listeners allocate the message buffers: fill their cache in advance
+        BufferPool::reserve(prefault_buffer_size, prefault_buffers);
+    }
+
+    thread_faults.initialised = true;
+    read_thread_faults(thread_faults.minor, thread_faults.major);
+}
+
+// Sizes a queue to the configured capacity, so it does not grow while processing
+void RealtimeMode::prefault_queue(MessageQueue& queue) {
+    if (enabled) {
+        queue.reserve(queue_capacity);
+    }
+}
+
+// Called by a polling thread with nothing to do: a real-time thread
+// spinning would starve the lower priorities on the same core
+void RealtimeMode::idle() const {
+    if (enabled && idle_sleep_us > 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(idle_sleep_us));
+    }
+}
+
+// Counts the page faults of the calling thread since the previous call
+void RealtimeMode::check_faults(const std::string& threadname) {
+    if (!enabled) {
+        return;
+    }
+    long minor, major;
+    read_thread_faults(minor, major);
+    if (!thread_faults.initialised) {
+        thread_faults.initialised = true;
+    } else if (minor != thread_faults.minor || major != thread_faults.major) {
+        long new_minor = minor - thread_faults.minor;
+        long new_major = major - thread_faults.major;
+        minor_faults += new_minor;
+        major_faults += new_major;
+        faulting_intervals++;
+        // At most one warning per second per thread
+        int64_t now = BatchController::now_ns();
+        if (now - thread_faults.last_log_ns > 1000000000LL) {
+            thread_faults.last_log_ns = now;
+            logger->warning(fmt::format("Real-time mode: {} page faults while processing ({} minor, {} major)",
+                                        threadname, new_minor, new_major), globalname);
+        }
+    }
+    thread_faults.minor = minor;
+    thread_faults.major = major;
+}
+
+// Real-time mode state for monitoring
+json RealtimeMode::get_stats() const {
+    json stats;
+    stats["memory_locked"] = memory_locked.load();
+    stats["realtime_threads"] = realtime_threads.load();
+    stats["failed_threads"] = failed_threads.load();
+    stats["minor_faults"] = minor_faults.load();
+    stats["major_faults"] = major_faults.load();
+    stats["faulting_intervals"] = faulting_intervals.load();
+    return stats;
+}
@@ -0,0 +1,293 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <ctime>
+#include <random>
+#include <stdexcept>
+#include "ReliableChannel.h"
+#include "PerCoreMode.h"
+
+using json = nlohmann::json;
+
+// Constructor to initialize the sender and bind the ack socket
+ReliableSender::ReliableSender(zmq::context_t& context, const json& configuration, const std::string& fullname, WorkerLogger* logger, const std::string& globalname)
+    : globalname(globalname), logger(logger), socket_ack(nullptr),
+      sent_count(0), retransmitted_count(0), replay_errors(0), ack_count(0), unacked_count{0, 0}, spilled_count{0, 0}, dropped_count{0, 0} {
+    std::random_device rd;
+    epoch = (static_cast<uint64_t>(rd()) << 32) ^ rd() ^ static_cast<uint64_t>(time(nullptr));
+    if (epoch == 0) {
+        epoch = 1;
+    }
+    ack_timeout_ms = configuration.value("ack_timeout_ms", 1000);
+    size_t replay_buffer_bytes = configuration.value("replay_buffer_bytes", static_cast<size_t>(64 * 1024 * 1024));
+    std::string spill_path = configuration.value("spill_path", std::string("/tmp/"));
+    replay_batch = std::max<size_t>(1, configuration.value("replay_batch", static_cast<size_t>(1000)));
+    std::string overflow_policy = configuration.value("overflow_policy", std::string("block"));
+    if (overflow_policy != "block" && overflow_policy != "drop_oldest") {
+        throw std::invalid_argument("Config file: reliable overflow_policy must be block or drop_oldest");
+    }
+    ReplayBuffer::OverflowPolicy policy = overflow_policy == "block" ? ReplayBuffer::BLOCK : ReplayBuffer::DROP_OLDEST;
+
+    for (int channel = 0; channel < 2; channel++) {
+        std::string spill_filename = spill_path + "/" + fullname + (channel == 0 ? "-lp" : "-hp") + ".replay";
+        streams[channel].buffer = std::make_unique<ReplayBuffer>(replay_buffer_bytes / 2, spill_filename, policy);
+        streams[channel].last_progress = std::chrono::steady_clock::now();
+    }
+
+    std::string ack_socket = configuration.value("ack_socket", std::string("none"));
+    if (ack_socket == "none") {
+        throw std::invalid_argument("Config file: reliable ack_socket is required");
+    }
+    socket_ack = new zmq::socket_t(context, ZMQ_PULL);
+    socket_ack->bind(PerCoreMode::shard_endpoint(ack_socket));
+
+    logger->system("Reliable result channel: ack socket " + ack_socket + " replay buffer " + std::to_string(replay_buffer_bytes) + " bytes", globalname);
+}
+
+ReliableSender::~ReliableSender() {
+    delete socket_ack;
+}
+
+bool ReliableSender::send_frame(zmq::socket_t* socket, int channel, uint64_t seq, const std::string& payload) {
+    char header[64];
+    int size = snprintf(header, sizeof(header), "%" PRIu64 ":%" PRIu64 ":%" PRIu64, epoch, seq, streams[channel].acked);
+    if (!socket->send(zmq::buffer(header, size), zmq::send_flags::sndmore)) {
+        return false;
+    }
+    return socket->send(zmq::buffer(payload), zmq::send_flags::none).has_value();
+}
+
+// Sends a result on the given channel and keeps it until acknowledged
+bool ReliableSender::send(zmq::socket_t* socket, int channel, const std::string& payload) {
+    Stream& stream = streams[channel];
+    uint64_t seq = stream.next_seq++;
+    if (stream.buffer->size() == 0) {
+        stream.last_progress = std::chrono::steady_clock::now();
+    }
+    stream.buffer->append(seq, payload);
+    update_counts(channel);
+    sent_count++;
+    return send_frame(socket, channel, seq, payload);
+}
+
+// Handles a received ack
+void ReliableSender::process_ack(const std::string& ack) {
+    json msg = json::parse(ack);
+    int channel = msg.value("channel", 0);
+    if (channel != 0 && channel != 1) {
+        return;
+    }
+    Stream& stream = streams[channel];
+    uint64_t ack_epoch = msg.value("epoch", static_cast<uint64_t>(0));
+    uint64_t acked = msg.value("ack", static_cast<uint64_t>(0));
+    bool resume = msg.value("resume", false);
+    ack_count++;
+
+    if (ack_epoch == epoch && acked > stream.acked && acked < stream.next_seq) {
+        stream.acked = acked;
+        stream.buffer->trim(acked);
+        stream.last_progress = std::chrono::steady_clock::now();
+        update_counts(channel);
+    }
+    // A restarted receiver (or one talking to our previous instance) asks for everything unacknowledged
+    if (resume) {
+        stream.replay_pending = true;
+    }
+}
+
+// Updates the buffer counters of a channel for monitoring
+void ReliableSender::update_counts(int channel) {
+    const ReplayBuffer& buffer = *streams[channel].buffer;
+    unacked_count[channel] = buffer.size();
+    spilled_count[channel] = buffer.get_spilled_size();
+    dropped_count[channel] = buffer.get_dropped_total();
+}
+
+// Starts a go-back-N replay of the unacknowledged messages of a channel
+void ReliableSender::start_replay(int channel) {
+    Stream& stream = streams[channel];
+    stream.replay_pending = false;
+    stream.last_progress = std::chrono::steady_clock::now();
+    stream.replay_next = stream.buffer->size() > 0 ? stream.acked + 1 : 0;
+}
+
+// Re-sends the next replay_batch unacknowledged messages of a channel
+void ReliableSender::replay(zmq::socket_t* socket, int channel) {
+    Stream& stream = streams[channel];
+    if (!socket) {
+        stream.replay_next = 0;
+        return;
+    }
+    uint64_t from = std::max(stream.replay_next, stream.acked + 1);
+    uint64_t count = 0;
+    try {
+        stream.replay_next = stream.buffer->replay(from, replay_batch, [&](uint64_t seq, const std::string& payload) {
+            send_frame(socket, channel, seq, payload);
+            count++;
+        });
+    } catch (const std::exception& e) {
+        // The receiver delivers nothing past the missing message: retried at the next ack timeout
+        stream.replay_next = 0;
+        replay_errors++;
+        logger->error("Replay on channel " + std::to_string(channel) + " stopped: " + std::string(e.what()), globalname);
+    }
+    retransmitted_count += count;
+    logger->debug("Replayed " + std::to_string(count) + " messages on channel " + std::to_string(channel) + " from " + std::to_string(from), globalname);
+}
+
+// Processes the pending acks, replay requests and retransmission timeouts
+void ReliableSender::service(zmq::socket_t* socket_lp, zmq::socket_t* socket_hp) {
+    zmq::message_t msg;
+    while (socket_ack->recv(msg, zmq::recv_flags::dontwait)) {
+        try {
+            process_ack(msg.to_string());
+        } catch (const std::exception& e) {
+            logger->error("Invalid ack received: " + std::string(e.what()), globalname);
+        }
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    zmq::socket_t* sockets[2] = {socket_lp, socket_hp};
+    for (int channel = 0; channel < 2; channel++) {
+        Stream& stream = streams[channel];
+        bool timeout = stream.buffer->size() > 0 &&
+                       std::chrono::duration_cast<std::chrono::milliseconds>(now - stream.last_progress).count() > ack_timeout_ms;
+        if ((stream.replay_pending || timeout) && stream.replay_next == 0) {
+            start_replay(channel);
+        }
+        stream.replay_pending = false;  // A replay in progress covers the request
+        if (stream.replay_next != 0) {
+            replay(sockets[channel], channel);
+        }
+    }
+}
+
+// Constructor to initialize the receiver and connect the ack socket
+ReliableReceiver::ReliableReceiver(zmq::context_t& context, const json& configuration, int channel)
+    : channel(channel), socket_ack(nullptr), started(false), epoch(0), last(0), acked(0), next_token(0),
+      delivered_count(0), duplicate_count(0), gap_count(0) {
+    ack_batch = configuration.value("ack_batch", 100);
+    ack_interval_ms = configuration.value("ack_interval_ms", 50);
+    std::string ack_socket = configuration.value("ack_socket", std::string("none"));
+    if (ack_socket == "none") {
+        throw std::invalid_argument("Config file: reliable_input ack_socket is required");
+    }
+    socket_ack = new zmq::socket_t(context, ZMQ_PUSH);
+    socket_ack->connect(ack_socket);
+    last_ack_time = std::chrono::steady_clock::now();
+    last_resume_time = last_ack_time;
+
+    // Ask the sender for everything still unacknowledged (e.g. lost during our restart)
+    send_ack(true);
+}
+
+ReliableReceiver::~ReliableReceiver() {
+    delete socket_ack;
+}
+
+// Sends a cumulative ack (or a replay request) to the sender
+void ReliableReceiver::send_ack(bool resume) {
+    acked = processed();
+    json msg;
+    msg["channel"] = channel;
+    msg["epoch"] = epoch;
+    msg["ack"] = acked;
+    msg["resume"] = resume;
+    socket_ack->send(zmq::buffer(msg.dump()), zmq::send_flags::dontwait);
+    last_ack_time = std::chrono::steady_clock::now();
+    if (resume) {
+        last_resume_time = last_ack_time;
+    }
+}
+
+// Last sequence number processed, with all the ones before it
+uint64_t ReliableReceiver::processed() {
+    std::lock_guard<std::mutex> lock(pending_mutex);
+    return pending.empty() ? last : pending.begin()->second.seq - 1;
+}
+
+// Checks the header of a received message. Returns true if the payload must be delivered
+bool ReliableReceiver::accept(const zmq::message_t& header, uint64_t& token) {
+    token = 0;
+    uint64_t msg_epoch = 0, seq = 0, base = 0;
+    std::string header_str = header.to_string();
+    if (sscanf(header_str.c_str(), "%" SCNu64 ":%" SCNu64 ":%" SCNu64, &msg_epoch, &seq, &base) != 3) {
+        return true;  // not a sequenced message
+    }
+
+    // First message, or the sender restarted: continue from what it considers acknowledged
+    if (!started || msg_epoch != epoch) {
+        started = true;
+        epoch = msg_epoch;
+        last = base;
+        acked = base;
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        pending.clear();  // Sequence numbers of the previous sender: their completions are ignored
+    }
+
+    if (seq <= last) {
+        duplicate_count++;
+        return false;
+    }
+    if (seq != last + 1) {
+        // Go-back-N: drop and ask for a replay from the last message processed in order
+        gap_count++;
+        auto now = std::chrono::steady_clock::now();
+        if (std::chrono::duration_cast<std::chrono::milliseconds>(now - last_resume_time).count() >= ack_interval_ms) {
+            send_ack(true);
+        }
+        return false;
+    }
+
+    last = seq;
+    delivered_count++;
+    std::lock_guard<std::mutex> lock(pending_mutex);
+    token = ++next_token;
+    pending[token] = {seq, 1};  // Held by the listener until its buffers are tracked
+    return true;
+}
+
+// Attaches a buffer holding (part of) a delivered message
+void ReliableReceiver::track(uint64_t token, PooledBuffer& buffer) {
+    if (token == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(pending_mutex);
+    auto found = pending.find(token);
+    if (found != pending.end()) {
+        found->second.handles++;
+        buffer.set_tracker(this, token);
+    }
+}
+
+// Releases a hold on a delivered message (the listener hold or a buffer)
+void ReliableReceiver::complete(uint64_t token) {
+    if (token == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(pending_mutex);
+    auto found = pending.find(token);
+    if (found != pending.end() && --found->second.handles == 0) {
+        pending.erase(found);
+    }
+}
+
+// Sends the batched ack if enough messages were processed or time has passed
+void ReliableReceiver::flush() {
+    uint64_t done = processed();
+    if (done <= acked) {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (done - acked >= static_cast<uint64_t>(ack_batch) ||
+        std::chrono::duration_cast<std::chrono::milliseconds>(now - last_ack_time).count() >= ack_interval_ms) {
+        send_ack(false);
+    }
+}
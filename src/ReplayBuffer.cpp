@@ -0,0 +1,157 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include "ReplayBuffer.h"
+
+// Constructor to initialize the buffer with a memory budget and a spill file name
+ReplayBuffer::ReplayBuffer(size_t max_memory_bytes, const std::string& spill_filename, OverflowPolicy policy)
+    : max_memory_bytes(max_memory_bytes), spill_filename(spill_filename), policy(policy), memory_bytes(0),
+      spill_end(0), spilled_total(0), spill_failed(false), dropped_total(0) {
+}
+
+ReplayBuffer::~ReplayBuffer() {
+    clear();
+}
+
+// Appends a sent message
+void ReplayBuffer::append(uint64_t seq, const std::string& payload) {
+    memory.emplace_back(seq, payload);
+    memory_bytes += payload.size();
+    if (memory_bytes > max_memory_bytes) {
+        overflow();
+    }
+}
+
+// Moves the oldest in-memory messages to the spill file
+void ReplayBuffer::overflow() {
+    if (spill_failed) {
+        overflow_in_memory();
+        return;
+    }
+    if (!spill.is_open()) {
+        spill.open(spill_filename, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+        spill_end = 0;
+        if (!spill.is_open()) {
+            std::cerr << "ERROR: unable to open replay spill file " << spill_filename << std::endl;
+            spill_failed = true;
+            overflow_in_memory();
+            return;
+        }
+    }
+
+    // Keep the most recent message in memory, it is the most likely to be replayed soon
+    spill.seekp(spill_end);
+    while (memory_bytes > max_memory_bytes && memory.size() > 1) {
+        auto& [seq, payload] = memory.front();
+        uint32_t size = static_cast<uint32_t>(payload.size());
+        spill.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        spill.write(payload.data(), size);
+        if (!spill) {
+            std::cerr << "ERROR: unable to write replay spill file " << spill_filename << std::endl;
+            spill.clear();
+            spill_failed = true;
+            overflow_in_memory();
+            return;
+        }
+        spill_index.emplace_back(seq, spill_end);
+        spill_end += sizeof(size) + size;
+        spilled_total++;
+        memory_bytes -= payload.size();
+        memory.pop_front();
+    }
+    spill.flush();
+}
+
+// Applies the overflow policy when the spill file is not usable
+void ReplayBuffer::overflow_in_memory() {
+    if (policy == BLOCK) {
+        return;  // Kept: the sender holds back new messages while is_full()
+    }
+    while (memory_bytes > max_memory_bytes && memory.size() > 1) {
+        memory_bytes -= memory.front().second.size();
+        memory.pop_front();
+        dropped_total++;
+    }
+}
+
+bool ReplayBuffer::read_spilled(std::streamoff offset, std::string& payload) {
+    uint32_t size = 0;
+    spill.seekg(offset);
+    spill.read(reinterpret_cast<char*>(&size), sizeof(size));
+    payload.resize(size);
+    spill.read(&payload[0], size);
+    return static_cast<bool>(spill);
+}
+
+// Removes all the messages with sequence number <= acked
+void ReplayBuffer::trim(uint64_t acked) {
+    while (!spill_index.empty() && spill_index.front().first <= acked) {
+        spill_index.pop_front();
+    }
+    if (spill_index.empty() && spill.is_open()) {
+        // Everything on disk has been acknowledged: restart the spill file
+        spill.close();
+        std::remove(spill_filename.c_str());
+        spill_end = 0;
+    }
+    while (!memory.empty() && memory.front().first <= acked) {
+        memory_bytes -= memory.front().second.size();
+        memory.pop_front();
+    }
+    if (spill_failed && spill_index.empty() && memory.empty()) {
+        spill_failed = false;  // Try the spill file again at the next overflow
+    }
+}
+
+// Calls send for up to max_count buffered messages with sequence number >= from, in order.
+// Returns the sequence number to continue from, or 0 if all the messages were sent.
+// Throws std::runtime_error if a spilled message cannot be read
+uint64_t ReplayBuffer::replay(uint64_t from, size_t max_count, const std::function<void(uint64_t, const std::string&)>& send) {
+    size_t sent = 0;
+    auto spilled = std::lower_bound(spill_index.begin(), spill_index.end(), from,
+                                    [](const std::pair<uint64_t, std::streamoff>& entry, uint64_t seq) { return entry.first < seq; });
+    std::string payload;
+    for (; spilled != spill_index.end(); ++spilled) {
+        if (sent == max_count) {
+            return spilled->first;
+        }
+        if (!read_spilled(spilled->second, payload)) {
+            // Stop here: skipping the message would leave a gap in the replayed stream
+            spill.clear();
+            throw std::runtime_error("unable to read message " + std::to_string(spilled->first) + " from replay spill file " + spill_filename);
+        }
+        send(spilled->first, payload);
+        sent++;
+    }
+    auto it = std::lower_bound(memory.begin(), memory.end(), from,
+                               [](const std::pair<uint64_t, std::string>& entry, uint64_t seq) { return entry.first < seq; });
+    for (; it != memory.end(); ++it) {
+        if (sent == max_count) {
+            return it->first;
+        }
+        send(it->first, it->second);
+        sent++;
+    }
+    return 0;
+}
+
+// Removes all the messages
+void ReplayBuffer::clear() {
+    memory.clear();
+    memory_bytes = 0;
+    spill_index.clear();
+    spill_failed = false;
+    if (spill.is_open()) {
+        spill.close();
+        std::remove(spill_filename.c_str());
+    }
+    spill_end = 0;
+}
@@ -0,0 +1,188 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include "ResultCache.h"
+
+using json = nlohmann::json;
+
+namespace {
+
+const size_t ENTRY_OVERHEAD = 128;  // Index node, entry and json object
+
+inline uint64_t read64(const char* data) {
+    uint64_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+// 64x64 -> 128 bit multiply, folded
+inline uint64_t mix(uint64_t a, uint64_t b) {
+    __uint128_t product = static_cast<__uint128_t>(a) * b;
+    return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+}
+
+inline uint64_t finalize(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb3f99e3b10e5ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+}  // namespace
+
+// Constructor to initialize the cache from the "result_cache" section
+ResultCache::ResultCache(const json& configuration) : hits(0), misses(0), evictions(0) {
+    num_shards = std::max<size_t>(1, configuration.value("shards", static_cast<size_t>(16)));
+    size_t max_entries = std::max<size_t>(num_shards, configuration.value("max_entries", static_cast<size_t>(65536)));
+    size_t max_bytes = static_cast<size_t>(configuration.value("max_mb", 64.0) * 1024 * 1024);
+    entries_per_shard = max_entries / num_shards;
+    bytes_per_shard = std::max<size_t>(ENTRY_OVERHEAD, max_bytes / num_shards);
+    shards = std::make_unique<Shard[]>(num_shards);
+    for (size_t i = 0; i < num_shards; i++) {
+        shards[i].entries = std::make_unique<Entry[]>(entries_per_shard);
+        shards[i].index.reserve(entries_per_shard);
+    }
+}
+
+// 128-bit hash of a payload and its priority, 16 bytes per step
+ResultCache::Key ResultCache::key_of(std::string_view payload, int priority) {
+    const uint64_t k0 = 0x9e3779b97f4a7c15ULL;
+    const uint64_t k1 = 0xbf58476d1ce4e5b9ULL;
+    const uint64_t k2 = 0x94d049bb133111ebULL;
+    const char* data = payload.data();
+    size_t size = payload.size();
+    uint64_t a = k0 ^ size;
+    uint64_t b = k1 ^ static_cast<uint64_t>(priority);
+    while (size >= 16) {
+        // Two independent lanes
+        a = mix(read64(data) ^ a, k1) + k2;
+        b = mix(read64(data + 8) ^ b, k2) + k0;
+        data += 16;
+        size -= 16;
+    }
+    uint64_t tail[2] = {0, 0};
+    std::memcpy(tail, data, size);
+    a = mix(tail[0] ^ a, k1 ^ size);
+    b = mix(tail[1] ^ b, k2);
+    return Key{finalize(a ^ (b << 1)), finalize(b + a * k0)};
+}
+
+// Copies the cached result of a key. Returns false on a miss
+bool ResultCache::lookup(const Key& key, json& result) {
+    Shard& shard = shard_of(key);
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) {
+            Entry& entry = shard.entries[it->second];
+            if (!entry.referenced.load(std::memory_order_relaxed)) {
+                entry.referenced.store(true, std::memory_order_relaxed);
+            }
+            result = entry.result;
+            hits.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    misses.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+// Frees the entry under the CLOCK hand of a shard, giving referenced entries a second chance
+size_t ResultCache::evict(Shard& shard) {
+    while (true) {
+        size_t slot = shard.hand;
+        shard.hand = (shard.hand + 1) % shard.used;
+        Entry& entry = shard.entries[slot];
+        if (entry.bytes == 0) {
+            return slot;  // Already free
+        }
+        if (entry.referenced.load(std::memory_order_relaxed)) {
+            entry.referenced.store(false, std::memory_order_relaxed);
+            continue;
+        }
+        shard.index.erase(entry.key);
+        shard.bytes -= entry.bytes;
+        entry.bytes = 0;
+        entry.result = json();
+        evictions.fetch_add(1, std::memory_order_relaxed);
+        return slot;
+    }
+}
+
+// Caches the result of a key, evicting entries if the shard is full
+void ResultCache::insert(const Key& key, const json& result) {
+    size_t bytes = result.dump().size() + ENTRY_OVERHEAD;
+    if (bytes > bytes_per_shard || entries_per_shard == 0) {
+        return;  // Too large to be cached
+    }
+    Shard& shard = shard_of(key);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    if (shard.index.count(key)) {
+        return;  // Inserted by another worker meanwhile
+    }
+    // Make room for the bytes, then find a free entry
+    while (shard.bytes + bytes > bytes_per_shard) {
+        evict(shard);
+    }
+    size_t slot;
+    if (shard.used < entries_per_shard) {
+        slot = shard.used++;
+    } else {
+        slot = evict(shard);
+    }
+    Entry& entry = shard.entries[slot];
+    entry.key = key;
+    entry.result = result;
+    entry.bytes = bytes;
+    entry.referenced.store(false, std::memory_order_relaxed);
+    shard.bytes += bytes;
+    shard.index.emplace(key, slot);
+}
+
+// Removes all the entries (the results depend on the worker configuration)
+void ResultCache::clear() {
+    for (size_t i = 0; i < num_shards; i++) {
+        Shard& shard = shards[i];
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        for (size_t slot = 0; slot < shard.used; slot++) {
+            Entry& entry = shard.entries[slot];
+            entry.result = json();
+            entry.bytes = 0;
+            entry.referenced.store(false, std::memory_order_relaxed);
+        }
+        shard.index.clear();
+        shard.used = 0;
+        shard.hand = 0;
+        shard.bytes = 0;
+    }
+}
+
+// Cache statistics for monitoring
+json ResultCache::get_stats() const {
+    json stats;
+    size_t entries = 0;
+    size_t bytes = 0;
+    for (size_t i = 0; i < num_shards; i++) {
+        std::shared_lock<std::shared_mutex> lock(shards[i].mutex);
+        entries += shards[i].index.size();
+        bytes += shards[i].bytes;
+    }
+    uint64_t hit_count = hits.load();
+    uint64_t miss_count = misses.load();
+    stats["entries"] = entries;
+    stats["mb"] = bytes / (1024.0 * 1024.0);
+    stats["hits"] = hit_count;
+    stats["misses"] = miss_count;
+    stats["hit_rate"] = hit_count + miss_count > 0 ? static_cast<double>(hit_count) / (hit_count + miss_count) : 0.0;
+    stats["evictions"] = evictions.load();
+    return stats;
+}
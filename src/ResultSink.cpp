@@ -0,0 +1,145 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+#include <stdexcept>
+#include <spdlog/spdlog.h>
+#include "ResultSink.h"
+#include "PerCoreMode.h"
+
+using json = nlohmann::json;
+
+SocketSink::SocketSink(zmq::context_t& context, const std::string& type, const std::string& endpoint, const json& configuration)
+    : endpoint(endpoint), type(type), stop_event(false), sent_count(0), dropped_count(0) {
+    capacity = std::max(1, configuration.value("capacity", 10000));
+    batch_size = std::max(1, configuration.value("batch_size", 64));
+    std::string policy = configuration.value("drop_policy", std::string("drop_newest"));
+    if (policy == "drop_newest") {
+        drop_policy = DROP_NEWEST;
+    } else if (policy == "drop_oldest") {
+        drop_policy = DROP_OLDEST;
+    } else if (policy == "block") {
+        drop_policy = BLOCK;
+    } else {
+        throw std::invalid_argument("Config file: result sink drop_policy must be drop_newest, drop_oldest or block");
+    }
+
+    if (type == "pushpull") {
+        socket = zmq::socket_t(context, ZMQ_PUSH);
+        socket.connect(endpoint);
+    } else if (type == "pubsub") {
+        socket = zmq::socket_t(context, ZMQ_PUB);
+        socket.bind(PerCoreMode::shard_endpoint(endpoint));
+    } else {
+        throw std::invalid_argument("Config file: result sink type must be pushpull, pubsub or file");
+    }
+    // The socket is used only by the sink thread from now on
+    thread = std::thread(&SocketSink::run, this);
+}
+
+SocketSink::~SocketSink() {
+    stop();
+}
+
+// Queues a result for delivery. Returns false if it was dropped
+bool SocketSink::write(const std::string& payload, int /* priority */) {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (buffer.size() >= capacity) {
+            if (drop_policy == BLOCK) {
+                not_full.wait(lock, [this] { return buffer.size() < capacity || stop_event; });
+            } else if (drop_policy == DROP_OLDEST) {
+                buffer.pop_front();
+                dropped_count++;
+            } else {
+                dropped_count++;
+                return false;
+            }
+        }
+        buffer.push_back(payload);
+    }
+    not_empty.notify_one();
+    return true;
+}
+
+void SocketSink::run() {
+    std::vector<std::string> batch;
+    batch.reserve(batch_size);
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        not_empty.wait(lock, [this] { return !buffer.empty() || stop_event; });
+        if (buffer.empty()) {
+            break;  // Stopped and drained
+        }
+        while (!buffer.empty() && batch.size() < batch_size) {
+            batch.push_back(std::move(buffer.front()));
+            buffer.pop_front();
+        }
+        lock.unlock();
+        not_full.notify_all();
+
+        // Sent out of the lock: a slow receiver only delays this sink
+        for (const auto& payload : batch) {
+            try {
+                if (send(payload)) {
+                    sent_count++;
+                } else {
+                    dropped_count++;
+                }
+            } catch (const zmq::error_t& e) {
+                spdlog::error("Result sink {}: {}", endpoint, e.what());
+                dropped_count++;
+            }
+        }
+        batch.clear();
+        lock.lock();
+    }
+}
+
+// Sends a result without blocking on the socket. When the socket cannot take it
+// (high water mark reached) the drop policy applies: the result is dropped, or
+// with "block" the send is retried until it succeeds or the sink is stopped.
+// Returns false if the result was dropped
+bool SocketSink::send(const std::string& payload) {
+    while (true) {
+        if (socket.send(zmq::buffer(payload), zmq::send_flags::dontwait)) {
+            return true;
+        }
+        if (drop_policy != BLOCK || stop_event) {
+            return false;
+        }
+        zmq::pollitem_t item = {static_cast<void*>(socket), 0, ZMQ_POLLOUT, 0};
+        zmq::poll(&item, 1, std::chrono::milliseconds(100));
+    }
+}
+
+// Delivers the results still buffered and stops the sink
+void SocketSink::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop_event = true;
+    }
+    not_empty.notify_all();
+    not_full.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+        socket.close();
+    }
+}
+
+// Sink statistics for monitoring
+json SocketSink::get_stats() {
+    json stats;
+    stats["type"] = type;
+    stats["endpoint"] = endpoint;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats["buffered"] = buffer.size();
+    }
+    stats["sent"] = sent_count.load();
+    stats["dropped"] = dropped_count.load();
+    return stats;
+}
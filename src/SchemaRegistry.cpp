@@ -0,0 +1,315 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <spdlog/spdlog.h>
+#include "SchemaRegistry.h"
+#include "avro/Compiler.hh"
+#include "avro/Exception.hh"
+
+using json = nlohmann::json;
+
+namespace {
+
+const uint64_t FINGERPRINT_EMPTY = 0xc15d213aa4d7a795ULL;
+
+// Lookup table of the CRC-64-AVRO polynomial
+struct FingerprintTable {
+    uint64_t table[256];
+    FingerprintTable() {
+        for (int i = 0; i < 256; ++i) {
+            uint64_t fp = i;
+            for (int j = 0; j < 8; ++j) {
+                fp = (fp >> 1) ^ (FINGERPRINT_EMPTY & -(fp & 1));
+            }
+            table[i] = fp;
+        }
+    }
+};
+
+bool is_primitive(const std::string& type) {
+    return type == "null" || type == "boolean" || type == "int" || type == "long" || type == "float" ||
+           type == "double" || type == "bytes" || type == "string";
+}
+
+std::string full_name(const std::string& name, const std::string& space) {
+    return (name.find('.') != std::string::npos || space.empty()) ? name : space + "." + name;
+}
+
+std::string canonical(const json& schema, const std::string& space) {
+    if (schema.is_string()) {
+        std::string name = schema.get<std::string>();
+        return json(is_primitive(name) ? name : full_name(name, space)).dump();
+    }
+    if (schema.is_array()) {
+        std::string out = "[";
+        for (size_t i = 0; i < schema.size(); ++i) {
+            out += (i ? "," : "") + canonical(schema[i], space);
+        }
+        return out + "]";
+    }
+    const json& type = schema.at("type");
+    if (!type.is_string()) {
+        return canonical(type, space);
+    }
+    std::string type_name = type.get<std::string>();
+    if (is_primitive(type_name)) {
+        return json(type_name).dump();
+    }
+    if (type_name == "array") {
+        return "{\"type\":\"array\",\"items\":" + canonical(schema.at("items"), space) + "}";
+    }
+    if (type_name == "map") {
+        return "{\"type\":\"map\",\"values\":" + canonical(schema.at("values"), space) + "}";
+    }
+
+    // Named types: record, error, enum, fixed
+    std::string name = full_name(schema.at("name").get<std::string>(), schema.value("namespace", space));
+    size_t dot = name.rfind('.');
+    std::string inner_space = dot == std::string::npos ? "" : name.substr(0, dot);
+    std::string out = "{\"name\":" + json(name).dump() + ",\"type\":" + json(type_name).dump();
+    if (schema.contains("fields")) {
+        out += ",\"fields\":[";
+        bool first = true;
+        for (const auto& field : schema["fields"]) {
+            out += first ? "" : ",";
+            out += "{\"name\":" + json(field.at("name").get<std::string>()).dump() + ",\"type\":" + canonical(field.at("type"), inner_space) + "}";
+            first = false;
+        }
+        out += "]";
+    }
+    if (schema.contains("symbols")) {
+        out += ",\"symbols\":" + schema["symbols"].dump();
+    }
+    if (schema.contains("size")) {
+        out += ",\"size\":" + schema["size"].dump();
+    }
+    return out + "}";
+}
+
+std::string to_hex(uint64_t fingerprint) {
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(fingerprint));
+    return hex;
+}
+
+bool read_file(const std::string& filename, std::string& contents) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+}  // namespace
+
+SchemaRegistry::SchemaRegistry() : negative_ttl(1000), lookups(0), misses(0) {
+}
+
+// Returns the process-wide instance
+SchemaRegistry& SchemaRegistry::get_instance() {
+    // Never destroyed: workers may decode during static destruction
+    static SchemaRegistry* instance = new SchemaRegistry();
+    return *instance;
+}
+
+// Sets the directory from the "schema_registry" configuration section and loads its schemas
+void SchemaRegistry::configure(const json& configuration) {
+    std::string directory = configuration.value("path", std::string(""));
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        path = directory;
+        negative_ttl = std::chrono::milliseconds(std::max(0, configuration.value("negative_ttl_ms", 1000)));
+        unknown.clear();
+    }
+    if (directory.empty()) {
+        return;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    int loaded = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, ec)) {
+        if (entry.path().extension() != ".avsc") {
+            continue;
+        }
+        std::string contents;
+        try {
+            if (read_file(entry.path().string(), contents)) {
+                add(contents);
+                loaded++;
+            }
+        } catch (const std::exception& e) {
+            spdlog::error("Schema registry: invalid schema {}: {}", entry.path().string(), e.what());
+        }
+    }
+    spdlog::info("Schema registry: {} schemas loaded from {}", loaded, directory);
+}
+
+// Compiles and adds a schema. Returns its fingerprint
+uint64_t SchemaRegistry::add(const std::string& schema_json) {
+    auto schema = std::make_shared<const avro::ValidSchema>(avro::compileJsonSchemaFromString(schema_json));
+    uint64_t id = fingerprint(schema_json);
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    schemas.emplace(id, schema);
+    unknown.erase(id);
+    return id;
+}
+
+// Adds a schema and writes its file in the directory. Returns its fingerprint
+uint64_t SchemaRegistry::register_schema(const std::string& schema_json) {
+    uint64_t id = add(schema_json);
+    std::string directory;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        directory = path;
+    }
+    if (directory.empty()) {
+        return id;
+    }
+    std::string filename = directory + "/" + to_hex(id) + ".avsc";
+    if (std::filesystem::exists(filename)) {
+        return id;
+    }
+    // Write to a temporary file and rename it, so readers never load a truncated schema
+    std::string tmpname = filename + ".tmp";
+    {
+        std::ofstream file(tmpname, std::ios::binary | std::ios::trunc);
+        file << schema_json;
+        if (!file.good()) {
+            spdlog::error("Schema registry: unable to write {}", tmpname);
+            return id;
+        }
+    }
+    if (std::rename(tmpname.c_str(), filename.c_str()) != 0) {
+        spdlog::error("Schema registry: unable to rename {}", tmpname);
+    }
+    return id;
+}
+
+// Returns the writer schema of a fingerprint (nullptr if unknown)
+std::shared_ptr<const avro::ValidSchema> SchemaRegistry::lookup(uint64_t fingerprint) {
+    lookups++;
+    auto now = std::chrono::steady_clock::now();
+    std::string directory;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = schemas.find(fingerprint);
+        if (it != schemas.end()) {
+            return it->second;
+        }
+        auto negative = unknown.find(fingerprint);
+        if (negative != unknown.end() && now < negative->second) {
+            misses++;
+            return nullptr;  // Looked up recently: not read again before the expiry
+        }
+        directory = path;
+    }
+
+    // Not loaded yet: the producer may have added its schema file since startup
+    std::string contents;
+    if (!directory.empty() && read_file(directory + "/" + to_hex(fingerprint) + ".avsc", contents)) {
+        try {
+            if (add(contents) == fingerprint) {
+                std::shared_lock<std::shared_mutex> lock(mutex);
+                return schemas.at(fingerprint);
+            }
+            spdlog::error("Schema registry: {}.avsc does not match its fingerprint", to_hex(fingerprint));
+        } catch (const std::exception& e) {
+            spdlog::error("Schema registry: invalid schema {}.avsc: {}", to_hex(fingerprint), e.what());
+        }
+    }
+    misses++;
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    if (unknown.size() >= 4096) {
+        // Bounded against producers with many unknown writers: forget the expired entries
+        for (auto it = unknown.begin(); it != unknown.end();) {
+            it = now < it->second ? std::next(it) : unknown.erase(it);
+        }
+    }
+    unknown[fingerprint] = now + negative_ttl;
+    return nullptr;
+}
+
+// Parsing Canonical Form of a schema (Avro specification)
+std::string SchemaRegistry::canonical_form(const json& schema) {
+    return canonical(schema, "");
+}
+
+// CRC-64-AVRO fingerprint of the Parsing Canonical Form of a schema
+uint64_t SchemaRegistry::fingerprint(const std::string& schema_json) {
+    static const FingerprintTable table;
+    std::string form = canonical_form(json::parse(schema_json));
+    uint64_t fp = FINGERPRINT_EMPTY;
+    for (unsigned char byte : form) {
+        fp = (fp >> 8) ^ table.table[(fp ^ byte) & 0xff];
+    }
+    return fp;
+}
+
+// Reads the single-object encoding header. Returns false if the message has none
+bool SchemaRegistry::read_header(const uint8_t*& data, size_t& size, uint64_t& fingerprint) {
+    if (size < 10 || data[0] != 0xc3 || data[1] != 0x01) {
+        return false;
+    }
+    fingerprint = 0;
+    for (int i = 0; i < 8; ++i) {
+        fingerprint |= static_cast<uint64_t>(data[2 + i]) << (8 * i);
+    }
+    data += 10;
+    size -= 10;
+    return true;
+}
+
+// Registry statistics for monitoring
+json SchemaRegistry::get_stats() {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    json stats;
+    stats["schemas"] = schemas.size();
+    stats["lookups"] = lookups.load();
+    stats["misses"] = misses.load();
+    stats["unknown"] = unknown.size();
+    return stats;
+}
+
+SchemaResolverCache::SchemaResolverCache(const std::string& reader_schema_json)
+    : reader(avro::compileJsonSchemaFromString(reader_schema_json)),
+      reader_fingerprint(SchemaRegistry::get_instance().register_schema(reader_schema_json)),
+      binary(avro::binaryDecoder()) {
+}
+
+// Returns the decoder of a message, skipping its single-object header if any
+avro::Decoder* SchemaResolverCache::get_decoder(const uint8_t*& data, size_t& size, bool& resolving) {
+    uint64_t writer_fingerprint;
+    resolving = false;
+    if (!SchemaRegistry::read_header(data, size, writer_fingerprint) || writer_fingerprint == reader_fingerprint) {
+        return binary.get();
+    }
+    resolving = true;
+    auto it = resolvers.find(writer_fingerprint);
+    if (it == resolvers.end()) {
+        // First message of this writer: compile its resolver once
+        auto writer = SchemaRegistry::get_instance().lookup(writer_fingerprint);
+        if (!writer) {
+            return nullptr;  // Not cached: the schema file may still be added
+        }
+        avro::ResolvingDecoderPtr resolver;
+        try {
+            resolver = avro::resolvingDecoder(*writer, reader, avro::binaryDecoder());
+        } catch (const avro::Exception& e) {
+            spdlog::error("Schema registry: writer schema {:016x} cannot be resolved: {}", writer_fingerprint, e.what());
+        }
+        it = resolvers.emplace(writer_fingerprint, resolver).first;
+    }
+    return it->second.get();
+}
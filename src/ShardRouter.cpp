@@ -0,0 +1,117 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+#include <cctype>
+#include <cstring>
+#include <stdexcept>
+#include <spdlog/spdlog.h>
+#include "ShardRouter.h"
+
+// Constructor to initialize the router from the "sharding" configuration section
+ShardRouter::ShardRouter(const nlohmann::json& configuration)
+    : enabled(false), shard_id(0), num_shards(1), missing_key_to_first_shard(false), accepted_count(0), skipped_count(0), unkeyed_count(0) {
+    if (!configuration.is_object()) {
+        return;
+    }
+    num_shards = configuration.value("num_shards", 1);
+    shard_id = configuration.value("shard_id", 0);
+    key = configuration.value("key", std::string(""));
+    int virtual_nodes = configuration.value("virtual_nodes", 128);
+    std::string missing_key = configuration.value("missing_key", std::string("payload"));
+
+    if (num_shards < 1) {
+        throw std::invalid_argument("Config file: sharding num_shards must be >= 1");
+    }
+    if (shard_id < 0 || shard_id >= num_shards) {
+        throw std::invalid_argument("Config file: sharding shard_id must be in [0, num_shards)");
+    }
+    if (missing_key != "payload" && missing_key != "first_shard") {
+        throw std::invalid_argument("Config file: sharding missing_key must be payload or first_shard");
+    }
+    missing_key_to_first_shard = missing_key == "first_shard";
+
+    key_pattern = "\"" + key + "\"";
+    ring = ConsistentHashRing(num_shards, virtual_nodes);
+    enabled = num_shards > 1;
+}
+
+// Light scan for "key" : value, without building a JSON DOM for every message
+bool ShardRouter::extract_key(const char* data, size_t size, const char*& key_begin, size_t& key_size) const {
+    if (key.empty()) {
+        return false;
+    }
+    const char* end = data + size;
+    const char* pos = data;
+    while (pos < end) {
+        const void* found = memmem(pos, end - pos, key_pattern.data(), key_pattern.size());
+        if (!found) {
+            return false;
+        }
+        const char* p = static_cast<const char*>(found) + key_pattern.size();
+        while (p < end && isspace(static_cast<unsigned char>(*p))) p++;
+        if (p < end && *p == ':') {
+            p++;
+            while (p < end && isspace(static_cast<unsigned char>(*p))) p++;
+            if (p >= end) {
+                return false;
+            }
+            if (*p == '"') {
+                const char* q = ++p;
+                while (q < end && *q != '"') {
+                    q += (*q == '\\') ? 2 : 1;
+                }
+                if (q > end) {
+                    return false;
+                }
+                key_begin = p;
+                key_size = q - p;
+            } else {
+                const char* q = p;
+                while (q < end && *q != ',' && *q != '}' && *q != ']' && !isspace(static_cast<unsigned char>(*q))) q++;
+                key_begin = p;
+                key_size = q - p;
+            }
+            return true;
+        }
+        pos = static_cast<const char*>(found) + 1;  // the pattern was a value, keep searching
+    }
+    return false;
+}
+
+int ShardRouter::route(const char* data, size_t size) const {
+    const char* key_begin = nullptr;
+    size_t key_size = 0;
+    if (extract_key(data, size, key_begin, key_size)) {
+        return ring.get_shard(key_begin, key_size);
+    }
+    if (!key.empty()) {
+        if (unkeyed_count.fetch_add(1, std::memory_order_relaxed) == 0) {
+            spdlog::warn("Sharding: key '{}' not found in a message, routed by {}", key,
+                         missing_key_to_first_shard ? "first_shard" : "payload hash");
+        }
+        if (missing_key_to_first_shard) {
+            return 0;
+        }
+    }
+    return ring.get_shard(data, size);
+}
+
+bool ShardRouter::owns(const char* data, size_t size) {
+    if (!enabled) {
+        return true;
+    }
+    if (route(data, size) == shard_id) {
+        accepted_count++;
+        return true;
+    }
+    skipped_count++;
+    return false;
+}
+
+bool ShardRouter::owns(const std::string& data) {
+    return owns(data.data(), data.size());
+}
@@ -0,0 +1,169 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+#include <algorithm>
+#include <limits>
+#include "SharedExecutor.h"
+#include "WorkerManager.h"
+#include "WorkerThread.h"
+#include "RealtimeMode.h"
+#include "BatchController.h"
+
+using json = nlohmann::json;
+
+// Constructor to initialize the executor from the "shared_executor" section
+SharedExecutor::SharedExecutor(const json& configuration, RealtimeMode* realtime, WorkerLogger* logger, const std::string& globalname)
+    : realtime(realtime), logger(logger), globalname(globalname), system_vtime(0), _stop_event(false) {
+    num_workers = std::max(1, configuration.value("num_workers", 1));
+    reserved.assign(num_workers, -1);
+}
+
+SharedExecutor::~SharedExecutor() {
+    stop();
+}
+
+// Adds a manager to the managers served (before start)
+void SharedExecutor::add_manager(WorkerManager* manager) {
+    const json& manager_config = manager->getManagerConfig();
+    json configuration = manager_config.contains("executor") ? manager_config["executor"] : json::object();
+    auto member = std::make_unique<Member>();
+    member->manager = manager;
+    member->low_priority_queue = manager->getLowPriorityQueue();
+    member->high_priority_queue = manager->getHighPriorityQueue();
+    member->weight = configuration.value("weight", 1.0);
+    if (member->weight <= 0) {
+        throw std::invalid_argument("Config file: executor weight of " + manager->getName() + " must be positive");
+    }
+    member->min_workers = std::max(0, configuration.value("min_workers", 0));
+    for (int i = 0; i < num_workers; i++) {
+        member->threads.push_back(manager->create_shared_worker_thread());
+    }
+    members.push_back(std::move(member));
+}
+
+void SharedExecutor::start() {
+    // Reserve the first executor threads to the managers in turn
+    int next = 0;
+    for (size_t m = 0; m < members.size(); m++) {
+        for (int i = 0; i < members[m]->min_workers; i++) {
+            if (next == num_workers) {
+                logger->warning(fmt::format("WARNING! Not enough shared executor threads to reserve {} to {}",
+                                            members[m]->min_workers, members[m]->manager->getName()), globalname);
+                break;
+            }
+            reserved[next++] = static_cast<int>(m);
+        }
+    }
+    for (int i = 0; i < num_workers; i++) {
+        threads.emplace_back(&SharedExecutor::run, this, i);
+    }
+    logger->system(fmt::format("Shared executor started: {} threads, {} managers", num_workers, members.size()), globalname);
+}
+
+void SharedExecutor::stop() {
+    _stop_event = true;
+    for (auto& thread : threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    threads.clear();
+}
+
+// Main loop of an executor thread
+void SharedExecutor::run(int index) {
+    std::string threadname = globalname + "-executor-" + std::to_string(index);
+    realtime->enter_thread("worker", threadname);
+    while (!_stop_event) {
+        int m = pick(index);
+        if (m < 0) {
+            realtime->idle();
+            continue;
+        }
+        Member& member = *members[m];
+        int64_t begin_ns = BatchController::now_ns();
+        bool processed = false;
+        try {
+            processed = member.threads[index]->step();
+        } catch (const std::exception& e) {
+            spdlog::error("Exception caught in shared executor: {}", e.what());
+        }
+        if (processed) {
+            int64_t cost_ns = BatchController::now_ns() - begin_ns;
+            charge(member, cost_ns);
+            member.steps.fetch_add(1, std::memory_order_relaxed);
+            member.busy_ns.fetch_add(cost_ns, std::memory_order_relaxed);
+            realtime->check_faults(threadname);
+        }
+    }
+}
+
+bool SharedExecutor::has_backlog(const Member& member, int index) const {
+    return member.threads[index]->is_processing()
+        && (!member.high_priority_queue->empty() || !member.low_priority_queue->empty());
+}
+
+// Member to serve by an executor thread (-1 if no manager has a backlog)
+int SharedExecutor::pick(int index) const {
+    int reserved_member = reserved[index];
+    if (reserved_member >= 0 && has_backlog(*members[reserved_member], index)) {
+        return reserved_member;
+    }
+    int64_t system = system_vtime.load(std::memory_order_relaxed);
+    int best = -1;
+    int64_t best_start = std::numeric_limits<int64_t>::max();
+    for (size_t m = 0; m < members.size(); m++) {
+        if (!has_backlog(*members[m], index)) {
+            continue;
+        }
+        int64_t start = std::max(members[m]->vtime.load(std::memory_order_relaxed), system);
+        if (start < best_start) {
+            best_start = start;
+            best = static_cast<int>(m);
+        }
+    }
+    return best;
+}
+
+// Charges the processing time of a step to the virtual time of a member
+void SharedExecutor::charge(Member& member, int64_t cost_ns) {
+    int64_t weighted_ns = static_cast<int64_t>(cost_ns / member.weight);
+    int64_t system = system_vtime.load(std::memory_order_relaxed);
+    int64_t vtime = member.vtime.load(std::memory_order_relaxed);
+    int64_t start;
+    do {
+        start = std::max(vtime, system);  // No credit for the time the manager was idle
+    } while (!member.vtime.compare_exchange_weak(vtime, start + weighted_ns, std::memory_order_relaxed));
+    while (start > system && !system_vtime.compare_exchange_weak(system, start, std::memory_order_relaxed)) {
+    }
+}
+
+// Share of the executor of a manager, for its monitoring (null if not served)
+json SharedExecutor::get_stats(const WorkerManager* manager) const {
+    json stats;
+    int64_t total_busy_ns = 0;
+    double total_weight = 0;
+    for (const auto& member : members) {
+        total_busy_ns += member->busy_ns.load();
+        total_weight += member->weight;
+    }
+    for (size_t m = 0; m < members.size(); m++) {
+        const Member& member = *members[m];
+        if (member.manager != manager) {
+            continue;
+        }
+        int64_t busy_ns = member.busy_ns.load();
+        stats["num_workers"] = num_workers;
+        stats["weight"] = member.weight;
+        stats["reserved_workers"] = std::count(reserved.begin(), reserved.end(), static_cast<int>(m));
+        stats["steps"] = member.steps.load();
+        stats["busy_ms"] = busy_ns / 1e6;
+        stats["share"] = total_busy_ns > 0 ? static_cast<double>(busy_ns) / total_busy_ns : 0.0;
+        stats["fair_share"] = member.weight / total_weight;
+    }
+    return stats;
+}
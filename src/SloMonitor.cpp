@@ -0,0 +1,269 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "SloMonitor.h"
+#include "WorkerManager.h"
+
+using json = nlohmann::json;
+
+LatencyHistogram::LatencyHistogram() {
+    for (auto& bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+// Records a latency
+void LatencyHistogram::record(int64_t latency_ns) {
+    buckets[bucket_of(latency_ns)].fetch_add(1, std::memory_order_relaxed);
+}
+
+// Copies the cumulative counts of the buckets
+void LatencyHistogram::snapshot(std::vector<uint64_t>& counts) const {
+    counts.resize(NUM_BUCKETS);
+    for (int i = 0; i < NUM_BUCKETS; i++) {
+        counts[i] = buckets[i].load(std::memory_order_relaxed);
+    }
+}
+
+// Bucket of a latency
+int LatencyHistogram::bucket_of(int64_t latency_ns) {
+    if (latency_ns < SUB_BUCKETS) {
+        return latency_ns < 0 ? 0 : static_cast<int>(latency_ns);
+    }
+    int exponent = 63 - __builtin_clzll(static_cast<uint64_t>(latency_ns));  // >= 3
+    int sub = static_cast<int>(latency_ns >> (exponent - 3)) & (SUB_BUCKETS - 1);
+    return std::min((exponent - 2) * SUB_BUCKETS + sub, NUM_BUCKETS - 1);
+}
+
+// Upper bound of the latencies of a bucket
+int64_t LatencyHistogram::bucket_upper_ns(int bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    int exponent = bucket / SUB_BUCKETS + 2;
+    int sub = bucket % SUB_BUCKETS;
+    return ((static_cast<int64_t>(SUB_BUCKETS + sub + 1)) << (exponent - 3)) - 1;
+}
+
+// Latency of a percentile (0-100) of counts, as the upper bound of its bucket (0 if empty)
+int64_t LatencyHistogram::percentile_ns(const std::vector<uint64_t>& counts, double percentile) {
+    uint64_t total = 0;
+    for (uint64_t count : counts) {
+        total += count;
+    }
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percentile / 100.0 * total)));
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < counts.size(); i++) {
+        cumulative += counts[i];
+        if (cumulative >= rank) {
+            return bucket_upper_ns(static_cast<int>(i));
+        }
+    }
+    return bucket_upper_ns(NUM_BUCKETS - 1);
+}
+
+// Constructor to initialize the monitor from the "slo" configuration section
+SloMonitor::SloMonitor(const json& configuration, WorkerManager* manager, WorkerLogger* logger, const std::string& fullname, const std::string& globalname)
+    : manager(manager), logger(logger), fullname(fullname), globalname(globalname),
+      ring_head(0), ring_filled(0), alarms(0), timer(0) {
+    interval_ms = std::max(10, configuration.value("interval_ms", 1000));
+    double interval_s = interval_ms / 1000.0;
+
+    json windows = configuration.value("windows", json::parse(R"([
+        {"long_s": 3600, "short_s": 300, "burn_rate": 14.4, "level": 2},
+        {"long_s": 21600, "short_s": 1800, "burn_rate": 6, "level": 1}])"));
+    for (const auto& window : windows) {
+        Rule rule;
+        rule.long_window = add_window(std::max(1, static_cast<int>(std::lround(window.value("long_s", 3600.0) / interval_s))));
+        rule.short_window = add_window(std::max(1, static_cast<int>(std::lround(window.value("short_s", 300.0) / interval_s))));
+        rule.burn_rate = window.value("burn_rate", 14.4);
+        rule.level = window.value("level", 2);
+        rules.push_back(rule);
+    }
+    int ring_size = window_intervals.empty() ? 1 : *std::max_element(window_intervals.begin(), window_intervals.end());
+
+    for (const auto& item : configuration.value("objectives", json::array())) {
+        Objective objective;
+        std::string priority = item.value("priority", std::string("hp"));
+        if (priority != "hp" && priority != "lp") {
+            throw std::invalid_argument("Config file: slo objective priority must be hp or lp");
+        }
+        objective.priority = priority == "hp" ? 1 : 0;
+        objective.percentile = item.value("percentile", 99.0);
+        if (objective.percentile <= 0 || objective.percentile >= 100) {
+            throw std::invalid_argument("Config file: slo objective percentile must be between 0 and 100");
+        }
+        double threshold_ms = item.value("threshold_ms", 5.0);
+        objective.threshold_ns = static_cast<int64_t>(threshold_ms * 1e6);
+        objective.threshold_bucket = LatencyHistogram::bucket_of(objective.threshold_ns);
+        objective.budget = 1.0 - objective.percentile / 100.0;
+        objective.name = fmt::format("{} p{} < {} ms", priority, objective.percentile, threshold_ms);
+        objective.ring.resize(ring_size);
+        for (int intervals : window_intervals) {
+            Window window;
+            window.intervals = intervals;
+            objective.windows.push_back(window);
+        }
+        objective.firing.resize(rules.size(), false);
+        objective.burn_rates.resize(window_intervals.size(), 0.0);
+        objectives.push_back(objective);
+        logger->system("SLO " + objective.name, globalname);
+    }
+
+    for (int i = 0; i < 2; i++) {
+        last_counts[i].assign(LatencyHistogram::NUM_BUCKETS, 0);
+        current_p50_ns[i] = current_p99_ns[i] = current_p999_ns[i] = 0;
+    }
+}
+
+SloMonitor::~SloMonitor() {
+    stop();
+}
+
+// Index of a window length in window_intervals, adding it if needed
+int SloMonitor::add_window(int intervals) {
+    auto it = std::find(window_intervals.begin(), window_intervals.end(), intervals);
+    if (it != window_intervals.end()) {
+        return static_cast<int>(it - window_intervals.begin());
+    }
+    window_intervals.push_back(intervals);
+    return static_cast<int>(window_intervals.size()) - 1;
+}
+
+// Fraction of slow messages of a window divided by the budget
+double SloMonitor::burn_rate(const Window& window, double budget) {
+    if (window.total == 0) {
+        return 0.0;
+    }
+    return static_cast<double>(window.bad) / static_cast<double>(window.total) / budget;
+}
+
+// Closes an interval: updates the burn rates and fires or clears the alarms
+void SloMonitor::check() {
+    std::vector<std::pair<int, std::string>> to_send;  // Alarms are sent out of the lock
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t ring_size = objectives.empty() ? 1 : objectives.front().ring.size();
+
+        for (int priority = 0; priority < 2; priority++) {
+            histograms[priority].snapshot(counts);
+
+            // Current percentiles, from the messages of the last interval
+            std::vector<uint64_t>& last = last_counts[priority];
+            for (int i = 0; i < LatencyHistogram::NUM_BUCKETS; i++) {
+                std::swap(counts[i], last[i]);
+                counts[i] = last[i] - counts[i];
+            }
+            current_p50_ns[priority] = LatencyHistogram::percentile_ns(counts, 50.0);
+            current_p99_ns[priority] = LatencyHistogram::percentile_ns(counts, 99.0);
+            current_p999_ns[priority] = LatencyHistogram::percentile_ns(counts, 99.9);
+
+            for (auto& objective : objectives) {
+                if (objective.priority != priority) {
+                    continue;
+                }
+                uint64_t total = 0;
+                uint64_t bad = 0;
+                for (int i = 0; i < LatencyHistogram::NUM_BUCKETS; i++) {
+                    total += last[i];
+                    if (i > objective.threshold_bucket) {
+                        bad += last[i];
+                    }
+                }
+                Interval interval{total - objective.last_total, bad - objective.last_bad};
+                objective.last_total = total;
+                objective.last_bad = bad;
+
+                // Slide the windows: the interval leaving a window is ring_head - its length
+                for (auto& window : objective.windows) {
+                    if (ring_filled >= static_cast<size_t>(window.intervals)) {
+                        const Interval& leaving = objective.ring[(ring_head + ring_size - window.intervals) % ring_size];
+                        window.total -= leaving.total;
+                        window.bad -= leaving.bad;
+                    }
+                    window.total += interval.total;
+                    window.bad += interval.bad;
+                }
+                objective.ring[ring_head] = interval;
+
+                for (size_t w = 0; w < objective.windows.size(); w++) {
+                    objective.burn_rates[w] = burn_rate(objective.windows[w], objective.budget);
+                }
+                for (size_t r = 0; r < rules.size(); r++) {
+                    const Rule& rule = rules[r];
+                    double long_rate = objective.burn_rates[rule.long_window];
+                    double short_rate = objective.burn_rates[rule.short_window];
+                    bool burning = long_rate > rule.burn_rate && short_rate > rule.burn_rate;
+                    if (burning && !objective.firing[r]) {
+                        objective.firing[r] = true;
+                        alarms++;
+                        to_send.emplace_back(rule.level, fmt::format(
+                            "SLO {} of stage {} burning: burn rate {:.1f} over {} s and {:.1f} over {} s (threshold {})",
+                            objective.name, fullname, long_rate, window_intervals[rule.long_window] * interval_ms / 1000,
+                            short_rate, window_intervals[rule.short_window] * interval_ms / 1000, rule.burn_rate));
+                    } else if (!burning && objective.firing[r]) {
+                        objective.firing[r] = false;
+                        to_send.emplace_back(-1, fmt::format("SLO {} of stage {} recovered: burn rate {:.1f} over {} s",
+                            objective.name, fullname, short_rate, window_intervals[rule.short_window] * interval_ms / 1000));
+                    }
+                }
+            }
+        }
+        ring_head = (ring_head + 1) % ring_size;
+        ring_filled++;
+    }
+
+    for (const auto& alarm : to_send) {
+        if (alarm.first >= 0) {
+            logger->warning(alarm.second, globalname);
+            manager->getSupervisor()->send_alarm(alarm.first, alarm.second, fullname, ALARM_CODE_SLO_BURN, alarm.first >= 2 ? "High" : "Low");
+        } else {
+            logger->system(alarm.second, globalname);
+            manager->getSupervisor()->send_alarm(1, alarm.second, fullname, ALARM_CODE_SLO_RECOVERED, "Low");
+        }
+    }
+}
+
+// Starts and stops the periodic checks on the timer service
+void SloMonitor::start() {
+    stop();
+    timer = TimerService::get_instance().schedule_periodic(static_cast<int64_t>(interval_ms) * 1000000, [this]() { check(); });
+}
+
+void SloMonitor::stop() {
+    TimerService::get_instance().cancel(timer);
+    timer = 0;
+}
+
+// Objectives, burn rates and current percentiles for monitoring
+json SloMonitor::get_stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    json stats;
+    const char* names[2] = {"lp", "hp"};
+    for (int i = 0; i < 2; i++) {
+        stats["latency_ms"][names[i]]["p50"] = current_p50_ns[i] / 1e6;
+        stats["latency_ms"][names[i]]["p99"] = current_p99_ns[i] / 1e6;
+        stats["latency_ms"][names[i]]["p999"] = current_p999_ns[i] / 1e6;
+    }
+    for (const auto& objective : objectives) {
+        json item;
+        item["objective"] = objective.name;
+        for (size_t w = 0; w < objective.windows.size(); w++) {
+            item["burn_rates"][std::to_string(window_intervals[w] * interval_ms / 1000) + "s"] = objective.burn_rates[w];
+        }
+        item["firing"] = std::find(objective.firing.begin(), objective.firing.end(), true) != objective.firing.end();
+        stats["objectives"].push_back(item);
+    }
+    stats["alarms"] = alarms.load();
+    return stats;
+}
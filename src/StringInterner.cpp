@@ -0,0 +1,86 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+#include <mutex>
+#include <stdexcept>
+#include "StringInterner.h"
+#include "ConsistentHashRing.h"
+
+StringInterner::StringInterner() : count(0) {
+    for (auto& chunk : chunks) {
+        chunk.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+StringInterner::~StringInterner() {
+    for (auto& chunk : chunks) {
+        delete[] chunk.load();
+    }
+}
+
+// Returns the process-wide interner
+StringInterner& StringInterner::instance() {
+    static StringInterner interner;
+    return interner;
+}
+
+// Looks up a string with the given hash. Requires the lock
+uint32_t StringInterner::lookup(std::string_view str, uint64_t hash) const {
+    auto it = index.find(hash);
+    if (it == index.end()) {
+        return NONE;
+    }
+    for (uint32_t id = it->second; id != NONE; id = entry(id).next) {
+        if (entry(id).str == str) {
+            return id;
+        }
+    }
+    return NONE;
+}
+
+bool StringInterner::find(std::string_view str, uint32_t& id) const {
+    uint64_t hash = ConsistentHashRing::hash(str.data(), str.size());
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    id = lookup(str, hash);
+    return id != NONE;
+}
+
+// Returns the id of a string, adding it if needed
+uint32_t StringInterner::intern(std::string_view str) {
+    uint64_t hash = ConsistentHashRing::hash(str.data(), str.size());
+    {
+        // Fast path: the identifiers are a small set, almost every call is a hit
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        uint32_t id = lookup(str, hash);
+        if (id != NONE) {
+            return id;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    uint32_t id = lookup(str, hash);
+    if (id != NONE) {
+        return id;
+    }
+
+    id = count.load(std::memory_order_relaxed);
+    uint32_t chunk = id >> CHUNK_BITS;
+    if (chunk >= MAX_CHUNKS) {
+        throw std::length_error("StringInterner: too many strings");
+    }
+    if (chunks[chunk].load(std::memory_order_relaxed) == nullptr) {
+        chunks[chunk].store(new Entry[CHUNK_SIZE], std::memory_order_release);
+    }
+
+    Entry& e = entry(id);
+    e.str.assign(str.data(), str.size());
+    auto it = index.find(hash);
+    e.next = it == index.end() ? NONE : it->second;
+    index[hash] = id;
+    count.store(id + 1, std::memory_order_release);
+    return id;
+}
@@ -6,21 +6,38 @@
 //    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
 //
 
+#include <cstring>
 #include "Supervisor.h"
 
 Supervisor* Supervisor::instance = nullptr;
 
 Supervisor::Supervisor(std::string config_file, std::string name)
-    : name(name), continueall(true), config_manager(nullptr), manager_num_workers(0) {
+    : name(name), continueall(true), config_manager(nullptr), manager_num_workers(0), shard_router(nullptr),
+      reliable_lp_receiver(nullptr), reliable_hp_receiver(nullptr), realtime(nullptr), pipeline(nullptr),
+      shared_executor(nullptr), cross_shard(nullptr) {
     Supervisor::set_instance(this);  // Set the current instance
     load_configuration(config_file, name);
-    fullname = name;
-    globalname = "Supervisor-" + name;
+    fullname = PerCoreMode::shard_name(name);  // name, or "<name>-core<i>" in per-core mode
+    globalname = "Supervisor-" + fullname;
 
     // Set up logging
     std::string log_file = config["logs_path"].get<std::string>() + "/" + globalname + ".log";
     logger = new WorkerLogger("worker_logger", log_file, spdlog::level::debug);
 
+    // Set up huge pages before the queues and buffer pools are allocated
+    HugePages::configure(config.contains("huge_pages") ? config["huge_pages"] : json());
+
+    // Start the shared timer service from this (non real-time) thread
+    TimerService::get_instance().configure(config.contains("timer_service") ? config["timer_service"] : json());
+    TimerService::get_instance().start();
+
+    // Load the Avro writer schemas before the workers register their reader schemas
+    SchemaRegistry::get_instance().configure(config.contains("schema_registry") ? config["schema_registry"] : json());
+
+    // Set up the real-time mode before the other threads and buffers are created
+    realtime = new RealtimeMode(config.contains("realtime") ? config["realtime"] : json(), logger, globalname);
+    realtime->lock_memory();
+
     pid = getpid();
     context = zmq::context_t(1);
 
@@ -38,10 +55,10 @@ Supervisor::Supervisor(std::string config_file, std::string name)
         // Set up data sockets based on configuration
         if (datasockettype == "pushpull") {
             socket_lp_data = new zmq::socket_t(context, ZMQ_PULL);
-            socket_lp_data->bind(config["data_lp_socket"].get<std::string>());
+            socket_lp_data->bind(PerCoreMode::shard_endpoint(config["data_lp_socket"].get<std::string>()));
 
             socket_hp_data = new zmq::socket_t(context, ZMQ_PULL);
-            socket_hp_data->bind(config["data_hp_socket"].get<std::string>());
+            socket_hp_data->bind(PerCoreMode::shard_endpoint(config["data_hp_socket"].get<std::string>()));
         } else if (datasockettype == "pubsub") {
             socket_lp_data = new zmq::socket_t(context, ZMQ_SUB);
             socket_lp_data->connect(config["data_lp_socket"].get<std::string>());
@@ -56,6 +73,65 @@ Supervisor::Supervisor(std::string config_file, std::string name)
             throw std::invalid_argument("Config file: datasockettype must be pushpull or pubsub");
         }
 
+        // Set up sharding of the input stream across multiple instances
+        json sharding = config.contains("sharding") ? config["sharding"] : json();
+        if (PerCoreMode::is_enabled() && datasockettype != "pushpull") {
+            // Each core is a shard of the process (or of its shard of a multi-instance pipeline)
+            json core_sharding = sharding.is_object() ? sharding : json::object();
+            int num_cores = PerCoreMode::get_num_cores();
+            core_sharding["num_shards"] = core_sharding.value("num_shards", 1) * num_cores;
+            core_sharding["shard_id"] = core_sharding.value("shard_id", 0) * num_cores + PerCoreMode::get_core_id();
+            core_sharding["key"] = config["per_core"].value("key", core_sharding.value("key", std::string("")));
+            sharding = core_sharding;
+        }
+        shard_router = new ShardRouter(sharding);
+        if (shard_router->is_enabled()) {
+            if (datasockettype == "pushpull") {
+                throw std::invalid_argument("Config file: sharding requires pubsub or custom data sockets");
+            }
+            std::cout << "Sharding: shard " << shard_router->get_shard_id() << " of " << shard_router->get_num_shards()
+                      << " key '" << shard_router->get_key() << "'" << std::endl;
+            logger->system("Sharding: shard " + std::to_string(shard_router->get_shard_id()) + " of "
+                           + std::to_string(shard_router->get_num_shards()) + " key '" + shard_router->get_key() + "'", globalname);
+            if (dataflowtype != "string" && !shard_router->get_key().empty()) {
+                // Binary Avro payloads and filenames carry no JSON key: every message would take the missing_key fallback
+                throw std::invalid_argument("Config file: a sharding key requires dataflow_type string (use an empty key to hash the whole message)");
+            }
+        }
+
+        // Set up the DAG of managers connected in memory
+        pipeline = new Pipeline(config.contains("manager") ? config["manager"] : json());
+        if (pipeline->is_enabled()) {
+            std::cout << "Pipeline: " << pipeline->describe() << std::endl;
+            logger->system("Pipeline: " + pipeline->describe(), globalname);
+        }
+
+        // Set up the worker threads shared by the managers
+        if (config.contains("shared_executor") && processingtype == "thread") {
+            shared_executor = new SharedExecutor(config["shared_executor"], realtime, logger, globalname);
+            std::cout << "Shared executor: " << shared_executor->get_num_workers() << " threads" << std::endl;
+            logger->system("Shared executor: " + std::to_string(shared_executor->get_num_workers()) + " threads", globalname);
+        }
+
+        // Set up at-least-once delivery on the data sockets
+        if (PerCoreMode::is_enabled()) {
+            // Sequence numbers, acks and replays are per stream: they cannot follow traffic split across shards
+            bool reliable_output = false;
+            for (const auto &manager_config : config.value("manager", json::array())) {
+                reliable_output = reliable_output || manager_config.contains("reliable");
+            }
+            if (config.contains("reliable_input") || reliable_output) {
+                throw std::invalid_argument("Config file: reliable_input and manager reliable are not supported with per_core");
+            }
+        }
+        if (config.contains("reliable_input") && datasockettype != "custom") {
+            reliable_lp_receiver = new ReliableReceiver(context, config["reliable_input"], 0);
+            reliable_hp_receiver = new ReliableReceiver(context, config["reliable_input"], 1);
+            socket_lp_data->set(zmq::sockopt::rcvtimeo, reliable_lp_receiver->get_receive_timeout());
+            socket_hp_data->set(zmq::sockopt::rcvtimeo, reliable_hp_receiver->get_receive_timeout());
+            logger->system("Reliable data channels: ack socket " + config["reliable_input"].value("ack_socket", std::string("none")), globalname);
+        }
+
         // Set up command and monitoring sockets
         socket_command = new zmq::socket_t(context, ZMQ_SUB);
         socket_command->connect(config["command_socket"].get<std::string>());
@@ -64,8 +140,16 @@ Supervisor::Supervisor(std::string config_file, std::string name)
         socket_monitoring = new zmq::socket_t(context, ZMQ_PUSH);
         socket_monitoring->connect(config["monitoring_socket"].get<std::string>());
 
+        // Set up the channel between the shards of the per-core mode
+        if (PerCoreMode::is_enabled()) {
+            cross_shard = new CrossShardChannel(context, config["per_core"].value("channel", "ipc:///tmp/rtadp-" + name), logger, globalname);
+            cross_shard->set_handler([this](int from_core, const std::string &message) { on_shard_message(from_core, message); });
+        }
+
         socket_lp_result.resize(100, nullptr);
         socket_hp_result.resize(100, nullptr);
+        sink_lp_result.resize(100);
+        sink_hp_result.resize(100);
     } catch (const std::exception &e) {
         // Handle any other unexpected exceptions
         std::cerr << "ERROR: An unexpected error occurred: " << e.what() << std::endl;
@@ -99,6 +183,13 @@ Supervisor::~Supervisor() {
     delete socket_hp_data;
     delete socket_command;
     delete socket_monitoring;
+    delete shard_router;
+    delete reliable_lp_receiver;
+    delete reliable_hp_receiver;
+    delete shared_executor;
+    delete cross_shard;
+    delete realtime;
+    delete pipeline;
     delete logger;
 }
 
@@ -150,6 +241,10 @@ void Supervisor::start_service_threads() {
     }
 
     result_thread = std::thread(&Supervisor::listen_for_result, this);
+
+    if (cross_shard) {
+        cross_shard->start();
+    }
 }
 
 
@@ -157,6 +252,35 @@ void Supervisor::start_service_threads() {
 void Supervisor::setup_result_channel(WorkerManager *manager, int indexmanager) {
     socket_lp_result[indexmanager] = nullptr;
     socket_hp_result[indexmanager] = nullptr;
+
+    // Further sinks of the same results (archive, dashboard, ...), each with its own buffer and thread
+    json sinks = manager->getManagerConfig().value("result_sinks", json::array());
+    for (size_t i = 0; i < sinks.size(); i++) {
+        std::string type = sinks[i].value("type", std::string("pushpull"));
+        std::string lp_socket = sinks[i].value("lp_socket", std::string("none"));
+        std::string hp_socket = sinks[i].value("hp_socket", std::string("none"));
+        std::string prefix = manager->getFullname() + "-" + std::to_string(i + 1);
+        if (lp_socket != "none") {
+            sink_lp_result[indexmanager].push_back(create_result_sink(type, lp_socket, prefix + "-lp", sinks[i]));
+        }
+        if (hp_socket != "none") {
+            sink_hp_result[indexmanager].push_back(create_result_sink(type, hp_socket, prefix + "-hp", sinks[i]));
+        }
+        logger->system("---result sink " + type + " " + manager->get_globalname() + " " + lp_socket + " " + hp_socket, globalname);
+    }
+
+    if (manager->get_result_socket_type() == "file") {
+        // Results archived in rolling Avro files: the result sockets are directories
+        json file_config = manager->getManagerConfig().value("result_file", json::object());
+        if (manager->get_result_lp_socket() != "none") {
+            sink_lp_result[indexmanager].push_back(create_result_sink("file", manager->get_result_lp_socket(), manager->getFullname() + "-lp", file_config));
+        }
+        if (manager->get_result_hp_socket() != "none") {
+            sink_hp_result[indexmanager].push_back(create_result_sink("file", manager->get_result_hp_socket(), manager->getFullname() + "-hp", file_config));
+        }
+        logger->system("---result files " + manager->get_globalname() + " " + manager->get_result_lp_socket() + " " + manager->get_result_hp_socket(), globalname);
+        return;
+    }
     //context = zmq::context_t(1);
     if (manager->get_result_lp_socket() != "none") {
         if (manager->get_result_socket_type() == "pushpull") {
@@ -166,7 +290,7 @@ void Supervisor::setup_result_channel(WorkerManager *manager, int indexmanager)
             logger->system("---result lp socket pushpull " + manager->get_globalname() + " " + manager->get_result_lp_socket(), globalname);
         } else if (manager->get_result_socket_type() == "pubsub") {
             socket_lp_result[indexmanager] = new zmq::socket_t(context, ZMQ_PUB);
-            socket_lp_result[indexmanager]->bind(manager->get_result_lp_socket());
+            socket_lp_result[indexmanager]->bind(PerCoreMode::shard_endpoint(manager->get_result_lp_socket()));
             std::cout << "---result lp socket pushpull " << manager->get_globalname() << " " << manager->get_result_lp_socket() << std::endl;
             logger->system("---result lp socket pushpull " + manager->get_globalname() + " " + manager->get_result_lp_socket(), globalname);
         }
@@ -180,31 +304,73 @@ void Supervisor::setup_result_channel(WorkerManager *manager, int indexmanager)
             logger->system("---result hp socket pushpull " + manager->get_globalname() + " " + manager->get_result_hp_socket(), globalname);
         } else if (manager->get_result_socket_type() == "pubsub") {
             socket_hp_result[indexmanager] = new zmq::socket_t(context, ZMQ_PUB);
-            socket_hp_result[indexmanager]->bind(manager->get_result_hp_socket());
+            socket_hp_result[indexmanager]->bind(PerCoreMode::shard_endpoint(manager->get_result_hp_socket()));
             std::cout << "---result hp socket pushpull " << manager->get_globalname() << " " << manager->get_result_hp_socket() << std::endl;
             logger->system("---result hp socket pushpull " + manager->get_globalname() + " " + manager->get_result_hp_socket(), globalname);
         }
     }
 }
 
+// Creates a buffered result sink of a given type ("file", "pushpull" or "pubsub")
+std::unique_ptr<ResultSink> Supervisor::create_result_sink(const std::string &type, const std::string &endpoint, const std::string &prefix, const json &configuration) {
+    if (type == "file") {
+        return std::make_unique<AvroFileSink>(endpoint, prefix, configuration);
+    }
+    return std::make_unique<SocketSink>(context, type, endpoint, configuration);
+}
 
 
 // Start managers
 void Supervisor::start_managers() {
-    int indexmanager = 0;
-    WorkerManager *manager = new WorkerManager(indexmanager, this, "Generic");
-    setup_result_channel(manager, indexmanager);
-    manager->run();
-    manager_workers.push_back(manager);
+    int num_managers = pipeline->is_enabled() ? pipeline->size() : 1;
+    for (int indexmanager = 0; indexmanager < num_managers; indexmanager++) {
+        WorkerManager *manager = new WorkerManager(indexmanager, this, pipeline->is_enabled() ? pipeline->get_name(indexmanager) : "Generic");
+        setup_result_channel(manager, indexmanager);
+        manager->run();
+        manager_workers.push_back(manager);
+    }
+    connect_pipeline();
+}
+
+// Connect the managers of the pipeline DAG in memory, after start_managers
+void Supervisor::connect_pipeline() {
+    if (!pipeline->is_enabled()) {
+        return;
+    }
+    for (auto &manager : manager_workers) {
+        int indexmanager = manager->get_manager_id();
+        std::vector<WorkerManager*> fused_stages;
+        for (int stage : pipeline->get_fused_stages(indexmanager)) {
+            fused_stages.push_back(manager_workers[stage]);
+        }
+        std::vector<WorkerManager*> downstream;
+        for (int output : pipeline->get_outputs(indexmanager)) {
+            downstream.push_back(manager_workers[output]);
+        }
+        manager->set_pipeline(pipeline->is_source(indexmanager), pipeline->is_fused(indexmanager), fused_stages, downstream);
+    }
 }
 
 // Start workers
 void Supervisor::start_workers() {
     int indexmanager = 0;
     for (auto &manager : manager_workers) {
-        manager->start_worker_threads(manager_num_workers);
+        if (!pipeline->is_enabled()) {
+            manager->start_worker_threads(manager_num_workers);
+        } else if (!manager->is_fused()) {
+            // Fused stages run in the worker threads of the head of their chain
+            manager->start_worker_threads(pipeline->get_num_workers(indexmanager));
+        }
         indexmanager++;
     }
+    if (shared_executor) {
+        for (auto &manager : manager_workers) {
+            if (!manager->is_fused()) {
+                shared_executor->add_manager(manager);
+            }
+        }
+        shared_executor->start();
+    }
 }
 
 // Start Supervisor operation
@@ -227,6 +393,11 @@ void Supervisor::start() {
     }
 }
 
+// Handles a coordination message of another shard in per-core mode (to be reimplemented)
+void Supervisor::on_shard_message(int from_core, const std::string &message) {
+    logger->system("Message from shard of core " + std::to_string(from_core) + ": " + message, globalname);
+}
+
 // Static function to handle signals
 void Supervisor::handle_signals(int signum) {
     Supervisor* instance = Supervisor::get_instance();
@@ -249,12 +420,28 @@ void Supervisor::handle_signals(int signum) {
 
 // Listen for result data
 void Supervisor::listen_for_result() {
+    realtime->enter_thread("result", "listen_for_result");
     while (continueall) {
         int indexmanager = 0;
+        int sent = 0;
         for (auto &manager : manager_workers) {
-            send_result(manager, indexmanager);
+            // Egress batch: send up to the batch size of results before servicing the next manager
+            int egress_batch = std::max(manager->get_batch_size(0), manager->get_batch_size(1));
+            if (manager->getReliableSender() && manager->getReliableSender()->is_blocked()) {
+                egress_batch = 0;  // Replay buffer full and not spillable: hold the results back until acked
+            }
+            for (int i = 0; i < egress_batch && (manager->getResultLpQueue()->size() != 0 || manager->getResultHpQueue()->size() != 0); i++) {
+                send_result(manager, indexmanager);
+                sent++;
+            }
+            if (manager->getReliableSender()) {
+                manager->getReliableSender()->service(socket_lp_result[indexmanager], socket_hp_result[indexmanager]);
+            }
             indexmanager++;
         }
+        if (sent == 0) {
+            realtime->idle();
+        }
     }
     std::cout << "End listen_for_result" << std::endl;
     logger->system("End listen_for_result", globalname);
@@ -282,61 +469,130 @@ void Supervisor::send_result(WorkerManager *manager, int indexmanager) {
         }
     }
 
-    if (channel == 0) {
-        if (manager->get_result_lp_socket() == "none") {
-            return;
+    // Results reach the sinks of their channel even if it has no result socket
+    zmq::socket_t *socket = channel == 0 ? socket_lp_result[indexmanager] : socket_hp_result[indexmanager];
+    if (!socket && (channel == 0 ? sink_lp_result[indexmanager] : sink_hp_result[indexmanager]).empty()) {
+        return;
+    }
+    if (manager->get_result_dataflow_type() == "string" || manager->get_result_dataflow_type() == "filename") {
+        try {
+            std::string data_str = data.get<std::string>();
+            send_payload(manager, indexmanager, channel, data_str);
+        } catch (const std::exception &e) {
+            std::cerr << "ERROR: data not in string format to be sent to: " << e.what() << std::endl;
+            logger->error("ERROR: data not in string format to be sent to: " + std::string(e.what()), globalname);
         }
-        if (manager->get_result_dataflow_type() == "string" || manager->get_result_dataflow_type() == "filename") {
-            try {
-                std::string data_str = data.get<std::string>();
-                socket_lp_result[indexmanager]->send(zmq::buffer(data_str));
-            } catch (const std::exception &e) {
-                std::cerr << "ERROR: data not in string format to be sent to: " << e.what() << std::endl;
-                logger->error("ERROR: data not in string format to be sent to: " + std::string(e.what()), globalname);
-            }
-        } else if (manager->get_result_dataflow_type() == "binary") {
-            try {
-                socket_lp_result[indexmanager]->send(zmq::buffer(data.dump()));
-            } catch (const std::exception &e) {
-                std::cerr << "ERROR: data not in binary format to be sent to socket_result: " << e.what() << std::endl;
-                logger->error("ERROR: data not in binary format to be sent to socket_result: " + std::string(e.what()), globalname);
-            }
+    } else if (manager->get_result_dataflow_type() == "binary") {
+        try {
+            send_payload(manager, indexmanager, channel, data.dump());
+        } catch (const std::exception &e) {
+            std::cerr << "ERROR: data not in binary format to be sent to socket_result: " << e.what() << std::endl;
+            logger->error("ERROR: data not in binary format to be sent to socket_result: " + std::string(e.what()), globalname);
         }
     }
+}
 
-    if (channel == 1) {
-        if (manager->get_result_hp_socket() == "none") {
-            return;
+// Helper function to send a result to every sink of its channel, then to the result
+// socket (through the reliable sender if configured). Sinks only buffer the result
+void Supervisor::send_payload(WorkerManager *manager, int indexmanager, int channel, const std::string &payload) {
+    for (auto &sink : channel == 0 ? sink_lp_result[indexmanager] : sink_hp_result[indexmanager]) {
+        sink->write(payload, channel);
+    }
+    zmq::socket_t *socket = channel == 0 ? socket_lp_result[indexmanager] : socket_hp_result[indexmanager];
+    if (!socket) {
+        return;
+    }
+    if (manager->getReliableSender()) {
+        manager->getReliableSender()->send(socket, channel, payload);
+    } else {
+        socket->send(zmq::buffer(payload));
+    }
+}
+
+// Helper function to receive a data message, checking its sequence number in reliable mode.
+// A producer can prepend a frame "deadline:<unix time in microseconds>": the deadline is
+// returned converted to the BatchController::now_ns clock (0 if not given)
+bool Supervisor::receive_data(zmq::socket_t *socket, ReliableReceiver *receiver, zmq::message_t &data, int64_t &deadline_ns, uint64_t &token, zmq::recv_flags flags) {
+    deadline_ns = 0;
+    token = 0;
+    zmq::message_t first;
+    if (!socket->recv(first, flags)) {
+        if (receiver) {
+            receiver->flush();  // receive timeout: send the pending acks
         }
-        if (manager->get_result_dataflow_type() == "string" || manager->get_result_dataflow_type() == "filename") {
-            try {
-                std::string data_str = data.get<std::string>();
-                socket_hp_result[indexmanager]->send(zmq::buffer(data_str));
-            } catch (const std::exception &e) {
-                std::cerr << "ERROR: data not in string format to be sent to: " << e.what() << std::endl;
-                logger->error("ERROR: data not in string format to be sent to: " + std::string(e.what()), globalname);
-            }
-        } else if (manager->get_result_dataflow_type() == "binary") {
-            try {
-                socket_hp_result[indexmanager]->send(zmq::buffer(data.dump()));
-            } catch (const std::exception &e) {
-                std::cerr << "ERROR: data not in binary format to be sent to socket_result: " << e.what() << std::endl;
-                logger->error("ERROR: data not in binary format to be sent to socket_result: " + std::string(e.what()), globalname);
+        return false;
+    }
+    static const char deadline_prefix[] = "deadline:";
+    const size_t prefix_size = sizeof(deadline_prefix) - 1;
+    if (first.more() && first.size() > prefix_size && memcmp(first.data(), deadline_prefix, prefix_size) == 0) {
+        int64_t deadline_us = strtoll(std::string(static_cast<char*>(first.data()) + prefix_size, first.size() - prefix_size).c_str(), nullptr, 10);
+        int64_t wall_now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        deadline_ns = BatchController::now_ns() + (deadline_us * 1000 - wall_now_ns);
+        socket->recv(first);
+    }
+
+    if (!receiver || !first.more()) {
+        data = std::move(first);  // not sent by a reliable sender
+        return true;
+    }
+    socket->recv(data);
+    bool deliver = receiver->accept(first, token);
+    receiver->flush();
+    return deliver;
+}
+
+// Helper function to receive up to an ingest batch of messages into pooled buffers. The first
+// receive blocks, the following ones only take the messages already arrived
+size_t Supervisor::receive_batch(zmq::socket_t *socket, ReliableReceiver *receiver, int priority, std::vector<PooledBuffer> &received) {
+    size_t max_count = 0;
+    for (auto &manager : manager_workers) {
+        size_t batch_size = static_cast<size_t>(manager->get_batch_size(priority));
+        max_count = max_count == 0 ? batch_size : std::min(max_count, batch_size);
+    }
+    max_count = std::max<size_t>(max_count, 1);
+
+    zmq::message_t data;
+    int64_t deadline_ns = 0;
+    uint64_t token = 0;
+    zmq::recv_flags flags = zmq::recv_flags::none;
+    while (received.size() < max_count && receive_data(socket, receiver, data, deadline_ns, token, flags)) {
+        flags = zmq::recv_flags::dontwait;
+        if (!shard_router->owns(static_cast<char*>(data.data()), data.size())) {
+            if (token) {
+                receiver->complete(token);  // Processed by another shard
             }
+            continue;
         }
+        PooledBuffer buffer = BufferPool::copy(data.data(), data.size());
+        buffer.set_timestamp(BatchController::now_ns());
+        buffer.set_deadline(deadline_ns);
+        if (token) {
+            // Acknowledged once every manager has released the buffer
+            receiver->track(token, buffer);
+            receiver->complete(token);
+        }
+        received.push_back(std::move(buffer));
     }
+    return received.size();
 }
 
 // Listen for low priority data
 void Supervisor::listen_for_lp_data() {
+    realtime->enter_thread("lp_listener", "listen_for_lp_data");
+    std::vector<PooledBuffer> received;
     while (continueall) {
         if (!stopdata) {
-            zmq::message_t data;
-            socket_lp_data->recv(data);
+            if (receive_batch(socket_lp_data, reliable_lp_receiver, 0, received) == 0) {
+                continue;
+            }
+            // The pooled copies are shared by all the managers
             for (auto &manager : manager_workers) {
-                json decodeddata = json::parse(data.to_string());
-                manager->getLowPriorityQueue()->push(decodeddata);
+                if (manager->is_source()) {
+                    manager->enqueue(0, received);
+                }
             }
+            received.clear();
+            realtime->check_faults("listen_for_lp_data");
         }
     }
     std::cout << "End listen_for_lp_data" << std::endl;
@@ -345,14 +601,21 @@ void Supervisor::listen_for_lp_data() {
 
 // Listen for high priority data
 void Supervisor::listen_for_hp_data() {
+    realtime->enter_thread("hp_listener", "listen_for_hp_data");
+    std::vector<PooledBuffer> received;
     while (continueall) {
         if (!stopdata) {
-            zmq::message_t data;
-            socket_hp_data->recv(data);
+            if (receive_batch(socket_hp_data, reliable_hp_receiver, 1, received) == 0) {
+                continue;
+            }
+            // The pooled copies are shared by all the managers
             for (auto &manager : manager_workers) {
-                json decodeddata = json::parse(data.to_string());
-                manager->getHighPriorityQueue()->push(decodeddata);
+                if (manager->is_source()) {
+                    manager->enqueue(1, received);
+                }
             }
+            received.clear();
+            realtime->check_faults("listen_for_hp_data");
         }
     }
     std::cout << "End listen_for_hp_data" << std::endl;
@@ -361,14 +624,21 @@ void Supervisor::listen_for_hp_data() {
 
 // Listen for low priority strings
 void Supervisor::listen_for_lp_string() {
+    realtime->enter_thread("lp_listener", "listen_for_lp_string");
+    std::vector<PooledBuffer> received;
     while (continueall) {
         if (!stopdata) {
-            zmq::message_t data;
-            socket_lp_data->recv(data);
-            std::string data_str(static_cast<char*>(data.data()), data.size());
+            if (receive_batch(socket_lp_data, reliable_lp_receiver, 0, received) == 0) {
+                continue;
+            }
+            // The pooled copies are shared by all the managers
             for (auto &manager : manager_workers) {
-                manager->getLowPriorityQueue()->push(data_str);
+                if (manager->is_source()) {
+                    manager->enqueue(0, received);
+                }
             }
+            received.clear();
+            realtime->check_faults("listen_for_lp_string");
         }
     }
     std::cout << "End listen_for_lp_string" << std::endl;
@@ -377,14 +647,21 @@ void Supervisor::listen_for_lp_string() {
 
 // Listen for high priority strings
 void Supervisor::listen_for_hp_string() {
+    realtime->enter_thread("hp_listener", "listen_for_hp_string");
+    std::vector<PooledBuffer> received;
     while (continueall) {
         if (!stopdata) {
-            zmq::message_t data;
-            socket_hp_data->recv(data);
-            std::string data_str(static_cast<char*>(data.data()), data.size());
+            if (receive_batch(socket_hp_data, reliable_hp_receiver, 1, received) == 0) {
+                continue;
+            }
+            // The pooled copies are shared by all the managers
             for (auto &manager : manager_workers) {
-                manager->getHighPriorityQueue()->push(data_str);
+                if (manager->is_source()) {
+                    manager->enqueue(1, received);
+                }
             }
+            received.clear();
+            realtime->check_faults("listen_for_hp_string");
         }
     }
     std::cout << "End listen_for_hp_string" << std::endl;
@@ -393,17 +670,39 @@ void Supervisor::listen_for_hp_string() {
 
 // Listen for low priority files
 void Supervisor::listen_for_lp_file() {
+    realtime->enter_thread("lp_listener", "listen_for_lp_file");
+    std::string contents;
+    std::vector<std::string_view> records;
     while (continueall) {
         if (!stopdata) {
             zmq::message_t filename_msg;
-            socket_lp_data->recv(filename_msg);
+            int64_t deadline_ns = 0;
+            uint64_t token = 0;
+            if (!receive_data(socket_lp_data, reliable_lp_receiver, filename_msg, deadline_ns, token)) {
+                continue;
+            }
             std::string filename(static_cast<char*>(filename_msg.data()), filename_msg.size());
-            for (auto &manager : manager_workers) {
-                auto [data, size] = open_file(filename);
-                for (int i = 0; i < size; i++) {
-                    manager->getLowPriorityQueue()->push(data[i]);
+            if (shard_router->owns(filename)) {
+                read_records(filename, contents, records);
+            } else {
+                records.clear();
+            }
+            for (auto record : records) {
+                PooledBuffer buffer = BufferPool::copy(record.data(), record.size());
+                buffer.set_timestamp(BatchController::now_ns());
+                buffer.set_deadline(deadline_ns);
+                if (reliable_lp_receiver) {
+                    reliable_lp_receiver->track(token, buffer);  // The file is acknowledged once all its records are processed
+                }
+                for (auto &manager : manager_workers) {
+                    if (manager->is_source()) {
+                        manager->enqueue(0, {buffer});
+                    }
                 }
             }
+            if (reliable_lp_receiver) {
+                reliable_lp_receiver->complete(token);
+            }
         }
     }
     std::cout << "End listen_for_lp_file" << std::endl;
@@ -412,48 +711,82 @@ void Supervisor::listen_for_lp_file() {
 
 
 
-std::pair<std::vector<json>, int> Supervisor::open_file(const std::string &filename) {
-    std::vector<json> data;  // Vector to store parsed JSON objects
-    int size = 0;
+// Helper function to read a file of JSON lines, validated on demand without building a DOM.
+// The valid lines are returned as views on contents
+int Supervisor::read_records(const std::string &filename, std::string &contents, std::vector<std::string_view> &records) {
+    thread_local JsonDocument document;
+    records.clear();
 
-    std::ifstream file(filename); // Open the file for reading
+    std::ifstream file(filename, std::ios::binary);
     if (!file.is_open()) {
         std::cerr << "Unable to open file: " << filename << std::endl;
         logger->error("Unable to open file: " + filename, globalname);
-        return {data, size};  // Return empty vector and size 0 if the file cannot be opened
+        return 0;
     }
-
-    try {
-        std::string line;
-        while (std::getline(file, line)) { // Read the file line-by-line
-            if (!line.empty()) { // Only attempt to parse non-empty lines
-                json jsonData = json::parse(line); // Parse the line as JSON
-                data.push_back(jsonData); // Add the parsed JSON object to the vector
-                size++;
-            }
+    contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+    std::string_view text(contents);
+    size_t begin = 0;
+    int line_number = 0;
+    while (begin < text.size()) {
+        size_t end = text.find('\n', begin);
+        if (end == std::string_view::npos) {
+            end = text.size();
+        }
+        std::string_view line = text.substr(begin, end - begin);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        line_number++;
+        begin = end + 1;
+        if (line.empty()) {
+            continue;
+        }
+        if (document.parse(line)) {
+            records.push_back(line);
+        } else {
+            std::cerr << "Error while reading file: " << filename << " line " << line_number << ": " << document.get_error() << std::endl;
+            logger->error("Error while reading file: " + filename + " line " + std::to_string(line_number) + ": " + document.get_error(), globalname);
         }
-    } catch (const std::exception &e) {
-        std::cerr << "Error while reading file: " << e.what() << std::endl;
-        logger->error("Error while reading file: " + std::string(e.what()), globalname);
     }
-
-    file.close(); // Close the file after reading
-    return {data, size}; // Return the vector and the size of the data read
+    return records.size();
 }
 
 // Listen for high priority files
 void Supervisor::listen_for_hp_file() {
+    realtime->enter_thread("hp_listener", "listen_for_hp_file");
+    std::string contents;
+    std::vector<std::string_view> records;
     while (continueall) {
         if (!stopdata) {
             zmq::message_t filename_msg;
-            socket_hp_data->recv(filename_msg);
+            int64_t deadline_ns = 0;
+            uint64_t token = 0;
+            if (!receive_data(socket_hp_data, reliable_hp_receiver, filename_msg, deadline_ns, token)) {
+                continue;
+            }
             std::string filename(static_cast<char*>(filename_msg.data()), filename_msg.size());
-            for (auto &manager : manager_workers) {
-                auto [data, size] = open_file(filename);
-                for (int i = 0; i < size; i++) {
-                    manager->getHighPriorityQueue()->push(data[i]);
+            if (shard_router->owns(filename)) {
+                read_records(filename, contents, records);
+            } else {
+                records.clear();
+            }
+            for (auto record : records) {
+                PooledBuffer buffer = BufferPool::copy(record.data(), record.size());
+                buffer.set_timestamp(BatchController::now_ns());
+                buffer.set_deadline(deadline_ns);
+                if (reliable_hp_receiver) {
+                    reliable_hp_receiver->track(token, buffer);  // The file is acknowledged once all its records are processed
+                }
+                for (auto &manager : manager_workers) {
+                    if (manager->is_source()) {
+                        manager->enqueue(1, {buffer});
+                    }
                 }
             }
+            if (reliable_hp_receiver) {
+                reliable_hp_receiver->complete(token);
+            }
         }
     }
     std::cout << "End listen_for_hp_file" << std::endl;
@@ -594,7 +927,7 @@ void Supervisor::process_command(const json &command) {
     std::string pidsource = command["header"]["pidsource"].get<std::string>();
 
     if (type_value == 0) { // command
-        if (pidtarget == name || pidtarget == "all" || pidtarget == "*") {
+        if (pidtarget == name || pidtarget == fullname || pidtarget == "all" || pidtarget == "*") {
             std::cout << "Received command: " << command << std::endl;
             if (subtype_value == "shutdown") {
                 command_shutdown();
@@ -680,12 +1013,32 @@ void Supervisor::stop_all(bool fast) {
     command_stop();
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
+    if (shared_executor) {
+        shared_executor->stop();
+    }
+
     for (auto &manager : manager_workers) {
         manager->stop(fast);
     }
 
     continueall = false;
 
+    if (cross_shard) {
+        cross_shard->stop();
+    }
+
+    // Deliver the results still buffered by the sinks and close the result files
+    for (auto &sinks : sink_lp_result) {
+        for (auto &sink : sinks) {
+            sink->stop();
+        }
+    }
+    for (auto &sinks : sink_hp_result) {
+        for (auto &sink : sinks) {
+            sink->stop();
+        }
+    }
+
     std::cout << "All Supervisor workers and managers and internal threads terminated." << std::endl;
     logger->system("All Supervisor workers and managers and internal threads terminated.", globalname);
 }
\ No newline at end of file
@@ -0,0 +1,257 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include "TimerService.h"
+#include "BatchController.h"
+
+using json = nlohmann::json;
+
+TimerService::TimerService()
+    : tick_ns(1000000), start_ns(BatchController::now_ns()), current_tick(0), next_id(1), running_id(0),
+      stop_event(false), fired_count(0), wakeup_count(0), max_lateness_ns(0) {
+    wheel[0].resize(LEVEL0_SIZE);
+    for (int level = 1; level < NUM_LEVELS; ++level) {
+        wheel[level].resize(LEVEL_SIZE);
+    }
+}
+
+TimerService::~TimerService() {
+    stop();
+}
+
+// Returns the process-wide instance
+TimerService& TimerService::get_instance() {
+    // Never destroyed: timers may be cancelled during static destruction
+    static TimerService* instance = new TimerService();
+    return *instance;
+}
+
+// Sets the tick from the "timer_service" configuration section. Call before the first timer is scheduled
+void TimerService::configure(const json& configuration) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!timers.empty()) {
+        return;
+    }
+    tick_ns = static_cast<int64_t>(std::max(0.01, configuration.value("tick_ms", 1.0)) * 1e6);
+    start_ns = BatchController::now_ns();
+    current_tick = 0;
+}
+
+void TimerService::start() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (thread.joinable()) {
+        return;
+    }
+    stop_event = false;
+    thread = std::thread(&TimerService::run, this);
+    thread_id = thread.get_id();
+}
+
+void TimerService::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop_event = true;
+    }
+    wakeup_cv.notify_all();
+    if (thread.joinable() && std::this_thread::get_id() != thread.get_id()) {
+        thread.join();
+    }
+}
+
+// Inserts a timer id in the wheel slot of its expiry. Requires the lock
+void TimerService::insert(TimerId id, uint64_t expires) {
+    uint64_t base = current_tick + 1;
+    if (expires < base) {
+        expires = base;
+    }
+    uint64_t delta = expires - base;
+    if (delta < LEVEL0_SIZE) {
+        wheel[0][expires & (LEVEL0_SIZE - 1)].push_back(id);
+        return;
+    }
+    for (int level = 1; level < NUM_LEVELS; ++level) {
+        int shift = LEVEL0_BITS + LEVEL_BITS * (level - 1);
+        if (delta < (static_cast<uint64_t>(1) << (shift + LEVEL_BITS)) || level == NUM_LEVELS - 1) {
+            if (level == NUM_LEVELS - 1 && delta >= (static_cast<uint64_t>(1) << (shift + LEVEL_BITS))) {
+                // Beyond the wheel: parked in the last slot, re-inserted when it comes up
+                expires = base + (static_cast<uint64_t>(1) << (shift + LEVEL_BITS)) - 1;
+            }
+            wheel[level][(expires >> shift) & (LEVEL_SIZE - 1)].push_back(id);
+            return;
+        }
+    }
+}
+
+// Moves the timers of a slot of an upper level down the wheel. Requires the lock
+void TimerService::cascade(int level, uint64_t index) {
+    std::vector<TimerId> slot;
+    slot.swap(wheel[level][index]);
+    for (TimerId id : slot) {
+        auto it = timers.find(id);
+        if (it != timers.end()) {
+            insert(id, it->second.expires);
+        }
+    }
+}
+
+// Next tick to wake up at: the next non-empty slot of level 0 or the next cascade. Requires the lock
+uint64_t TimerService::next_wakeup_tick() const {
+    uint64_t base = current_tick + 1;
+    uint64_t next_cascade = (base + LEVEL0_SIZE - 1) & ~(LEVEL0_SIZE - 1);
+    for (uint64_t tick = base; tick < next_cascade; ++tick) {
+        if (!wheel[0][tick & (LEVEL0_SIZE - 1)].empty()) {
+            return tick;
+        }
+    }
+    return next_cascade;
+}
+
+// Advances the wheel up to the given tick, running the expired callbacks
+void TimerService::advance(uint64_t tick, std::unique_lock<std::mutex>& lock) {
+    std::vector<TimerId> slot;
+    while (current_tick < tick && !stop_event) {
+        uint64_t t = current_tick + 1;
+        if ((t & (LEVEL0_SIZE - 1)) == 0) {
+            // Upper levels first, so their timers can reach level 0
+            for (int level = NUM_LEVELS - 1; level >= 1; --level) {
+                int shift = LEVEL0_BITS + LEVEL_BITS * (level - 1);
+                if ((t & ((static_cast<uint64_t>(1) << shift) - 1)) == 0) {
+                    cascade(level, (t >> shift) & (LEVEL_SIZE - 1));
+                }
+            }
+        }
+        slot.clear();
+        slot.swap(wheel[0][t & (LEVEL0_SIZE - 1)]);
+        current_tick = t;
+
+        for (TimerId id : slot) {
+            auto it = timers.find(id);
+            if (it == timers.end()) {
+                continue;  // Cancelled
+            }
+            if (it->second.expires > t) {
+                insert(id, it->second.expires);  // Parked beyond the wheel
+                continue;
+            }
+            Callback callback = it->second.callback;
+            uint64_t period = it->second.period;
+            if (period == 0) {
+                timers.erase(it);
+            }
+
+            int64_t lateness = BatchController::now_ns() - (start_ns + static_cast<int64_t>(t) * tick_ns);
+            if (lateness > max_lateness_ns.load(std::memory_order_relaxed)) {
+                max_lateness_ns.store(lateness, std::memory_order_relaxed);
+            }
+
+            running_id = id;
+            lock.unlock();
+            try {
+                callback();
+            } catch (const std::exception& e) {
+                std::cerr << "Exception caught in timer callback: " << e.what() << std::endl;
+            }
+            lock.lock();
+            running_id = 0;
+            done_cv.notify_all();
+            fired_count.fetch_add(1, std::memory_order_relaxed);
+
+            if (period != 0) {
+                it = timers.find(id);
+                if (it != timers.end()) {
+                    // Keep the phase; skip the periods missed if the callback was late
+                    do {
+                        it->second.expires += period;
+                    } while (it->second.expires <= current_tick);
+                    insert(id, it->second.expires);
+                }
+            }
+        }
+    }
+}
+
+void TimerService::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stop_event) {
+        if (timers.empty()) {
+            wakeup_cv.wait(lock, [this] { return stop_event || !timers.empty(); });
+            continue;
+        }
+        uint64_t tick = next_wakeup_tick();
+        auto deadline = std::chrono::steady_clock::time_point(std::chrono::nanoseconds(start_ns + static_cast<int64_t>(tick) * tick_ns));
+        wakeup_cv.wait_until(lock, deadline);
+        wakeup_count.fetch_add(1, std::memory_order_relaxed);
+
+        int64_t now = BatchController::now_ns();
+        uint64_t now_tick = now > start_ns ? static_cast<uint64_t>((now - start_ns) / tick_ns) : 0;
+        if (now_tick > current_tick) {
+            advance(now_tick, lock);
+        }
+    }
+}
+
+// Adds a timer expiring after delay_ns, then every period_ns if not 0
+TimerService::TimerId TimerService::add(int64_t delay_ns, int64_t period_ns, Callback callback) {
+    start();
+    TimerId id;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        int64_t now = BatchController::now_ns();
+        uint64_t now_tick = now > start_ns ? static_cast<uint64_t>((now - start_ns) / tick_ns) : 0;
+        if (timers.empty() && running_id == 0) {
+            // Idle wheel: skip the ticks slept through, the slots only hold cancelled ids
+            current_tick = std::max(current_tick, now_tick);
+        }
+        uint64_t ticks = std::max<int64_t>(1, (delay_ns + tick_ns - 1) / tick_ns);
+        uint64_t period = period_ns > 0 ? std::max<int64_t>(1, (period_ns + tick_ns - 1) / tick_ns) : 0;
+        id = next_id++;
+        timers[id] = Timer{now_tick + ticks, period, std::move(callback)};
+        insert(id, now_tick + ticks);
+    }
+    wakeup_cv.notify_all();
+    return id;
+}
+
+// Schedules a callback after delay_ns
+TimerService::TimerId TimerService::schedule(int64_t delay_ns, Callback callback) {
+    return add(delay_ns, 0, std::move(callback));
+}
+
+// Schedules a callback every period_ns, the first time after period_ns
+TimerService::TimerId TimerService::schedule_periodic(int64_t period_ns, Callback callback) {
+    return add(period_ns, period_ns, std::move(callback));
+}
+
+// Cancels a timer. When it returns the callback is not running and will
+// not run again (unless called from the callback itself). Returns false
+// if the timer was not found (already fired or cancelled)
+bool TimerService::cancel(TimerId id) {
+    if (id == 0) {
+        return false;
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    bool found = timers.erase(id) > 0;
+    if (std::this_thread::get_id() != thread_id) {
+        done_cv.wait(lock, [this, id] { return running_id != id; });
+    }
+    return found;
+}
+
+// Timer service statistics for monitoring
+json TimerService::get_stats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    json stats;
+    stats["timers"] = timers.size();
+    stats["tick_ms"] = tick_ns / 1e6;
+    stats["fired"] = fired_count.load(std::memory_order_relaxed);
+    stats["wakeups"] = wakeup_count.load(std::memory_order_relaxed);
+    stats["max_lateness_ms"] = max_lateness_ns.load(std::memory_order_relaxed) / 1e6;
+    return stats;
+}
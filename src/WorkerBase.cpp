@@ -10,7 +10,7 @@
 
 // Default constructor
 WorkerBase::WorkerBase()
-    : manager(nullptr), supervisor(nullptr) {  // Initialize pointers to nullptr
+    : manager(nullptr), supervisor(nullptr), state_version(0) {  // Initialize pointers to nullptr
     // Logger is initialized in the init method
 }
 
@@ -45,3 +45,74 @@ void WorkerBase::config(const nlohmann::json& configuration) {
 nlohmann::json WorkerBase::processData(const nlohmann::json& data, int priority) {
    return {};
 }
+
+// Default fused input: the serialized result, in a reused string
+nlohmann::json WorkerBase::processFused(const nlohmann::json& result, int priority) {
+    nlohmann::json::string_t& serialized = fused_payload.get_ref<nlohmann::json::string_t&>();
+    if (result.is_string()) {
+        serialized = result.get_ref<const nlohmann::json::string_t&>();
+    } else {
+        serialized = result.dump();
+    }
+    return processData(fused_payload, priority);
+}
+
+// Parses a JSON message on demand
+JsonValue WorkerBase::parse_view(std::string_view data) {
+    document.parse(data);
+    return document.root();
+}
+
+// Decodes a JSON-encoded AvroMonitoringPoint into the batch, reading only its fields
+bool WorkerBase::decodeToBatch(std::string_view data, ColumnarBatch& batch) {
+    JsonValue record = parse_view(data);
+    if (record.type() == JsonValue::OBJECT) {
+        try {
+            batch.append_json(record);
+        } catch (const std::exception& e) {
+            // Only this message is dropped, the rest of the batch is kept
+            static const int malformed = counter_id("malformed");
+            count(malformed);
+            spdlog::warn("Malformed record: dropped from the batch: {}", e.what());
+        }
+        return true;
+    }
+    // Not a JSON record: processed by processData
+    return false;
+}
+
+// Fallback for workers without a columnar implementation
+nlohmann::json WorkerBase::processBatch(const ColumnarBatch& batch, int priority) {
+    nlohmann::json results = nlohmann::json::array();
+    for (size_t row = 0; row < batch.size(); ++row) {
+        nlohmann::json result = processData(batch.to_json(row), priority);
+        if (!result.empty()) {
+            results.push_back(result);
+        }
+    }
+    return results;
+}
+
+// Publishes a new immutable snapshot of the worker state
+void WorkerBase::publish_state(nlohmann::json state) {
+    std::atomic_store(&checkpoint_state, std::shared_ptr<const nlohmann::json>(std::make_shared<nlohmann::json>(std::move(state))));
+    state_version++;
+}
+
+std::shared_ptr<const nlohmann::json> WorkerBase::serialize() const {
+    return std::atomic_load(&checkpoint_state);
+}
+
+// Default restore keeps the checkpoint as the current state
+void WorkerBase::restore(const nlohmann::json& state) {
+    std::atomic_store(&checkpoint_state, std::shared_ptr<const nlohmann::json>(std::make_shared<nlohmann::json>(state)));
+}
+
+// Default merge keeps the state of the last worker
+void WorkerBase::merge_state(nlohmann::json& into, const nlohmann::json& from) const {
+    into = from;
+}
+
+uint64_t WorkerBase::get_state_version() const {
+    return state_version;
+}
@@ -18,7 +18,7 @@ WorkerManager::WorkerManager(int manager_id, Supervisor* supervisor, const std::
     workersname = supervisor->name_workers[manager_id];
     config = std::make_shared<json>(supervisor-> config);
     logger = supervisor->logger;
-    fullname = supervisor->name + "-" + name;
+    fullname = supervisor->fullname + "-" + name;
     globalname = "WorkerManager-" + fullname;
     processingtype = supervisor->processingtype;
     max_workers = 100;
@@ -30,23 +30,77 @@ WorkerManager::WorkerManager(int manager_id, Supervisor* supervisor, const std::
     socket_hp_result = supervisor->socket_hp_result;
     pid = getpid();
     socket_monitoring = supervisor->socket_monitoring;
+    if (config->contains("manager") && (*config)["manager"].size() > static_cast<size_t>(manager_id)) {
+        manager_config = (*config)["manager"][manager_id];
+        result_socket_type = manager_config.value("result_socket_type", result_socket_type);
+    }
    
 
     
-    low_priority_queue = std::make_shared<std::queue<std::string>>();
-    high_priority_queue = std::make_shared<std::queue<std::string>>();
+    low_priority_queue = std::make_shared<MessageQueue>();
+    high_priority_queue = std::make_shared<MessageQueue>();
+    setup_deadline_scheduling(*low_priority_queue, *high_priority_queue);
+    supervisor->realtime->prefault_queue(*low_priority_queue);
+    supervisor->realtime->prefault_queue(*high_priority_queue);
+    large_message_size = 0;
+    large_num_workers = 0;
+    large_routed = 0;
+    if (manager_config.contains("size_routing")) {
+        const json& routing_config = manager_config["size_routing"];
+        large_message_size = static_cast<size_t>(routing_config.value("large_message_kb", 256.0) * 1024);
+        large_num_workers = std::max(1, routing_config.value("num_workers", 1));
+        large_lp_queue = std::make_shared<MessageQueue>();
+        large_hp_queue = std::make_shared<MessageQueue>();
+        setup_deadline_scheduling(*large_lp_queue, *large_hp_queue);  // Same ordering as the main queues
+        logger->system(fmt::format("Size routing: messages of {} bytes or more to {} dedicated workers", large_message_size, large_num_workers), globalname);
+    }
     result_lp_queue = std::make_shared<std::queue<std::string>>();
     result_hp_queue = std::make_shared<std::queue<std::string>>();
     
     // Initialize monitoring
     monitoringpoint = nullptr;
     monitoringthread = nullptr;
+    if (manager_config.contains("checkpoint")) {
+        checkpoint_manager = std::make_unique<CheckpointManager>(manager_config["checkpoint"], fullname, logger, globalname);
+    }
+    reliable_sender = nullptr;
+    if (manager_config.contains("reliable")) {
+        reliable_sender = new ReliableSender(context, manager_config["reliable"], fullname, logger, globalname);
+    }
+    batch_size = manager_config.value("batch_size", 1);
+    batch_controller = nullptr;
+    if (manager_config.contains("adaptive_batching")) {
+        batch_controller = new BatchController(manager_config["adaptive_batching"], batch_size);
+    }
+    source = true;
+    fused = false;
+    result_ring = this;
+    result_output = result_lp_socket != "none" || result_hp_socket != "none" || !manager_config.value("result_sinks", json::array()).empty();
+    overload_governor = nullptr;
+    if (manager_config.contains("load_shedding")) {
+        overload_governor = new OverloadGovernor(manager_config["load_shedding"], this, logger, fullname, globalname);
+    }
+    slo_monitor = nullptr;
+    if (manager_config.contains("slo")) {
+        slo_monitor = new SloMonitor(manager_config["slo"], this, logger, fullname, globalname);
+    }
+    hedge_controller = nullptr;
+    if (manager_config.contains("hedging")) {
+        hedge_controller = new HedgeController(manager_config["hedging"], max_workers);
+        logger->system("Hedged execution of HP stragglers enabled", globalname);
+    }
+    result_cache = nullptr;
+    if (manager_config.contains("result_cache")) {
+        result_cache = new ResultCache(manager_config["result_cache"]);
+        logger->system("Result cache enabled", globalname);
+    }
     num_workers = 0;
     workersstatus = 0;
     workersstatusinit = 0;
 
     
     tokenresultslock = std::make_shared<std::mutex>();
+    workerthreadslock = std::make_shared<std::mutex>();
     tokenreadinglock = std::make_shared<std::mutex>();
     
 
@@ -123,14 +177,15 @@ std::vector<std::atomic<int>>& WorkerManager::getWorkerStatusShared() {
 }
 
 std::vector<std::shared_ptr<WorkerThread>> WorkerManager::getWorkerThreads() {
+    std::lock_guard<std::mutex> lock(*workerthreadslock);
     return worker_threads;
 }
 
-std::shared_ptr<std::queue<std::string>> WorkerManager::getLowPriorityQueue() const {
+std::shared_ptr<MessageQueue> WorkerManager::getLowPriorityQueue() const {
     return low_priority_queue;
 }
 
-std::shared_ptr<std::queue<std::string>> WorkerManager::getHighPriorityQueue() const {
+std::shared_ptr<MessageQueue> WorkerManager::getHighPriorityQueue() const {
     return high_priority_queue;
 }
 
@@ -150,12 +205,163 @@ MonitoringThread* WorkerManager::getMonitoringThread() const {
     return monitoringthread;
 }
 
-// Function to change token results
+CheckpointManager* WorkerManager::getCheckpointManager() const {
+    return checkpoint_manager.get();
+}
+
+ReliableSender* WorkerManager::getReliableSender() const {
+    return reliable_sender;
+}
+
+BatchController* WorkerManager::getBatchController() const {
+    return batch_controller;
+}
+
+OverloadGovernor* WorkerManager::getOverloadGovernor() const {
+    return overload_governor;
+}
+
+SloMonitor* WorkerManager::getSloMonitor() const {
+    return slo_monitor;
+}
+
+HedgeController* WorkerManager::getHedgeController() const {
+    return hedge_controller;
+}
+
+ResultCache* WorkerManager::getResultCache() const {
+    return result_cache;
+}
+
+// Applies the "deadline_scheduling" configuration to a pair of input queues
+void WorkerManager::setup_deadline_scheduling(MessageQueue& lp_queue, MessageQueue& hp_queue) {
+    if (!manager_config.contains("deadline_scheduling")) {
+        return;
+    }
+    // Earliest deadline first for HP; for LP only if it has a budget
+    const json& deadline_config = manager_config["deadline_scheduling"];
+    bool drop_expired = deadline_config.value("drop_expired", false);
+    double hp_budget_ms = deadline_config.value("hp_budget_ms", 0.0);
+    double lp_budget_ms = deadline_config.value("lp_budget_ms", 0.0);
+    hp_queue.set_deadline_scheduling(static_cast<int64_t>(hp_budget_ms * 1e6), drop_expired);
+    if (lp_budget_ms > 0) {
+        lp_queue.set_deadline_scheduling(static_cast<int64_t>(lp_budget_ms * 1e6), drop_expired);
+    }
+}
+
+// Queues received messages, shedding LP load if the manager is overloaded;
+// large messages go to the queues of the large message sub-pool
+void WorkerManager::enqueue(int priority, const std::vector<PooledBuffer>& received) {
+    MessageQueue& queue = priority ? *high_priority_queue : *low_priority_queue;
+    if (large_message_size > 0) {
+        bool mixed = false;
+        for (const auto& buffer : received) {
+            if (buffer.size() >= large_message_size) {
+                mixed = true;
+                break;
+            }
+        }
+        if (mixed) {
+            thread_local std::vector<PooledBuffer> small;
+            thread_local std::vector<PooledBuffer> large;
+            for (const auto& buffer : received) {
+                (buffer.size() >= large_message_size ? large : small).push_back(buffer);
+            }
+            MessageQueue& large_queue = priority ? *large_hp_queue : *large_lp_queue;
+            if (overload_governor) {
+                overload_governor->enqueue(priority, large_queue, large);  // Same admission as the main queues
+            } else {
+                large_queue.push_batch(large);
+            }
+            large_routed += large.size();
+            large.clear();
+            if (!small.empty()) {
+                if (overload_governor) {
+                    overload_governor->enqueue(priority, queue, small);
+                } else {
+                    queue.push_batch(small);
+                }
+                small.clear();
+            }
+            return;
+        }
+    }
+    if (overload_governor) {
+        overload_governor->enqueue(priority, queue, received);
+    } else {
+        queue.push_batch(received);
+    }
+}
+
+// Queues a result for the result sockets. Safe from any worker thread
+void WorkerManager::queue_result(int priority, const std::string& result) {
+    std::lock_guard<std::mutex> lock(*tokenresultslock);
+    if (priority == 0) {
+        result_lp_queue->push(result);
+    } else {
+        result_hp_queue->push(result);
+    }
+}
+
+// Size-aware routing state for monitoring
+json WorkerManager::get_size_routing_stats() const {
+    json stats;
+    stats["large_message_kb"] = large_message_size / 1024.0;
+    stats["workers"] = large_num_workers;
+    stats["routed"] = large_routed.load();
+    stats["queue_lp_size"] = large_lp_queue->size();
+    stats["queue_hp_size"] = large_hp_queue->size();
+    return stats;
+}
+
+// Connects the manager in the pipeline DAG of the Supervisor
+void WorkerManager::set_pipeline(bool source, bool fused, const std::vector<WorkerManager*>& fused_stages, const std::vector<WorkerManager*>& downstream) {
+    this->source = source;
+    this->fused = fused;
+    this->fused_stages = fused_stages;
+    this->downstream = downstream;
+    if (!fused_stages.empty()) {
+        fused_stages.back()->result_ring = this;  // The threads of the head emit the results of the last fused stage
+    }
+}
+
+// Forwards a result to the input queues of the downstream managers
+void WorkerManager::forward(int priority, const std::string& payload) {
+    thread_local std::vector<PooledBuffer> forwarded;
+    PooledBuffer buffer = BufferPool::copy(payload.data(), payload.size());
+    buffer.set_timestamp(BatchController::now_ns());
+    forwarded.push_back(std::move(buffer));  // One copy shared by all the downstream managers
+    for (auto* next : downstream) {
+        next->enqueue(priority, forwarded);
+    }
+    forwarded.clear();
+}
+
+// Creates a worker of this manager (to be reimplemented)
+std::shared_ptr<WorkerBase> WorkerManager::create_worker() {
+    return std::make_shared<WorkerBase>();
+}
+
+// Creates the worker of this stage run by the worker thread worker_id of the head of its fused chain
+WorkerBase* WorkerManager::create_fused_worker(int worker_id) {
+    auto worker = create_worker();
+    worker->init(this, supervisor, workersname, fullname + "-" + std::to_string(worker_id));
+    fused_workers.push_back(worker);
+    return worker.get();
+}
+
+// Returns the current batch size of a priority class (adaptive if configured)
+int WorkerManager::get_batch_size(int priority) const {
+    return batch_controller ? batch_controller->get_batch_size(priority) : batch_size;
+}
+
+// Function to change token results, among the worker threads emitting the results of this manager
 void WorkerManager::change_token_results() {
     std::lock_guard<std::mutex> lock(*tokenresultslock);
-    for (auto& worker : worker_threads) {
+    int ring_size = result_ring->num_workers;
+    for (auto& worker : result_ring->worker_threads) {
         int token_result = worker->get_tokenresult();
-        token_result = (token_result - 1 + num_workers) % num_workers; // Fix the circular decrement
+        token_result = (token_result - 1 + ring_size) % ring_size; // Fix the circular decrement
         worker->set_tokenresult(token_result);
     }
 }
@@ -200,6 +406,12 @@ void WorkerManager::set_processdata(int processdata) {
     for (auto& worker : worker_threads) {
         worker->set_processdata(this->processdata);
     }
+    for (auto& worker : large_worker_threads) {
+        worker->set_processdata(this->processdata);
+    }
+    for (auto& worker : shared_worker_threads) {
+        worker->set_processdata(this->processdata);
+    }
 }
 
 void WorkerManager::setWorkerStatus(int worker_id, int status) {
@@ -230,7 +442,16 @@ void WorkerManager::change_status() {
 void WorkerManager::start_service_threads() {
     monitoringpoint = new MonitoringPoint(this);
     monitoringthread = new MonitoringThread(*socket_monitoring, *monitoringpoint);  // Create MonitoringThread instance
-    monitoring_thread = std::thread(&MonitoringThread::run, monitoringthread);  // Start the thread with run method
+    monitoringthread->start();  // Start the monitoring ticks on the timer service
+    if (checkpoint_manager) {
+        checkpoint_manager->start();
+    }
+    if (overload_governor) {
+        overload_governor->start();
+    }
+    if (slo_monitor) {
+        slo_monitor->start();
+    }
 }
 
 // Function to start worker threads 
@@ -244,10 +465,40 @@ void WorkerManager::start_worker_threads(int num_threads) {
         WorkerBase* worker_base_prt = new WorkerBase();
         auto worker = std::make_shared<WorkerThread>(i, this, std::to_string(i), worker_base_prt);
         //worker->run();
-        worker_threads.push_back(worker);
+        add_worker_thread(worker);
+    }
+    start_large_worker_threads(num_threads);
+}
+
+// Adds a worker thread to the main pool
+void WorkerManager::add_worker_thread(std::shared_ptr<WorkerThread> thread) {
+    std::lock_guard<std::mutex> lock(*workerthreadslock);
+    worker_threads.push_back(std::move(thread));
+}
+
+// Starts the worker threads of the large message sub-pool, numbered from first_worker_id
+void WorkerManager::start_large_worker_threads(int first_worker_id) {
+    for (int i = 0; i < large_num_workers; i++) {
+        int worker_id = first_worker_id + i;
+        auto worker = create_worker();  // Same worker type as the main pool
+        register_worker(worker.get());
+        large_workers.push_back(worker);
+        large_worker_threads.push_back(std::make_shared<WorkerThread>(worker_id, this, "large", worker.get(), true));
     }
 }
 
+// Creates a worker thread of this manager for a thread of the shared executor
+std::shared_ptr<WorkerThread> WorkerManager::create_shared_worker_thread() {
+    int worker_id = num_workers + large_num_workers + static_cast<int>(shared_worker_threads.size());
+    auto worker = create_worker();  // Same worker type as the main pool
+    register_worker(worker.get());
+    shared_workers.push_back(worker);
+    auto thread = std::make_shared<WorkerThread>(worker_id, this, "shared", worker.get(), false, true);
+    thread->set_processdata(processdata);
+    shared_worker_threads.push_back(thread);
+    return thread;
+}
+
 // Function to start worker processes
 void WorkerManager::start_worker_processes(int num_processes) {
     if (num_processes > max_workers) {
@@ -326,16 +577,41 @@ void WorkerManager::stop(bool fast) {
             thread->join();
         }
     }
+    for (auto& thread : large_worker_threads) {
+        thread->stop();
+        if (thread->joinable()){
+            thread->join();
+        }
+    }
+    for (auto& thread : shared_worker_threads) {
+        thread->stop();  // Run by the shared executor, stopped before the managers
+    }
     _stop_event = true;
     stop_internalthreads();
     status = "End";
 }
 
+// Function to register a worker for checkpointing (the first one restores the last checkpoint)
+void WorkerManager::register_worker(WorkerBase* worker) {
+    if (checkpoint_manager) {
+        checkpoint_manager->add_worker(worker);
+    }
+}
+
 void WorkerManager::stop_internalthreads() {
     spdlog::info("Stopping Manager internal threads...");
     logger->system("Stopping Manager internal threads...", globalname);
-    if (monitoring_thread.joinable()) {
-        monitoring_thread.join(); // Use join instead of detach for proper cleanup
+    if (monitoringthread) {
+        monitoringthread->stop();
+    }
+    if (checkpoint_manager) {
+        checkpoint_manager->stop(); // Write the last checkpoint
+    }
+    if (overload_governor) {
+        overload_governor->stop();
+    }
+    if (slo_monitor) {
+        slo_monitor->stop();
     }
     spdlog::info("All Manager internal threads terminated.");
     logger->system("All Manager internal threads terminated.", globalname);
@@ -344,9 +620,21 @@ void WorkerManager::stop_internalthreads() {
 // Function to configure workers
 void WorkerManager::configworkers(const json& configuration) {
     if (processingtype == "thread") {
-        for (auto& worker : worker_threads) {
+        for (auto& worker : getWorkerThreads()) {
+            worker->config(configuration);
+        }
+        for (auto& worker : fused_workers) {
+            worker->config(configuration);
+        }
+        for (auto& worker : large_worker_threads) {
+            worker->config(configuration);
+        }
+        for (auto& worker : shared_worker_threads) {
             worker->config(configuration);
         }
+        if (result_cache) {
+            result_cache->clear();  // Cached results may not hold with the new configuration
+        }
     }
 }
 
@@ -362,6 +650,16 @@ void WorkerManager::clean_single_queue(std::shared_ptr<std::queue<std::string>>&
     }
 }
 
+void WorkerManager::clean_single_queue(std::shared_ptr<MessageQueue>& queue, const std::string& queue_name) {
+    if (!queue->empty()) {
+        spdlog::info("   - {} size {}", queue_name, queue->size());
+        logger->system(fmt::format("   - {} size {}", queue_name, queue->size()), globalname);
+        queue->clear();
+        spdlog::info("   - {} empty", queue_name);
+        logger->system(fmt::format("   - {} empty", queue_name), globalname);
+    }
+}
+
 void WorkerManager::close_queue(std::shared_ptr<std::queue<std::string>>& queue, const std::string& queue_name) {
     try {
         spdlog::info("   - {} size {}", queue_name, queue->size());
@@ -0,0 +1,97 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+#include <algorithm>
+#include <mutex>
+#include "WorkerMetrics.h"
+
+using json = nlohmann::json;
+
+namespace {
+
+struct Registered {
+    std::string name;
+    bool timer;
+};
+
+std::mutex registry_mutex;
+std::vector<Registered> registry;
+
+int64_t steady_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace
+
+namespace tsc {
+
+// Nanoseconds per tick, calibrated against the steady clock since the first call
+double ns_per_tick() {
+#if defined(__x86_64__) || defined(__i386__)
+    static const uint64_t start_ticks = now();
+    static const int64_t start_ns = steady_ns();
+    uint64_t ticks = now() - start_ticks;
+    int64_t elapsed_ns = steady_ns() - start_ns;
+    if (ticks == 0 || elapsed_ns < 1000000) {
+        return 1.0;  // Not enough time elapsed yet: ticks reported as nanoseconds
+    }
+    return static_cast<double>(elapsed_ns) / static_cast<double>(ticks);
+#else
+    return 1.0;
+#endif
+}
+
+}  // namespace tsc
+
+// Returns the id of a timer or counter, registering its name the first time.
+// Ids past MAX_METRICS are not recorded
+int WorkerMetrics::register_metric(const std::string& name, bool timer) {
+    tsc::ns_per_tick();  // Starts the calibration
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    for (size_t id = 0; id < registry.size(); id++) {
+        if (registry[id].name == name) {
+            return static_cast<int>(id);
+        }
+    }
+    registry.push_back(Registered{name, timer});
+    return static_cast<int>(registry.size()) - 1;
+}
+
+// Sums the metrics of the workers of a manager, for monitoring:
+// timers as {"count", "total_ms", "mean_us", "max_us"}, counters as their value
+json WorkerMetrics::get_stats(const std::vector<const WorkerMetrics*>& metrics) {
+    std::vector<Registered> names;
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        names.assign(registry.begin(), registry.begin() + std::min<size_t>(registry.size(), MAX_METRICS));
+    }
+    double ns_per_tick = tsc::ns_per_tick();
+    json stats = json::object();
+    for (size_t id = 0; id < names.size(); id++) {
+        uint64_t count = 0;
+        uint64_t total = 0;
+        uint64_t max = 0;
+        for (const WorkerMetrics* worker : metrics) {
+            const Slot& slot = worker->slots[id];
+            count += slot.count.load(std::memory_order_relaxed);
+            total += slot.total.load(std::memory_order_relaxed);
+            max = std::max(max, slot.max.load(std::memory_order_relaxed));
+        }
+        if (!names[id].timer) {
+            if (total != 0) {
+                stats[names[id].name] = total;
+            }
+        } else if (count != 0) {
+            json& timer = stats[names[id].name];
+            timer["count"] = count;
+            timer["total_ms"] = total * ns_per_tick / 1e6;
+            timer["mean_us"] = total * ns_per_tick / count / 1e3;
+            timer["max_us"] = max * ns_per_tick / 1e3;
+        }
+    }
+    return stats;
+}
@@ -6,7 +6,7 @@ WorkerProcess::WorkerProcess(int worker_id, std::shared_ptr<WorkerManager> manag
     : worker_id(worker_id), manager(manager), supervisor(manager->getSupervisor()), worker(worker), name(name),
       workersname(supervisor->getName() + "-" + manager->getName() + "-" + name),
       fullname(workersname + "-" + std::to_string(worker_id)),
-      globalname("WorkerProcess-" + fullname), stop_event(false) {
+      globalname("WorkerProcess-" + fullname), stop_event(false), timer(0) {
 
     pidprocess = getpid();
     logger = supervisor->getLogger();
@@ -35,9 +35,7 @@ WorkerProcess::~WorkerProcess() {
 
 void WorkerProcess::stop() {
     stop_event = true;
-    if (timer_thread && timer_thread->joinable()) {
-        timer_thread->join();
-    }
+    TimerService::get_instance().cancel(timer);
     sleep(0.1);
 }
 
@@ -55,18 +53,13 @@ void WorkerProcess::run() {
             if (manager->getProcessDataSharedValue() == 1) {
                 manager->setWorkerStatus(worker_id, 2); // assume queue empty
 
-                try {
-                    std::string high_priority_data = high_priority_queue->front();
-                    high_priority_queue->pop();
-                    process_data(high_priority_data, 1);
-                } catch (const std::out_of_range&) {
-                    try {
-                        std::string low_priority_data = low_priority_queue->front();
-                        low_priority_queue->pop();
-                        process_data(low_priority_data, 0);
-                    } catch (const std::out_of_range&) {
-                        manager->setWorkerStatus(worker_id, 2); // waiting for new data
-                    }
+                PooledBuffer data;
+                if (high_priority_queue->pop(data)) {
+                    process_data(data.to_string(), 1);
+                } else if (low_priority_queue->pop(data)) {
+                    process_data(data.to_string(), 0);
+                } else {
+                    manager->setWorkerStatus(worker_id, 2); // waiting for new data
                 }
             }
         }
@@ -81,12 +74,8 @@ void WorkerProcess::run() {
 }
 
 void WorkerProcess::start_timer(int interval) {
-    timer_thread = std::make_unique<std::thread>([this, interval]() {
-        while (!stop_event) {
-            std::this_thread::sleep_for(std::chrono::seconds(interval));
-            workerop();
-        }
-    });
+    TimerService::get_instance().cancel(timer);
+    timer = TimerService::get_instance().schedule_periodic(static_cast<int64_t>(interval) * 1000000000LL, [this]() { workerop(); });
 }
 
 void WorkerProcess::workerop() {
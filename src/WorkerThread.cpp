@@ -10,20 +10,26 @@
 
 using json = nlohmann::json;
 
-WorkerThread::WorkerThread(int worker_id, WorkerManager* manager, const std::string& name, WorkerBase* worker)
-    : worker_id(worker_id), manager(manager), name(name), worker(worker),
-      processdata(0), status(0), tokenresult(worker_id), tokenreading(worker_id), _stop_event(false) {
+WorkerThread::WorkerThread(int worker_id, WorkerManager* manager, const std::string& name, WorkerBase* worker, bool large, bool shared)
+    : worker_id(worker_id), manager(manager), name(name), worker(worker), large(large), shared(shared),
+      processdata(0), status(0), tokenresult(worker_id), tokenreading(large || shared ? 0 : worker_id), _stop_event(false), timer(0), busy_ns(0) {
 
     supervisor = manager->getSupervisor();
-    workersname = supervisor->name + "-" + manager->getName() + "-" + name;
+    workersname = supervisor->fullname + "-" + manager->getName() + "-" + name;
     fullname = workersname + "-" + std::to_string(worker_id);
     globalname = "WorkerThread-" + fullname;
     logger = supervisor->logger;
 
     worker->init(manager, supervisor, workersname, fullname);
 
-    low_priority_queue = manager->getLowPriorityQueue();
-    high_priority_queue = manager->getHighPriorityQueue();
+    for (WorkerManager* stage : manager->getFusedStages()) {
+        fused_stages.push_back(stage->create_fused_worker(worker_id));
+    }
+    output_manager = manager->getOutputManager();
+
+    // Threads of the large message sub-pool read their own queues, outside the reading token ring
+    low_priority_queue = large ? manager->getLargeLowPriorityQueue() : manager->getLowPriorityQueue();
+    high_priority_queue = large ? manager->getLargeHighPriorityQueue() : manager->getHighPriorityQueue();
     monitoringpoint = manager->getMonitoringPoint();
 
     start_time = std::chrono::high_resolution_clock::now();
@@ -32,11 +38,26 @@ WorkerThread::WorkerThread(int worker_id, WorkerManager* manager, const std::str
     total_processed_data_count = 0;
     processing_rate = 0.0;
 
+    batch_controller = manager->getBatchController();
+    slo_monitor = manager->getSloMonitor();
+    hedge_controller = large || shared ? nullptr : manager->getHedgeController();
+    result_cache = manager->getResultCache();
+    int max_batch_size = batch_controller ? batch_controller->get_max_batch_size() : manager->get_batch_size(0);
+    if (max_batch_size > 1) {
+        pending.reserve(max_batch_size);
+        pending_received.reserve(max_batch_size);
+        batch.reserve(max_batch_size);
+    }
+
 
     spdlog::info("{} started", globalname);
     logger->system("WorkerThread started", globalname);
 
-    internal_thread = std::make_unique<std::thread>(&WorkerThread::run, this);
+    if (shared) {
+        start_timer(1);  // step() is called by the threads of the shared executor
+    } else {
+        internal_thread = std::make_unique<std::thread>(&WorkerThread::run, this);
+    }
 
 }
 
@@ -51,29 +72,22 @@ void WorkerThread::set_processdata(int processdata1) {
 
 void WorkerThread::run() {
     start_timer(1);
+    RealtimeMode* realtime = supervisor->realtime;
+    realtime->enter_thread("worker", globalname);
     while (!_stop_event) {
         // std::this_thread::sleep_for(std::chrono::nanoseconds(10));
         if (processdata == 1 && tokenreading == 0) {
             // std::cout << "AAAAAAAAAAAAAAAAA" << std::endl;
             try {
                 //std::cout << 'BBBBBBBBBBBBBBBBB' << std::endl;
-                // Check and process high-priority queue first
-                if (!high_priority_queue->empty()) {
-                    auto high_priority_data = high_priority_queue->front();
-                    high_priority_queue->pop();
-                    manager->change_token_reading();
-                    process_data(high_priority_data, 1);
-                } else {
-                    // Process low-priority queue if high-priority queue is empty
-                    if (!low_priority_queue->empty()) {
-                        auto low_priority_data = low_priority_queue->front();
-                        low_priority_queue->pop();
-                        manager->change_token_reading();
-                        process_data(low_priority_data, 0);
-                    } else {
-                        status = 2; // waiting for new data
+                if (!step()) {
+                    status = 2; // waiting for new data
+                    if (!run_hedge()) {
+                        realtime->idle();
                     }
+                    continue;
                 }
+                realtime->check_faults(globalname);
             } catch (const std::exception& e) {
                 spdlog::error("Exception caught in WorkerThread run: {}", e.what());
             }
@@ -81,6 +95,9 @@ void WorkerThread::run() {
             if (tokenreading != 0 && status != 4) {
                 status = 4; // waiting for reading from queue
             }
+            if (processdata != 1 || !run_hedge()) {
+                realtime->idle();
+            }
         }
     }
 
@@ -91,7 +108,53 @@ void WorkerThread::run() {
     logger->system("WorkerThread stop", globalname);
 }
 
+// Process the next HP message (or batch), else the next LP one. Returns false if both queues are empty
+bool WorkerThread::step() {
+    // Check and process high-priority queue first
+    if (!high_priority_queue->empty()) {
+        int batch_size = manager->get_batch_size(1);
+        int64_t begin_ns = BatchController::now_ns();
+        if (batch_size > 1) {
+            dequeue_batch(high_priority_queue, batch_size);
+            pass_token_reading();
+            process_batch(1);
+        } else {
+            PooledBuffer high_priority_data;
+            high_priority_queue->pop(high_priority_data);
+            pass_token_reading();
+            if (hedge_controller) {
+                process_hedged(high_priority_data);
+            } else {
+                process_data(high_priority_data, 1);
+            }
+            record_dwell(high_priority_data.get_timestamp(), 1);
+        }
+        busy_ns.fetch_add(BatchController::now_ns() - begin_ns, std::memory_order_relaxed);
+        return true;
+    }
+    // Process low-priority queue if high-priority queue is empty
+    if (!low_priority_queue->empty()) {
+        int batch_size = manager->get_batch_size(0);
+        int64_t begin_ns = BatchController::now_ns();
+        if (batch_size > 1) {
+            dequeue_batch(low_priority_queue, batch_size);
+            pass_token_reading();
+            process_batch(0);
+        } else {
+            PooledBuffer low_priority_data;
+            low_priority_queue->pop(low_priority_data);
+            pass_token_reading();
+            process_data(low_priority_data, 0);
+            record_dwell(low_priority_data.get_timestamp(), 0);
+        }
+        busy_ns.fetch_add(BatchController::now_ns() - begin_ns, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
 WorkerThread::~WorkerThread(){
+    TimerService::get_instance().cancel(timer);
     if (internal_thread && internal_thread->joinable()) {
         internal_thread->join();
     }
@@ -100,6 +163,7 @@ WorkerThread::~WorkerThread(){
 void WorkerThread::stop() {
     status = 16; // stop
     _stop_event = true;
+    TimerService::get_instance().cancel(timer);
 }
 
 int WorkerThread::get_tokenresult() const {
@@ -150,37 +214,225 @@ void WorkerThread::join() {
 
 
 
-// Function to start a timer
+// Function to start a timer on the shared timer service
 void WorkerThread::start_timer(int interval) {
-    timer = std::make_unique<std::thread>(&WorkerThread::workerop, this, interval);
+    TimerService::get_instance().cancel(timer);
+    timer = TimerService::get_instance().schedule_periodic(static_cast<int64_t>(interval) * 1000000000LL, [this]() { workerop(); });
 }
 
-void WorkerThread::workerop(int interval) {
-    while (!_stop_event) {
-        std::this_thread::sleep_for(std::chrono::seconds(interval));
+void WorkerThread::workerop() {
+    auto now = std::chrono::high_resolution_clock::now();
+    double elapsed_time = std::chrono::duration<double>(now - next_time).count();
+    next_time = now;
+    processing_rate = elapsed_time > 0 ? processed_data_count / elapsed_time : 0.0;
+    total_processed_data_count += processed_data_count;
+    spdlog::info("{} Rate Hz {:.1f} Current events {} Total events {} Queues {} {}", globalname, processing_rate, processed_data_count, total_processed_data_count, low_priority_queue->size(), high_priority_queue->size());
+    logger->system(fmt::format("Rate Hz {:.1f} Current events {} Total events {} Queues {} {}", processing_rate, processed_data_count, total_processed_data_count, low_priority_queue->size(), high_priority_queue->size()), globalname);
+    processed_data_count = 0;
+}
+
+void WorkerThread::process_data(const PooledBuffer& data, int priority) {
+    if (!data) {
+        return;
+    }
+    status = 8; // processing new data
+    processed_data_count++;
+
+    auto dataresult = process_message(data, priority);
+
+    push_result(dataresult, priority);
+}
+
+// Copy a message into the reused payload string: no allocation once the buffer has grown to the message size
+const json& WorkerThread::payload_of(const PooledBuffer& data) {
+    payload.get_ref<json::string_t&>().assign(data.data(), data.size());
+    return payload;
+}
 
-        auto elapsed_time = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::high_resolution_clock::now() - next_time).count();
-        next_time = std::chrono::high_resolution_clock::now();
-        processing_rate = static_cast<double>(processed_data_count) / elapsed_time;
-        total_processed_data_count += processed_data_count;
-        spdlog::info("{} Rate Hz {:.1f} Current events {} Total events {} Queues {} {}", globalname, processing_rate, processed_data_count, total_processed_data_count, low_priority_queue->size(), high_priority_queue->size());
-        logger->system(fmt::format("Rate Hz {:.1f} Current events {} Total events {} Queues {} {}", processing_rate, processed_data_count, total_processed_data_count, low_priority_queue->size(), high_priority_queue->size()), globalname);
-        processed_data_count = 0;
+// Run processData on a message, or return its cached result if the payload was already processed
+json WorkerThread::process_message(const PooledBuffer& data, int priority) {
+    if (!result_cache) {
+        return worker->processData(payload_of(data), priority);
+    }
+    ResultCache::Key key = ResultCache::key_of(data.view(), priority);
+    json dataresult;
+    if (!result_cache->lookup(key, dataresult)) {
+        dataresult = worker->processData(payload_of(data), priority);
+        if (!dataresult.empty()) {
+            result_cache->insert(key, dataresult);  // Nothing emitted: may change (e.g. a schema added later)
+        }
     }
+    return dataresult;
 }
 
-void WorkerThread::process_data(const std::string& data, int priority) {
+// Process an HP message published for hedging: the result is emitted only
+// if this execution completes before a hedge of it
+void WorkerThread::process_hedged(const PooledBuffer& data) {
+    if (!data) {
+        return;
+    }
     status = 8; // processing new data
     processed_data_count++;
+    auto execution = hedge_controller->begin(worker_id, data);
+    json dataresult;
+    try {
+        dataresult = process_message(data, 1);
+    } catch (...) {
+        hedge_controller->complete(worker_id, *execution, false);  // Clear the slot, or it stays a straggler for ever
+        hedge_controller->release(*execution, false);
+        throw;
+    }
+    if (hedge_controller->complete(worker_id, *execution, false)) {
+        push_result(dataresult, 1);
+    }
+    hedge_controller->release(*execution, false);
+}
 
-    auto dataresult = worker->processData(data, priority);
+// While idle, process again an HP message another worker thread is late on.
+// Returns false if there was none
+bool WorkerThread::run_hedge() {
+    if (!hedge_controller) {
+        return false;
+    }
+    auto execution = hedge_controller->take_straggler(worker_id);
+    if (!execution) {
+        return false;
+    }
+    try {
+        status = 8; // processing new data
+        auto dataresult = worker->processData(payload_of(execution->message), 1);
+        if (hedge_controller->complete(worker_id, *execution, true)) {
+            push_result(dataresult, 1);
+        }
+    } catch (const std::exception& e) {
+        spdlog::error("Exception caught in hedged execution: {}", e.what());
+    }
+    hedge_controller->release(*execution, true);
+    return true;
+}
 
-    if (!dataresult.empty() && tokenresult == 0) {
-        if (priority == 0) {
-            manager->getResultLpQueue()->push(dataresult);
-        } else {
-            manager->getResultHpQueue()->push(dataresult);
+// Pass the reading token to the next worker thread of the main pool
+void WorkerThread::pass_token_reading() {
+    if (!large && !shared) {
+        manager->change_token_reading();
+    }
+}
+
+// Dequeue up to batch_size messages of the same priority
+void WorkerThread::dequeue_batch(std::shared_ptr<MessageQueue>& queue, int batch_size) {
+    pending.clear();
+    queue->pop_batch(pending, batch_size);
+}
+
+// Report to the batch controller and the SLO monitor the time spent in the manager by a message, from reception to results
+void WorkerThread::record_dwell(int64_t received_ns, int priority) {
+    if (received_ns == 0) {
+        return;
+    }
+    int64_t dwell_ns = BatchController::now_ns() - received_ns;
+    if (slo_monitor) {
+        slo_monitor->record(priority, dwell_ns);
+    }
+    if (batch_controller) {
+        const auto& queue = priority ? high_priority_queue : low_priority_queue;
+        batch_controller->record(priority, dwell_ns, queue->size());
+    }
+}
+
+// Same for the messages of a processed batch: the batch controller gets the oldest one
+void WorkerThread::record_batch_dwell(int priority) {
+    if (pending_received.empty()) {
+        return;
+    }
+    int64_t now = BatchController::now_ns();
+    if (slo_monitor) {
+        for (int64_t received_ns : pending_received) {
+            if (received_ns != 0) {
+                slo_monitor->record(priority, now - received_ns);
+            }
         }
-        manager->change_token_results();
+    }
+    if (batch_controller && pending_received.front() != 0) {
+        const auto& queue = priority ? high_priority_queue : low_priority_queue;
+        batch_controller->record(priority, now - pending_received.front(), queue->size());
+    }
+}
+
+// Decode the dequeued messages into a columnar batch and process it at once
+void WorkerThread::process_batch(int priority) {
+    status = 8; // processing new data
+    batch.clear();
+    pending_received.clear();
+    for (const auto& data : pending) {
+        pending_received.push_back(data.get_timestamp());
+        try {
+            if (!worker->decodeToBatch(data.view(), batch)) {
+                process_data(data, priority);
+            }
+        } catch (const std::exception& e) {
+            // Only this message is lost, as in the per-message path
+            spdlog::error("Exception caught in WorkerThread batch message: {}", e.what());
+        }
+    }
+    if (batch.empty()) {
+        pending.clear();
+        record_batch_dwell(priority);
+        return;
+    }
+    processed_data_count += batch.size();
+
+    auto dataresult = worker->processBatch(batch, priority);
+
+    // Results are converted back to single messages at egress
+    if (dataresult.is_array()) {
+        for (const auto& result : dataresult) {
+            push_result(result, priority);
+        }
+    } else {
+        push_result(dataresult, priority);
+    }
+    // The batch holds no reference to the buffers, but they are released only
+    // now, so a reliable input acknowledges the messages once processed
+    pending.clear();
+    record_batch_dwell(priority);
+}
+
+// Run a result through the fused pipeline stages, in this thread, then emit it
+void WorkerThread::push_result(const json& dataresult, int priority) {
+    if (fused_stages.empty()) {
+        emit_result(dataresult, priority);
+        return;
+    }
+    if (dataresult.empty()) {
+        return;
+    }
+    json result = fused_stages.front()->processFused(dataresult, priority);  // The first stage reads the result in place
+    for (size_t i = 1; i < fused_stages.size(); ++i) {
+        if (result.empty()) {
+            return;
+        }
+        result = fused_stages[i]->processFused(result, priority);
+    }
+    emit_result(result, priority);
+}
+
+// Forward a result to the downstream pipeline stages and queue it for the result sockets
+void WorkerThread::emit_result(const json& dataresult, int priority) {
+    if (dataresult.empty()) {
+        return;
+    }
+    std::string result_str = dataresult.is_string() ? dataresult.get<std::string>() : dataresult.dump();
+    if (output_manager->has_downstream()) {
+        // In-memory edges do not wait for the result token: no result is dropped
+        output_manager->forward(priority, result_str);
+        if (!output_manager->has_result_output()) {
+            return;
+        }
+    }
+    if (large || shared) {
+        output_manager->queue_result(priority, result_str);  // Outside the result token ring
+    } else if (tokenresult == 0) {
+        output_manager->queue_result(priority, result_str);
+        output_manager->change_token_results();
     }
 }
\ No newline at end of file
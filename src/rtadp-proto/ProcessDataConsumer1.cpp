@@ -3,9 +3,15 @@
 #include <thread>
 #include <exception>
 #include "Supervisor1.h"
+#include "PerCoreMode.h"
 
 void main_function(const std::string& json_file_path, const std::string& consumername) {
     try {
+        // In per-core mode, continue as the pipeline shard of one core
+        if (PerCoreMode::launch(json_file_path, consumername) < 0) {
+            return;
+        }
+
         // Create an instance of Supervisor1
         Supervisor1 supervisor_instance(json_file_path, consumername);
 
@@ -18,8 +24,8 @@ void main_function(const std::string& json_file_path, const std::string& consume
 
 int main(int argc, char* argv[]) {
     // Check if a JSON file path is provided as a command-line argument
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " <json_file_path>" << std::endl;
+    if (argc != 2 && argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <json_file_path> [processname]" << std::endl;
         return 1;
     }
 
@@ -27,6 +33,11 @@ int main(int argc, char* argv[]) {
     std::string json_file_path = argv[1];
     std::string consumername = "RTADP1";
 
+    // Optional process name, e.g. to run one shard of a sharded pipeline
+    if (argc == 3) {
+        consumername = argv[2];
+    }
+
     // Call the main function with the provided JSON file path
     main_function(json_file_path, consumername);
 
@@ -12,11 +12,15 @@ Supervisor1::~Supervisor1() {
 
 // Override the start_managers method
 void Supervisor1::start_managers() {
-    int indexmanager = 0;
-    WorkerManager1* manager1 = new WorkerManager1(indexmanager, this, std::string(1, workername[indexmanager]));
-    setup_result_channel(manager1, indexmanager);
-    manager1->run();
-    manager_workers.push_back(manager1);
+    int num_managers = pipeline->is_enabled() ? pipeline->size() : 1;
+    for (int indexmanager = 0; indexmanager < num_managers; indexmanager++) {
+        std::string managername = pipeline->is_enabled() ? pipeline->get_name(indexmanager) : std::string(1, workername[indexmanager]);
+        WorkerManager1* manager1 = new WorkerManager1(indexmanager, this, managername);
+        setup_result_channel(manager1, indexmanager);
+        manager1->run();
+        manager_workers.push_back(manager1);
+    }
+    connect_pipeline();
 }
 
 // Decode the data before loading it into the queue. For "dataflowtype": "binary"
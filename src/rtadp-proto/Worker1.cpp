@@ -31,10 +31,9 @@ Worker1::Worker1() : WorkerBase() {
         ]
     })";
 
-    std::istringstream schema_stream(avro_schema_str);
-    avro::compileJsonSchema(schema_stream, avro_schema);
-
-    this->avro_schema = avro_schema;
+    // The reader schema is registered, so producers can find it by fingerprint
+    resolvers = std::make_unique<SchemaResolverCache>(avro_schema_str);
+    avro_schema = resolvers->get_reader();
 }
 
 // Override the config method
@@ -48,18 +47,22 @@ nlohmann::json Worker1::processData(const nlohmann::json& data, int priority) {
 
     if (dataflow_type == "binary") {
         // Assuming data contains binary data as a string
-        std::string binary_data = data.get<std::string>();
-        std::unique_ptr<avro::InputStream> in = avro::memoryInputStream(
-            reinterpret_cast<const uint8_t*>(binary_data.data()), binary_data.size()
-        );
-
-        // Create a binary decoder
-        auto decoder = avro::binaryDecoder();
-        decoder->init(*in);
+        const std::string& binary_data = data.get_ref<const std::string&>();
 
-        // Use GenericDatum to deserialize data
+        // Use GenericDatum to deserialize data, resolved to the reader schema
+        static const int decode_timer = timer_id("decode");
+        static const int unknown_schemas = counter_id("unknown_schemas");
         avro::GenericDatum datum(avro_schema);
-        avro::decode(*decoder, datum);
+        bool decoded;
+        {
+            auto timer = time_scope(decode_timer);
+            decoded = decode_datum(reinterpret_cast<const uint8_t*>(binary_data.data()), binary_data.size(), datum);
+        }
+        if (!decoded) {
+            count(unknown_schemas);
+            spdlog::warn("Unknown Avro writer schema: message dropped");
+            return result;
+        }
 
         if (datum.type() == avro::AVRO_RECORD) {
             const avro::GenericRecord& record = datum.value<avro::GenericRecord>();
@@ -88,6 +91,168 @@ nlohmann::json Worker1::processData(const nlohmann::json& data, int priority) {
     return result;
 }
 
+bool Worker1::decodeToBatch(std::string_view data, ColumnarBatch& batch) {
+    if (get_supervisor()->dataflowtype != "binary") {
+        // Per-record results of text messages keep the raw message: only aggregates use the batch
+        return is_aggregating() && WorkerBase::decodeToBatch(data, batch);
+    }
+
+    // A malformed message is counted and skipped: the rest of the batch is kept
+    static const int malformed = counter_id("malformed");
+    const uint8_t* payload = reinterpret_cast<const uint8_t*>(data.data());
+    size_t size = data.size();
+    try {
+        bool resolving;
+        avro::Decoder* decoder = resolvers->get_decoder(payload, size, resolving);
+        if (!resolving) {
+            // Decode straight into the columns: the strings are interned from views on the message
+            if (!batch.append_avro(reinterpret_cast<const char*>(payload), size)) {
+                count(malformed);
+                spdlog::warn("Malformed Avro message: dropped from the batch");
+            }
+            return true;
+        }
+        if (decoder == nullptr) {
+            return false;  // Unknown writer schema: reported by processData
+        }
+
+        // Evolved writer schema: resolved with the cached resolver of its fingerprint
+        std::unique_ptr<avro::InputStream> in = avro::memoryInputStream(payload, size);
+        decoder->init(*in);
+        avro::GenericDatum datum(avro_schema);
+        avro::decode(*decoder, datum);
+        append_record(datum.value<avro::GenericRecord>(), batch);
+    } catch (const std::exception& e) {
+        count(malformed);
+        spdlog::warn("Malformed Avro message: dropped from the batch: {}", e.what());
+    }
+    return true;
+}
+
+// Decodes a message, resolving it from its writer schema if it has a single-object header
+bool Worker1::decode_datum(const uint8_t* data, size_t size, avro::GenericDatum& datum) {
+    bool resolving;
+    avro::Decoder* decoder = resolvers->get_decoder(data, size, resolving);
+    if (decoder == nullptr) {
+        return false;
+    }
+    std::unique_ptr<avro::InputStream> in = avro::memoryInputStream(data, size);
+    decoder->init(*in);
+    avro::decode(*decoder, datum);
+    return true;
+}
+
+// Appends a decoded AvroMonitoringPoint record to a columnar batch
+void Worker1::append_record(const avro::GenericRecord& record, ColumnarBatch& batch) {
+    ColumnarRow row;
+    row.timestamp = record.field("timestamp").value<int64_t>();
+    const avro::GenericDatum& source_timestamp = record.field("source_timestamp");
+    if (source_timestamp.type() == avro::AVRO_LONG) {
+        row.has_source_timestamp = true;
+        row.source_timestamp = source_timestamp.value<int64_t>();
+    }
+    row.assembly = record.field("assembly").value<std::string>();
+    row.name = record.field("name").value<std::string>();
+    row.serial_number = record.field("serial_number").value<std::string>();
+    row.units = record.field("units").value<std::string>();
+    row.env_id = record.field("env_id").value<std::string>();
+    row.archive_suppress = record.field("archive_suppress").value<bool>();
+    row.eng_gui = record.field("eng_gui").value<bool>();
+    row.op_gui = record.field("op_gui").value<bool>();
+    const auto& items = record.field("data").value<avro::GenericArray>().value();
+    if (!items.empty()) {
+        const avro::GenericDatum& item = items[0];
+        row.has_value = true;
+        switch (item.type()) {
+            case avro::AVRO_DOUBLE: row.value = item.value<double>(); break;
+            case avro::AVRO_INT: row.value = item.value<int32_t>(); break;
+            case avro::AVRO_LONG: row.value = static_cast<double>(item.value<int64_t>()); break;
+            default: row.has_value = false; break;
+        }
+    }
+    batch.append(row);
+}
+
+// True if the micro-batches yield per-name aggregates instead of one result per record
+bool Worker1::is_aggregating() {
+    if (aggregate_batches < 0) {
+        std::string batch_result = get_manager()->getManagerConfig().value("batch_result", std::string("record"));
+        if (batch_result != "record" && batch_result != "aggregate") {
+            throw std::invalid_argument("Config file: batch_result must be record or aggregate");
+        }
+        aggregate_batches = batch_result == "aggregate";
+    }
+    return aggregate_batches;
+}
+
+nlohmann::json Worker1::processBatch(const ColumnarBatch& batch, int priority) {
+    nlohmann::json results = nlohmann::json::array();
+    if (!is_aggregating()) {
+        // Same results as processData, one per record
+        for (uint32_t id : batch.get_name_ids()) {
+            nlohmann::json result;
+            result["name"] = batch.get_string(id);
+            result["priority"] = priority;
+            results.push_back(result);
+        }
+        return results;
+    }
+
+    std::vector<uint32_t> names;
+    std::vector<double> sums;
+    std::vector<uint32_t> counts;
+    ColumnarOps::group_by_name(batch, names, sums, counts);
+
+    // One result per monitoring point name found in the batch
+    for (size_t group = 0; group < names.size(); ++group) {
+        if (counts[group] == 0) {
+            continue;
+        }
+        std::string name(batch.get_string(names[group]));
+        NameTotals& name_totals = totals[name];
+        name_totals.count += counts[group];
+        name_totals.sum += sums[group];
+        nlohmann::json result;
+        result["name"] = name;
+        result["count"] = counts[group];
+        result["mean"] = sums[group] / counts[group];
+        result["total_count"] = name_totals.count;
+        result["total_mean"] = name_totals.sum / name_totals.count;
+        result["priority"] = priority;
+        results.push_back(result);
+    }
+    if (!results.empty()) {
+        publish_totals();
+    }
+    return results;
+}
+
+// Publishes the running totals for checkpointing
+void Worker1::publish_totals() {
+    nlohmann::json state = nlohmann::json::object();
+    for (const auto& [name, name_totals] : totals) {
+        state[name] = {{"count", name_totals.count}, {"sum", name_totals.sum}};
+    }
+    publish_state(std::move(state));
+}
+
+// Override to restore the running totals from a checkpoint
+void Worker1::restore(const nlohmann::json& state) {
+    WorkerBase::restore(state);
+    totals.clear();
+    for (const auto& [name, value] : state.items()) {
+        NameTotals& name_totals = totals[name];
+        name_totals.count = value.value("count", uint64_t(0));
+        name_totals.sum = value.value("sum", 0.0);
+    }
+}
+
+// Override to add up the running totals of a name kept by two workers
+void Worker1::merge_state(nlohmann::json& into, const nlohmann::json& from) const {
+    into["count"] = into.value("count", uint64_t(0)) + from.value("count", uint64_t(0));
+    into["sum"] = into.value("sum", 0.0) + from.value("sum", 0.0);
+}
+
 // Helper function to generate random duration between 0 and 100 milliseconds
 double Worker1::random_duration() {
     std::random_device rd;
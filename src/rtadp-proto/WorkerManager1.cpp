@@ -10,8 +10,10 @@ void WorkerManager1::start_worker_threads(int num_threads) {
     // Create worker threads
     for (int i = 0; i < num_threads; ++i) {
         auto processor = std::make_shared<Worker1>();
+        processors.push_back(processor);
+        register_worker(processor.get());
         auto thread = std::make_shared<WorkerThread>(i, this, getSupervisor()->getNameWorkers()[manager_id], processor.get());
-        worker_threads.push_back(thread);
+        add_worker_thread(thread);
         thread->run();  // Start the thread
     }
 }
@@ -27,3 +29,8 @@ void WorkerManager1::start_worker_processes(int num_processes) {
         process->run();  // Start the process
     }
 }
+
+// Override to create the workers of fused pipeline stages
+std::shared_ptr<WorkerBase> WorkerManager1::create_worker() {
+    return std::make_shared<Worker1>();
+}